@@ -0,0 +1,51 @@
+#include <android/log.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+
+namespace
+{
+int minPriority()
+{
+    static const int level = []
+    {
+        const char* env = std::getenv("PIXELPILOT_LOG_LEVEL");
+        return env ? std::atoi(env) : ANDROID_LOG_INFO;
+    }();
+    return level;
+}
+
+char priorityChar(int prio)
+{
+    static constexpr char chars[] = "??VDIWEFS";
+    return (prio >= 0 && prio <= ANDROID_LOG_SILENT) ? chars[prio] : '?';
+}
+
+// Keeps lines from different threads from interleaving
+std::mutex gLogMutex;
+}  // namespace
+
+extern "C" int __android_log_write(int prio, const char* tag, const char* text)
+{
+    return __android_log_print(prio, tag, "%s", text);
+}
+
+extern "C" int __android_log_vprint(int prio, const char* tag, const char* fmt, va_list ap)
+{
+    if (prio < minPriority()) return 0;
+    std::lock_guard<std::mutex> lock(gLogMutex);
+    int n = std::fprintf(stderr, "%c/%s: ", priorityChar(prio), tag ? tag : "");
+    n += std::vfprintf(stderr, fmt, ap);
+    std::fputc('\n', stderr);
+    return n + 1;
+}
+
+extern "C" int __android_log_print(int prio, const char* tag, const char* fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    const int n = __android_log_vprint(prio, tag, fmt, ap);
+    va_end(ap);
+    return n;
+}
@@ -0,0 +1,10 @@
+//
+// Host stand-in for bionic <bits/ioctl.h>.
+//
+
+#ifndef PIXELPILOT_HOST_BITS_IOCTL_H
+#define PIXELPILOT_HOST_BITS_IOCTL_H
+
+#include <sys/ioctl.h>
+
+#endif  // PIXELPILOT_HOST_BITS_IOCTL_H
@@ -0,0 +1,30 @@
+//
+// Host stand-in for <jni.h>.
+// Only the types that appear in signatures of the core classes, the JNI glue itself is not built on host.
+//
+
+#ifndef PIXELPILOT_HOST_JNI_H
+#define PIXELPILOT_HOST_JNI_H
+
+#include <stdint.h>
+
+typedef uint8_t  jboolean;
+typedef int8_t   jbyte;
+typedef uint16_t jchar;
+typedef int16_t  jshort;
+typedef int32_t  jint;
+typedef int64_t  jlong;
+typedef float    jfloat;
+typedef double   jdouble;
+typedef jint     jsize;
+
+typedef struct _jobject* jobject;
+typedef jobject          jclass;
+typedef jobject          jstring;
+
+typedef struct _JavaVM JavaVM;
+typedef struct _JNIEnv JNIEnv;
+
+#define JNI_VERSION_1_6 0x00010006
+
+#endif  // PIXELPILOT_HOST_JNI_H
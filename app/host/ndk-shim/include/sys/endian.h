@@ -0,0 +1,10 @@
+//
+// Host stand-in for bionic <sys/endian.h>, glibc has the same macros in <endian.h>.
+//
+
+#ifndef PIXELPILOT_HOST_SYS_ENDIAN_H
+#define PIXELPILOT_HOST_SYS_ENDIAN_H
+
+#include <endian.h>
+
+#endif  // PIXELPILOT_HOST_SYS_ENDIAN_H
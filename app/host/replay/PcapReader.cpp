@@ -0,0 +1,62 @@
+#include "PcapReader.h"
+
+#include <byteswap.h>
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace
+{
+constexpr uint32_t MAGIC_USEC = 0xa1b2c3d4;
+constexpr uint32_t MAGIC_NSEC = 0xa1b23c4d;
+
+constexpr size_t GLOBAL_HEADER_SIZE = 24;
+constexpr size_t RECORD_HEADER_SIZE = 16;
+}  // namespace
+
+PcapReader::PcapReader(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) throw std::runtime_error("Cannot open " + path);
+    mFile.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    if (mFile.size() < GLOBAL_HEADER_SIZE) throw std::runtime_error(path + " is too short for a pcap file");
+
+    const auto read32 = [this](size_t offset, bool swap)
+    {
+        uint32_t v;
+        std::memcpy(&v, mFile.data() + offset, sizeof(v));
+        return swap ? bswap_32(v) : v;
+    };
+
+    const uint32_t magic = read32(0, false);
+    bool           swap  = false;
+    bool           nsec  = false;
+    if (magic == MAGIC_USEC || magic == MAGIC_NSEC)
+    {
+        nsec = magic == MAGIC_NSEC;
+    }
+    else if (bswap_32(magic) == MAGIC_USEC || bswap_32(magic) == MAGIC_NSEC)
+    {
+        swap = true;
+        nsec = bswap_32(magic) == MAGIC_NSEC;
+    }
+    else
+    {
+        throw std::runtime_error(path + " is not a classic pcap file (pcapng is not supported)");
+    }
+    mLinkType = read32(20, swap) & 0x0fffffff;
+
+    size_t offset = GLOBAL_HEADER_SIZE;
+    while (offset + RECORD_HEADER_SIZE <= mFile.size())
+    {
+        const uint64_t sec      = read32(offset, swap);
+        const uint64_t frac     = read32(offset + 4, swap);
+        const uint32_t inclLen  = read32(offset + 8, swap);
+        offset += RECORD_HEADER_SIZE;
+        if (offset + inclLen > mFile.size()) break;  // truncated capture, keep what we have
+        mRecords.push_back({sec * 1000000000ULL + (nsec ? frac : frac * 1000), {mFile.data() + offset, inclLen}});
+        offset += inclLen;
+    }
+}
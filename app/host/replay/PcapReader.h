@@ -0,0 +1,47 @@
+//
+// Minimal reader for classic .pcap files (not pcapng), so the replay harness doesn't need a host libpcap.
+// The whole file is loaded into memory up front to keep disk I/O out of the measurements.
+//
+
+#ifndef PIXELPILOT_PCAPREADER_H
+#define PIXELPILOT_PCAPREADER_H
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+class PcapReader
+{
+  public:
+    // Link types we know how to unwrap, values as in pcap/dlt.h
+    static constexpr uint32_t LINKTYPE_NULL              = 0;
+    static constexpr uint32_t LINKTYPE_ETHERNET          = 1;
+    static constexpr uint32_t LINKTYPE_RAW               = 101;
+    static constexpr uint32_t LINKTYPE_IEEE802_11        = 105;
+    static constexpr uint32_t LINKTYPE_LINUX_SLL         = 113;
+    static constexpr uint32_t LINKTYPE_IEEE802_11_RADIOTAP = 127;
+    static constexpr uint32_t LINKTYPE_LINUX_SLL2        = 276;
+
+    struct Record
+    {
+        uint64_t                 timestampNs;
+        std::span<const uint8_t> data;
+    };
+
+    /**
+     * @throws std::runtime_error if the file can't be read or is not a classic pcap file
+     */
+    explicit PcapReader(const std::string& path);
+
+    [[nodiscard]] uint32_t linkType() const { return mLinkType; }
+
+    [[nodiscard]] const std::vector<Record>& records() const { return mRecords; }
+
+  private:
+    std::vector<uint8_t> mFile;
+    std::vector<Record>  mRecords;
+    uint32_t             mLinkType = 0;
+};
+
+#endif  // PIXELPILOT_PCAPREADER_H
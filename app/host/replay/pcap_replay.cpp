@@ -0,0 +1,496 @@
+// Offline replay of a capture through the RX pipeline, the same path WfbngLink and VideoPlayer use on device:
+//   wfb mode   (radiotap / raw 802.11 captures of the air link)
+//              ChannelMatcher -> Aggregator (decrypt + FEC) -> H26XParser (RTP depacketization) -> NALU
+//   plain mode (Ethernet / IP / Linux cooked captures of the RTP stream, e.g. udp port 5600 on the ground station)
+//              UDP port filter -> H26XParser -> NALU
+//
+// Max speed by default, or paced by the capture timestamps with --realtime. Reports packets/s, NALUs/s and
+// per-stage latency percentiles.
+//
+// Usage: pcap_replay [options] capture.pcap
+//   --realtime          pace packets by their capture timestamps
+//   --speed X           pacing factor for --realtime (default 1.0)
+//   --loop N            replay the capture N times (default 1)
+//   --key PATH          wfb-ng rx keypair (default gs.key)
+//   --link-id N         wfb link id (default 7669206)
+//   --radio-port N      wfb radio port of the video stream (default 0)
+//   --udp-port N        RTP port in plain mode (default 5600)
+//   --zero-copy         assemble NALUs as references into the packets, like the in-process receiver does
+//   --access-units      feed the (simulated) decoder one buffer per picture instead of one per NALU
+//   --drop-every N      drop every Nth RTP packet before depacketization, to exercise the loss handling
+//   --drop-until-keyframe  drop pictures depending on lost data instead of forwarding them (LossTracker policy)
+
+#include "PcapReader.h"
+
+#include "ChannelMatcher.h"
+#include "InProcessRtpSink.h"
+#include "parser/H26XParser.h"
+
+#ifdef PIXELPILOT_HAVE_WFBNG
+#include "AggregatorInProcess.h"
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+constexpr uint32_t DEFAULT_LINK_ID = 7669206;
+
+struct Options
+{
+    std::string path;
+    bool        realtime          = false;
+    double      speed             = 1.0;
+    int         loops             = 1;
+    std::string keyPath           = "gs.key";
+    uint32_t    linkId            = DEFAULT_LINK_ID;
+    uint8_t     radioPort         = 0;
+    uint16_t    udpPort           = 5600;
+    bool        zeroCopy          = false;
+    bool        accessUnits       = false;
+    uint64_t    dropEvery         = 0;
+    bool        dropUntilKeyframe = false;
+};
+
+class LatencyHistogram
+{
+  public:
+    explicit LatencyHistogram(const char* name) : mName(name) { mSamplesNs.reserve(1 << 16); }
+
+    void add(Clock::duration d) { mSamplesNs.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count()); }
+
+    void print()
+    {
+        if (mSamplesNs.empty()) return;
+        std::sort(mSamplesNs.begin(), mSamplesNs.end());
+        const auto us = [this](double q)
+        { return mSamplesNs[std::min(mSamplesNs.size() - 1, static_cast<size_t>(q * mSamplesNs.size()))] / 1000.0; };
+        printf(
+            "  %-14s n=%-9zu p50 %9.2f  p90 %9.2f  p99 %9.2f  max %9.2f us\n",
+            mName,
+            mSamplesNs.size(),
+            us(0.5),
+            us(0.9),
+            us(0.99),
+            mSamplesNs.back() / 1000.0);
+    }
+
+  private:
+    const char*          mName;
+    std::vector<int64_t> mSamplesNs;
+};
+
+uint16_t readBe16(const uint8_t* p)
+{
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+uint16_t readLe16(const uint8_t* p)
+{
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t readLe32(const uint8_t* p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+// 802.11 frame inside a capture record, with or without the trailing FCS
+struct WifiFrame
+{
+    std::span<const uint8_t> data;
+    bool                     hasFcs;
+};
+
+std::optional<WifiFrame> extractWifi(uint32_t linkType, std::span<const uint8_t> record)
+{
+    if (linkType == PcapReader::LINKTYPE_IEEE802_11) return WifiFrame{record, false};
+    if (linkType != PcapReader::LINKTYPE_IEEE802_11_RADIOTAP || record.size() < 8) return std::nullopt;
+
+    const size_t itLen = readLe16(record.data() + 2);
+    if (itLen > record.size()) return std::nullopt;
+
+    // Walk the (possibly extended) present bitmaps, only TSFT and FLAGS matter to find the FCS bit
+    size_t   offset  = 4;
+    uint32_t present = readLe32(record.data() + offset);
+    uint32_t first   = present;
+    while ((present & 0x80000000u) && offset + 8 <= itLen)
+    {
+        offset += 4;
+        present = readLe32(record.data() + offset);
+    }
+    offset += 4;
+    bool hasFcs = false;
+    if (first & 0x1)
+    {
+        offset = (offset + 7) & ~size_t{7};
+        offset += 8;
+    }
+    if ((first & 0x2) && offset < itLen)
+    {
+        hasFcs = record[offset] & 0x10;
+    }
+    return WifiFrame{record.subspan(itLen), hasFcs};
+}
+
+// UDP payload of an IPv4 datagram to the given port
+std::optional<std::span<const uint8_t>> extractUdp(uint32_t linkType, std::span<const uint8_t> record, uint16_t port)
+{
+    size_t   offset    = 0;
+    uint16_t etherType = 0x0800;
+    switch (linkType)
+    {
+        case PcapReader::LINKTYPE_ETHERNET:
+            if (record.size() < 14) return std::nullopt;
+            etherType = readBe16(record.data() + 12);
+            offset    = 14;
+            while ((etherType == 0x8100 || etherType == 0x88a8) && record.size() >= offset + 4)
+            {
+                etherType = readBe16(record.data() + offset + 2);
+                offset += 4;
+            }
+            break;
+        case PcapReader::LINKTYPE_LINUX_SLL:
+            if (record.size() < 16) return std::nullopt;
+            etherType = readBe16(record.data() + 14);
+            offset    = 16;
+            break;
+        case PcapReader::LINKTYPE_LINUX_SLL2:
+            if (record.size() < 20) return std::nullopt;
+            etherType = readBe16(record.data());
+            offset    = 20;
+            break;
+        case PcapReader::LINKTYPE_NULL:
+            offset = 4;
+            break;
+        case PcapReader::LINKTYPE_RAW:
+        case 12:  // LINKTYPE_RAW on OpenBSD
+        case 14:  // LINKTYPE_RAW on some BSDs
+            break;
+        default:
+            return std::nullopt;
+    }
+    if (etherType != 0x0800 || record.size() < offset + 20) return std::nullopt;
+
+    const uint8_t* ip = record.data() + offset;
+    if ((ip[0] >> 4) != 4 || ip[9] != 17) return std::nullopt;
+    const size_t ihl = (ip[0] & 0x0f) * 4;
+    if ((readBe16(ip + 6) & 0x3fff) != 0) return std::nullopt;  // fragments are not reassembled
+    const size_t ipLen = std::min<size_t>(readBe16(ip + 2), record.size() - offset);
+    if (ipLen < ihl + 8) return std::nullopt;
+
+    const uint8_t* udp    = ip + ihl;
+    const size_t   udpLen = std::min<size_t>(readBe16(udp + 4), ipLen - ihl);
+    if (readBe16(udp + 2) != port || udpLen < 8) return std::nullopt;
+    return std::span<const uint8_t>(udp + 8, udpLen - 8);
+}
+
+// RTP packets the aggregator recovered from one radio frame. The buffers are kept from frame to frame, so the
+// aggregator stage is timed without heap allocations (the pool only grows for a frame completing more packets than
+// any before)
+class RtpBatch
+{
+  public:
+    static constexpr size_t PREALLOC_PACKETS = 64;
+    static constexpr size_t PREALLOC_SIZE    = 2048;
+
+    RtpBatch() : mPackets(PREALLOC_PACKETS)
+    {
+        for (auto& packet : mPackets) packet.reserve(PREALLOC_SIZE);
+    }
+
+    void push(const uint8_t* data, size_t length)
+    {
+        if (mCount == mPackets.size()) mPackets.emplace_back().reserve(PREALLOC_SIZE);
+        mPackets[mCount++].assign(data, data + length);
+    }
+
+    std::span<const std::vector<uint8_t>> packets() const { return {mPackets.data(), mCount}; }
+
+    void clear() { mCount = 0; }
+
+  private:
+    std::vector<std::vector<uint8_t>> mPackets;
+    size_t                            mCount = 0;
+};
+
+bool isWifiLinkType(uint32_t linkType)
+{
+    return linkType == PcapReader::LINKTYPE_IEEE802_11 || linkType == PcapReader::LINKTYPE_IEEE802_11_RADIOTAP;
+}
+
+void usage(const char* argv0)
+{
+    fprintf(
+        stderr,
+        "Usage: %s [--realtime] [--speed X] [--loop N] [--key PATH] [--link-id N] [--radio-port N] [--udp-port N] "
+        "[--zero-copy] [--access-units] [--drop-every N] [--drop-until-keyframe] capture.pcap\n",
+        argv0);
+    exit(2);
+}
+
+Options parseOptions(int argc, char** argv)
+{
+    Options opts;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg   = argv[i];
+        const auto        value = [&]() -> const char*
+        {
+            if (i + 1 >= argc) usage(argv[0]);
+            return argv[++i];
+        };
+        if (arg == "--realtime")
+            opts.realtime = true;
+        else if (arg == "--speed")
+            opts.speed = atof(value());
+        else if (arg == "--loop")
+            opts.loops = atoi(value());
+        else if (arg == "--key")
+            opts.keyPath = value();
+        else if (arg == "--link-id")
+            opts.linkId = strtoul(value(), nullptr, 0);
+        else if (arg == "--radio-port")
+            opts.radioPort = strtoul(value(), nullptr, 0);
+        else if (arg == "--udp-port")
+            opts.udpPort = strtoul(value(), nullptr, 0);
+        else if (arg == "--zero-copy")
+            opts.zeroCopy = true;
+        else if (arg == "--access-units")
+            opts.accessUnits = true;
+        else if (arg == "--drop-every")
+            opts.dropEvery = strtoull(value(), nullptr, 0);
+        else if (arg == "--drop-until-keyframe")
+            opts.dropUntilKeyframe = true;
+        else if (!arg.empty() && arg[0] == '-')
+            usage(argv[0]);
+        else
+            opts.path = arg;
+    }
+    if (opts.path.empty() || opts.speed <= 0 || opts.loops < 1) usage(argv[0]);
+    return opts;
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    const Options opts = parseOptions(argc, argv);
+
+    std::unique_ptr<PcapReader> pcap;
+    try
+    {
+        pcap = std::make_unique<PcapReader>(opts.path);
+    }
+    catch (const std::exception& e)
+    {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    const bool wifi = isWifiLinkType(pcap->linkType());
+
+    LatencyHistogram classifyLatency("classify");
+    LatencyHistogram aggregateLatency("decrypt+fec");
+    LatencyHistogram parseLatency("rtp->nalu");
+    LatencyHistogram totalLatency("per packet");
+    LatencyHistogram naluLatency("nalu assembly");
+
+    // Stands in for the codec input buffer, every NALU is written out once like VideoDecoder::feedDecoder does
+    std::vector<uint8_t> codecInput(NALU::NALU_MAXLEN);
+    uint64_t             nalus = 0, naluBytes = 0, keyframes = 0, pictures = 0, codecBuffers = 0;
+    H26XParser           parser(
+        [&](const NALU& nalu)
+        {
+            if (!opts.accessUnits)
+            {
+                nalu.copyTo(codecInput.data());
+                codecBuffers++;
+            }
+            naluLatency.add(Clock::now() - nalu.creationTime);
+            nalus++;
+            naluBytes += nalu.getSize();
+            if (nalu.is_keyframe()) keyframes++;
+            if (nalu.isSlice() && nalu.isFirstSliceInPicture()) pictures++;
+        },
+        [&](const NALU& accessUnit)
+        {
+            accessUnit.copyTo(codecInput.data());
+            codecBuffers++;
+        },
+        nullptr);
+    parser.setAccessUnitMode(opts.accessUnits);
+    parser.setLossPolicy(
+        opts.dropUntilKeyframe ? LossTracker::Policy::DROP_UNTIL_KEYFRAME : LossTracker::Policy::FORWARD);
+
+    uint64_t   rtpSeen  = 0;
+    const auto parseRtp = [&](const uint8_t* data, size_t length)
+    {
+        if (opts.dropEvery > 0 && ++rtpSeen % opts.dropEvery == 0) return;
+        parser.parse_rtp_stream(data, length, opts.zeroCopy);
+    };
+
+    // The aggregator calls the sink from inside process_packet, collect and parse afterwards so the two stages
+    // can be timed separately
+    RtpBatch rtpBatch;
+    size_t   rtpCount = 0;
+
+    const ChannelMatcher<1> matcher({(opts.linkId << 8) + opts.radioPort});
+#ifdef PIXELPILOT_HAVE_WFBNG
+    const InProcessRtpSink sink{
+        &rtpBatch,
+        [](void* opaque, const uint8_t* data, size_t length) { static_cast<RtpBatch*>(opaque)->push(data, length); },
+        nullptr,
+        nullptr};
+    std::unique_ptr<Aggregator> aggregator;
+    if (wifi)
+    {
+        try
+        {
+            aggregator = std::make_unique<AggregatorInProcess>(&sink, opts.keyPath, 0, (opts.linkId << 8) + opts.radioPort);
+        }
+        catch (const std::exception& e)
+        {
+            fprintf(stderr, "Cannot create aggregator: %s\n", e.what());
+            return 1;
+        }
+    }
+#else
+    if (wifi)
+    {
+        fprintf(stderr, "wfb captures need the wfb-ng and devourer submodules, rebuild after checking them out\n");
+        return 1;
+    }
+#endif
+
+    uint64_t packets = 0, bytes = 0, matched = 0;
+    const auto start = Clock::now();
+    for (int loop = 0; loop < opts.loops; ++loop)
+    {
+        const auto& records = pcap->records();
+        if (records.empty()) break;
+        const uint64_t   firstTs   = records.front().timestampNs;
+        const auto       loopStart = Clock::now();
+        for (const auto& record : records)
+        {
+            if (opts.realtime)
+            {
+                const auto offset = std::chrono::nanoseconds(
+                    static_cast<int64_t>((record.timestampNs - std::min(firstTs, record.timestampNs)) / opts.speed));
+                std::this_thread::sleep_until(loopStart + offset);
+            }
+            packets++;
+            bytes += record.data.size();
+            const auto t0 = Clock::now();
+
+            if (wifi)
+            {
+                const auto frame = extractWifi(pcap->linkType(), record.data);
+                const bool video = frame && matcher.classify(frame->data) == 0;
+                const auto t1    = Clock::now();
+                classifyLatency.add(t1 - t0);
+                if (!video) continue;
+                matched++;
+#ifdef PIXELPILOT_HAVE_WFBNG
+                uint8_t        antenna[4] = {1, 1, 1, 1};
+                int8_t         rssi[4]    = {1, 1, 1, 1};
+                int8_t         noise[4]   = {1, 1, 1, 1};
+                const uint8_t* payload    = frame->data.data() + ChannelMatcher<1>::HEADER_SIZE;
+                const size_t   payloadSize =
+                    frame->data.size() - ChannelMatcher<1>::HEADER_SIZE - (frame->hasFcs ? ChannelMatcher<1>::FCS_SIZE : 0);
+                aggregator->process_packet(payload, payloadSize, 0, antenna, rssi, noise, 0, 0, 0, NULL);
+#endif
+                const auto t2 = Clock::now();
+                aggregateLatency.add(t2 - t1);
+                for (const auto& rtp : rtpBatch.packets())
+                {
+                    parseRtp(rtp.data(), rtp.size());
+                }
+                rtpCount += rtpBatch.packets().size();
+                parser.releasePacketReferences();
+                rtpBatch.clear();
+                const auto t3 = Clock::now();
+                parseLatency.add(t3 - t2);
+                totalLatency.add(t3 - t0);
+            }
+            else
+            {
+                const auto rtp = extractUdp(pcap->linkType(), record.data, opts.udpPort);
+                if (!rtp) continue;
+                matched++;
+                rtpCount++;
+                // The capture stays in memory for the whole run
+                parseRtp(rtp->data(), rtp->size());
+                const auto t1 = Clock::now();
+                parseLatency.add(t1 - t0);
+                totalLatency.add(t1 - t0);
+            }
+        }
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    printf(
+        "%s: link type %u, %s mode, %s%s\n",
+        opts.path.c_str(),
+        pcap->linkType(),
+        wifi ? "wfb" : "plain",
+        opts.realtime ? "real-time" : "max speed",
+        opts.zeroCopy ? ", zero-copy NALU assembly" : "");
+    printf(
+        "  packets %llu (%llu matched), %.3f s, %.0f packets/s, %.2f MB/s\n",
+        static_cast<unsigned long long>(packets),
+        static_cast<unsigned long long>(matched),
+        seconds,
+        packets / seconds,
+        bytes / seconds / 1e6);
+    printf(
+        "  rtp %zu, nalus %llu (%llu keyframes, %llu bytes), %.0f NALUs/s\n",
+        rtpCount,
+        static_cast<unsigned long long>(nalus),
+        static_cast<unsigned long long>(keyframes),
+        static_cast<unsigned long long>(naluBytes),
+        nalus / seconds);
+    printf(
+        "  pictures %llu, decoder input buffers %llu (%.2f per picture)\n",
+        static_cast<unsigned long long>(pictures),
+        static_cast<unsigned long long>(codecBuffers),
+        pictures ? static_cast<double>(codecBuffers) / pictures : 0.0);
+    const LossTracker& loss = parser.getLossTracker();
+    printf(
+        "  loss: %ld packets, %ld damaged pictures, %ld NALUs dropped, %ld keyframe requests, %ld recoveries\n",
+        loss.nLostPackets,
+        loss.nDamagedPictures,
+        loss.nDroppedNALUs,
+        loss.nKeyframeRequests,
+        loss.nRecoveries);
+#ifdef PIXELPILOT_HAVE_WFBNG
+    if (aggregator)
+    {
+        printf(
+            "  wfb: %u data, %u decrypt errors, %u fec recovered, %u lost\n",
+            static_cast<unsigned>(aggregator->count_p_all),
+            static_cast<unsigned>(aggregator->count_p_dec_err),
+            static_cast<unsigned>(aggregator->count_p_fec_recovered),
+            static_cast<unsigned>(aggregator->count_p_lost));
+    }
+#endif
+    printf("Latency per stage:\n");
+    classifyLatency.print();
+    aggregateLatency.print();
+    parseLatency.print();
+    totalLatency.print();
+    naluLatency.print();
+    return 0;
+}
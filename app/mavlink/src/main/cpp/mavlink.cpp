@@ -319,6 +319,8 @@ void *listen(int mavlink_port) {
     return 0;
 }
 
+// JNI glue, not part of the host build
+#ifdef __ANDROID__
 extern "C"
 JNIEXPORT void JNICALL
 Java_com_openipc_mavlink_MavlinkNative_nativeCallBack(JNIEnv *env, jclass clazz,
@@ -386,3 +388,4 @@ JNIEXPORT void JNICALL
 Java_com_openipc_mavlink_MavlinkNative_nativeStop(JNIEnv *env, jclass clazz, jobject context) {
     mavlink_thread_signal++;
 }
+#endif // __ANDROID__
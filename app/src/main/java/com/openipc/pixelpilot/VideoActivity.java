@@ -329,6 +329,24 @@ public class VideoActivity extends AppCompatActivity implements IVideoParamsChan
         }
     }
 
+    /**
+     * Hands video from wfb-ng to the player in-process, UDP 5600 is kept as fallback.
+     * The sink belongs to the native player: attached while the player runs, detached before it is stopped.
+     */
+    private void attachInProcessVideo() {
+        SharedPreferences prefs = getSharedPreferences("general", MODE_PRIVATE);
+        if (prefs.getBoolean("in_process_video", true)) {
+            wfbLink.setVideoSink(videoPlayer.getInProcessSink());
+        }
+    }
+
+    /**
+     * Back to UDP. When this returns wfb-ng no longer references the player's sink.
+     */
+    private void detachInProcessVideo() {
+        wfbLink.setVideoSink(0);
+    }
+
     /**
      * Configures the UI for VR mode by attaching callbacks to the left and right SurfaceViews.
      */
@@ -1115,6 +1133,7 @@ public class VideoActivity extends AppCompatActivity implements IVideoParamsChan
                 startDvr(dvrUri);
             } else {
                 wfbLinkManager.stopAdapters();
+                detachInProcessVideo();
                 videoPlayer.stop();
                 videoPlayer.stopAudio();
 
@@ -1324,6 +1343,7 @@ public class VideoActivity extends AppCompatActivity implements IVideoParamsChan
 
         unregisterReceivers();
 
+        detachInProcessVideo();
         videoPlayer.stop();
         videoPlayer.stopAudio();
         wfbLinkManager.stopAdapters();
@@ -1341,6 +1361,7 @@ public class VideoActivity extends AppCompatActivity implements IVideoParamsChan
         handler.removeCallbacks(runnable);
         unregisterReceivers();
         wfbLinkManager.stopAdapters();
+        detachInProcessVideo();
         videoPlayer.stop();
         videoPlayer.stopAudio();
         super.onStop();
@@ -1359,6 +1380,7 @@ public class VideoActivity extends AppCompatActivity implements IVideoParamsChan
         wfbLinkManager.startAdapters();
         videoPlayer.start();
         videoPlayer.startAudio();
+        attachInProcessVideo();
 
         osdManager.restoreOSDConfig();
 
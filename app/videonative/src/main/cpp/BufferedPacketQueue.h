@@ -4,21 +4,17 @@
 #include <cassert>
 #include <cstdio>
 #endif
-#include <algorithm>
+#include <chrono>
 #include <cstdarg>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <limits>
-
-#include <unordered_map>
+#include <type_traits>
 #include <vector>
 
-// Define logging tag and maximum buffer size
+// Define logging tag
 #define BUFFERED_QUEUE_LOG_TAG "BufferedPacketQueue"
-// Considering the packet rate about 100 packets per second, 10 packets should be enough
-constexpr size_t MAX_BUFFER_SIZE = 15;
-// Number of monotonically increasing packets
-constexpr size_t MONOTONIC_THRESHOLD = 5;
 
 // Type definition for sequence numbers
 using SeqType   = uint16_t;
@@ -27,114 +23,267 @@ using SignedSeq = std::make_signed_t<SeqType>;
 /**
  * @brief BufferedPacketQueue class handles packet processing with sequence numbers,
  *        ensuring in-order delivery and buffering out-of-order packets.
+ *
+ * Out-of-order packets are copied into a fixed ring of preallocated slots indexed by seq % capacity, nothing is
+ * allocated after construction. In-order packets are handed to the callback straight from the caller's buffer.
+ *
+ * A gap (missing packet) is given up on when
+ * - the packet waiting longest for it has been held for maxLatencyMs,
+ * - a whole frame behind it is complete: its marker packet arrived and all packets back to the end of the previous
+ *   frame (different RTP timestamp) are there. The missing packets then belong to older frames, which are not worth
+ *   delaying a complete picture for,
+ * - a packet arrives that is capacity or more ahead of it.
+ * Packets arriving after their gap was given up on are dropped as late. The deadline is checked whenever a packet
+ * arrives; when none does, the owner has to call poll() by nextDeadlineMs() for the held packets to go out in time.
+ *
+ * Each packet may carry its receive time, which is handed back along with it to callbacks taking
+ * (data, length, receive time), so latency statistics can start at the socket / radio instead of here.
  */
 class BufferedPacketQueue
 {
   public:
+    // Longest time a received packet is held back waiting for a missing predecessor
+    static constexpr uint32_t DEFAULT_MAX_LATENCY_MS = 20;
+    // Number of ring slots, i.e. the widest sequence gap that can be bridged. Rounded up to a power of two so
+    // seq % capacity stays continuous across the uint16 wrap
+    static constexpr size_t DEFAULT_CAPACITY = 128;
+    // Biggest packet that can be buffered (bigger ones are delivered right away, giving up on any gap before them)
+    static constexpr size_t SLOT_SIZE = 2048;
+    // Packets further back than this are taken as the sender restarting its sequence numbers, not as late ones
+    static constexpr size_t MAX_LATE_DISTANCE = 1024;
+
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    // nextDeadlineMs() while nothing is held back
+    static constexpr uint64_t NO_DEADLINE = std::numeric_limits<uint64_t>::max();
+
+    struct Stats
+    {
+        // Packets that had to be buffered
+        uint64_t reordered = 0;
+        // Packets dropped because their sequence number was already delivered or given up on
+        uint64_t late = 0;
+        uint64_t duplicates = 0;
+        // Sequence numbers given up on
+        uint64_t lost = 0;
+        // Gaps given up on because of the latency deadline / a complete frame behind them / the ring being too small
+        uint64_t deadlineReleases = 0;
+        uint64_t frameReleases    = 0;
+        uint64_t overflowReleases = 0;
+    };
+
     /**
      * @brief Constructs a BufferedPacketQueue instance.
+     * @param maxLatencyMs Latency deadline for out-of-order packets.
+     * @param capacity Number of preallocated packet slots (rounded up to a power of two).
      */
-    BufferedPacketQueue() : mFirstPacket(true), mLastPacketIdx(0), mMonotonicOutOfOrderIncreaseCount(0) {}
+    explicit BufferedPacketQueue(uint32_t maxLatencyMs = DEFAULT_MAX_LATENCY_MS, size_t capacity = DEFAULT_CAPACITY)
+        : mMaxLatencyMs(maxLatencyMs),
+          mCapacity(roundUpToPowerOfTwo(capacity)),
+          mSlots(mCapacity),
+          mArena(mCapacity * SLOT_SIZE)
+    {
+    }
 
     /**
-     * @brief Processes an incoming packet based on its sequence index.
+     * @brief Processes an incoming packet based on its sequence index, without frame awareness (only the latency
+     *        deadline and the ring size release gaps).
      * @tparam Callback A callable type that processes the packet data.
      * @param currPacketIdx Sequence index of the incoming packet.
      * @param data Pointer to the packet data.
      * @param data_length Size of the packet data.
      * @param callback Callable to handle processed packets.
+     * @param rxTime Receive time of the packet, only passed through to the callback.
      */
     template <typename Callback>
-    void processPacket(SeqType currPacketIdx, const uint8_t* data, std::size_t data_length, Callback& callback)
+    void processPacket(
+        SeqType currPacketIdx, const uint8_t* data, std::size_t data_length, Callback& callback, TimePoint rxTime = {})
     {
-        logDebug(
-            "Processing packet with Sequence=%u, lastPacketIdx=%u, firstPacket=%s",
-            currPacketIdx,
-            mLastPacketIdx,
-            mFirstPacket ? "true" : "false");
+        processPacket(currPacketIdx, 0, false, data, data_length, callback, steadyTimeMs(), rxTime);
+    }
 
-        if (isFirstPacket(currPacketIdx))
+    /**
+     * @brief Processes an incoming packet based on its sequence index and RTP frame information.
+     * @tparam Callback A callable type that processes the packet data.
+     * @param currPacketIdx Sequence index of the incoming packet.
+     * @param timestamp RTP timestamp of the incoming packet, identical for all packets of one frame.
+     * @param marker RTP marker bit of the incoming packet, set on the last packet of a frame.
+     * @param data Pointer to the packet data.
+     * @param data_length Size of the packet data.
+     * @param callback Callable to handle processed packets.
+     * @param nowMs Arrival time on a monotonic millisecond clock, the steady clock by default.
+     * @param rxTime Receive time of the packet (e.g. kernel timestamp), only passed through to the callback.
+     */
+    template <typename Callback>
+    void processPacket(
+        SeqType        currPacketIdx,
+        uint32_t       timestamp,
+        bool           marker,
+        const uint8_t* data,
+        std::size_t    data_length,
+        Callback&      callback,
+        uint64_t       nowMs  = steadyTimeMs(),
+        TimePoint      rxTime = {})
+    {
+        if (mFirstPacket)
         {
-            handleFirstPacket(currPacketIdx);
-            // Continue processing the first packet
-            processInOrderPacket(currPacketIdx, data, data_length, callback);
-            processBufferedPackets(callback);
-            return;
+            mNextPacketIdx = currPacketIdx;
+            mFirstPacket   = false;
         }
 
-        if (isNextExpectedPacket(currPacketIdx))
+        SignedSeq dist = calculateDistance(mNextPacketIdx, currPacketIdx);
+        if (dist < 0)
         {
-            // In-order packet
-            processInOrderPacket(currPacketIdx, data, data_length, callback);
-            processBufferedPackets(callback);
-            // Reset monotonic increase counter after in-order packet
-            mMonotonicOutOfOrderIncreaseCount = 0;
+            if (static_cast<size_t>(-dist) <= MAX_LATE_DISTANCE)
+            {
+                // Already delivered, or its gap was given up on
+                mStats.late++;
+                return;
+            }
+            // Too far back to be a late packet, the sender restarted its sequence numbers
+            logWarning("Sequence jumped back from %u to %u. Restarting.", mNextPacketIdx, currPacketIdx);
+            releaseAll(callback);
+            mNextPacketIdx = currPacketIdx;
+            dist           = 0;
         }
-        else
+
+        if (dist > 0 && (static_cast<size_t>(dist) >= mCapacity || data_length > SLOT_SIZE))
         {
-            // Out-of-order packet
-            handleOutOfOrderPacket(currPacketIdx, data, data_length, callback);
+            // Cannot hold it back: give up on whatever is missing before it
+            mStats.overflowReleases++;
+            releaseUpTo(data_length > SLOT_SIZE ? currPacketIdx : currPacketIdx - static_cast<SeqType>(mCapacity - 1),
+                        callback);
+            dist = calculateDistance(mNextPacketIdx, currPacketIdx);
         }
-    }
-
-  private:
-    bool    mFirstPacket;
-    SeqType mLastPacketIdx;
 
-    std::unordered_map<SeqType, std::vector<uint8_t>> mPackets;
+        if (dist == 0)
+        {
+            deliver(callback, data, data_length, rxTime);
+            mNextPacketIdx++;
+            processBufferedPackets(callback);
+        }
+        else if (!bufferPacket(currPacketIdx, timestamp, marker, data, data_length, nowMs, rxTime))
+        {
+            mStats.duplicates++;
+            return;
+        }
+        else if (marker && isFrameComplete(currPacketIdx))
+        {
+            mStats.frameReleases++;
+            releaseUpTo(currPacketIdx + 1, callback);
+        }
 
-    // This variable is used to track a situation where the sequence number is increasing monotonically while packets
-    // are out of order. if this counter reaches MONOTONIC_THRESHOLD, we will restart buffering and update lastPacketIdx
-    // to the highest sequence index received.
-    size_t mMonotonicOutOfOrderIncreaseCount;
+        releaseExpired(callback, nowMs);
+    }
 
     /**
-     * @brief Determines if the incoming packet is the first packet.
-     * @param currPacketIdx Sequence index of the incoming packet.
-     * @return True if it's the first packet; otherwise, false.
+     * @brief Gives up on the gaps whose latency deadline passed without a packet arriving.
+     * @tparam Callback A callable type that processes the packet data.
+     * @param callback Callable to handle processed packets.
+     * @param nowMs Current time on the clock the packets' arrival times were taken with.
      */
-    bool isFirstPacket(SeqType currPacketIdx) const { return mFirstPacket; }
+    template <typename Callback>
+    void poll(Callback& callback, uint64_t nowMs = steadyTimeMs())
+    {
+        releaseExpired(callback, nowMs);
+    }
+
+    // When poll() has to be called next, NO_DEADLINE if no packet is held back
+    uint64_t nextDeadlineMs() const { return mBuffered > 0 ? mOldestArrivalMs + mMaxLatencyMs : NO_DEADLINE; }
 
     /**
-     * @brief Handles the first packet by initializing the lastPacketIdx.
-     * @param currPacketIdx Sequence index of the first packet.
+     * @brief Delivers all buffered packets in order, giving up on any gaps between them, and forgets the stream.
+     * @tparam Callback A callable type that processes the packet data.
+     * @param callback Callable to handle processed packets.
      */
-    void handleFirstPacket(SeqType currPacketIdx)
+    template <typename Callback>
+    void flush(Callback& callback)
     {
-        mLastPacketIdx = currPacketIdx - 1;
-        mFirstPacket   = false;
-        logDebug("First packet received. Initialized lastPacketIdx to %u", mLastPacketIdx);
+        releaseAll(callback);
+        mFirstPacket = true;
+    }
+
+    // Number of packets currently held back
+    size_t size() const { return mBuffered; }
+
+    size_t capacity() const { return mCapacity; }
+
+    const Stats& getStats() const { return mStats; }
+
+    static uint64_t steadyTimeMs()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+  private:
+    struct Slot
+    {
+        bool     used = false;
+        bool     marker = false;
+        SeqType  seq = 0;
+        uint32_t timestamp = 0;
+        uint16_t size = 0;
+        uint64_t arrivalMs = 0;
+        TimePoint rxTime;
+    };
+
+    const uint32_t       mMaxLatencyMs;
+    const size_t         mCapacity;
+    std::vector<Slot>    mSlots;
+    std::vector<uint8_t> mArena;
+
+    bool    mFirstPacket = true;
+    // Oldest sequence number not delivered yet. Whenever packets are buffered, this one is missing
+    SeqType mNextPacketIdx = 0;
+    size_t  mBuffered      = 0;
+    // Arrival time of the packet waiting longest, valid while mBuffered > 0
+    uint64_t mOldestArrivalMs = 0;
+    Stats    mStats;
+
+    Slot& slotFor(SeqType seq) { return mSlots[seq & (mCapacity - 1)]; }
+
+    const Slot& slotFor(SeqType seq) const { return mSlots[seq & (mCapacity - 1)]; }
+
+    uint8_t* slotData(SeqType seq) { return mArena.data() + (seq & (mCapacity - 1)) * SLOT_SIZE; }
+
+    bool isBuffered(SeqType seq) const
+    {
+        const Slot& slot = slotFor(seq);
+        return slot.used && slot.seq == seq;
     }
 
     /**
-     * @brief Checks if the incoming packet is the next expected in order.
-     * @param currPacketIdx Sequence index of the incoming packet.
-     * @return True if it's the next expected packet; otherwise, false.
+     * @brief Buffers an out-of-order packet.
+     * @return False if the packet is a duplicate of one already buffered.
      */
-    bool isNextExpectedPacket(SeqType currPacketIdx) const
+    bool bufferPacket(
+        SeqType currPacketIdx, uint32_t timestamp, bool marker, const uint8_t* data, std::size_t data_length,
+        uint64_t nowMs, TimePoint rxTime)
     {
-        return currPacketIdx == static_cast<SeqType>(mLastPacketIdx + 1);
+        Slot& slot = slotFor(currPacketIdx);
+        if (slot.used) return false;
+        std::memcpy(slotData(currPacketIdx), data, data_length);
+        slot = {true, marker, currPacketIdx, timestamp, static_cast<uint16_t>(data_length), nowMs, rxTime};
+        if (mBuffered++ == 0 || nowMs < mOldestArrivalMs) mOldestArrivalMs = nowMs;
+        mStats.reordered++;
+        return true;
     }
 
     /**
-     * @brief Processes an in-order packet by invoking the callback and updating state.
-     * @tparam Callback A callable type that processes the packet data.
-     * @param currPacketIdx Sequence index of the packet.
-     * @param data Pointer to the packet data.
-     * @param data_length Size of the packet data.
-     * @param callback Callable to handle processed packets.
+     * @brief Checks whether the frame ending with the (buffered) marker packet is complete, i.e. all packets back to
+     *        the last one of the previous frame are buffered.
      */
-    template <typename Callback>
-    void processInOrderPacket(SeqType currPacketIdx, const uint8_t* data, std::size_t data_length, Callback& callback)
+    bool isFrameComplete(SeqType markerIdx) const
     {
-        logDebug("In-order packet detected. Processing immediately.");
-
-        // in-order packet receiver which means we restart tracking out of order monotonic increases
-        mMonotonicOutOfOrderIncreaseCount = 0;
-
-        callback(data, data_length);
-        mLastPacketIdx = currPacketIdx;
-        logDebug("Updated lastPacketIdx to %u", mLastPacketIdx);
+        const uint32_t timestamp = slotFor(markerIdx).timestamp;
+        // Terminates at mNextPacketIdx at the latest, which is missing while packets are buffered
+        for (SeqType idx = markerIdx - 1;; --idx)
+        {
+            if (!isBuffered(idx)) return false;
+            if (slotFor(idx).timestamp != timestamp) return true;
+        }
     }
 
     /**
@@ -145,163 +294,104 @@ class BufferedPacketQueue
     template <typename Callback>
     void processBufferedPackets(Callback& callback)
     {
-        while (true)
+        if (mBuffered == 0 || !isBuffered(mNextPacketIdx)) return;
+        while (isBuffered(mNextPacketIdx))
         {
-            SeqType nextIdx = mLastPacketIdx + 1;
-            auto    it      = mPackets.find(nextIdx);
-            if (it != mPackets.end())
-            {
-                logDebug("Found buffered packet with Sequence=%u. Processing.", it->first);
-                callback(it->second.data(), it->second.size());
-                mLastPacketIdx = it->first;
-                logDebug("Updated lastPacketIdx to %u after processing buffered packet.", mLastPacketIdx);
-                mPackets.erase(it);
-            }
-            else
-            {
-                logDebug("No buffered packet found for Sequence=%u.", nextIdx);
-                break;
-            }
+            deliverBuffered(mNextPacketIdx, callback);
+            mNextPacketIdx++;
         }
+        updateOldestArrival();
     }
 
     /**
-     * @brief Handles out-of-order packets by buffering or ignoring based on distance and monotonic increases.
+     * @brief Gives up on all missing packets before end and delivers the buffered ones in order.
      * @tparam Callback A callable type that processes the packet data.
-     * @param currPacketIdx Sequence index of the incoming packet.
-     * @param data Pointer to the packet data.
-     * @param data_length Size of the packet data.
+     * @param end First sequence number not released.
      * @param callback Callable to handle processed packets.
      */
     template <typename Callback>
-    void handleOutOfOrderPacket(SeqType currPacketIdx, const uint8_t* data, std::size_t data_length, Callback& callback)
+    void releaseUpTo(SeqType end, Callback& callback)
     {
-        logDebug("Out-of-order packet detected. Sequence=%u", currPacketIdx);
-
-        if (isDuplicatePacket(currPacketIdx))
+        while (mNextPacketIdx != end)
         {
-            logWarning("Duplicate packet received with Sequence=%u. ", currPacketIdx);
-            // return;
-        }
-
-        bufferPacket(currPacketIdx, data, data_length);
-
-        auto dist = calculateDistance(currPacketIdx, mLastPacketIdx);
-        if (std::abs(dist) < MONOTONIC_THRESHOLD)
-        {
-            // Check for monotonic increases
-            if (dist > 0)
+            if (mBuffered == 0)
+            {
+                mStats.lost += static_cast<SeqType>(end - mNextPacketIdx);
+                mNextPacketIdx = end;
+                break;
+            }
+            if (isBuffered(mNextPacketIdx))
             {
-                mMonotonicOutOfOrderIncreaseCount++;
-                logDebug("Monotonic increase count: %zu", mMonotonicOutOfOrderIncreaseCount);
-                if (mMonotonicOutOfOrderIncreaseCount >= MONOTONIC_THRESHOLD)
-                {
-                    restartBuffering(callback, currPacketIdx);
-                    // Update lastPacketIdx to the highest sequence index received
-                    SeqType newLastIdx = currPacketIdx;
-                    logWarning("Monotonic threshold reached. Updating lastPacketIdx to %u", newLastIdx);
-                }
+                deliverBuffered(mNextPacketIdx, callback);
             }
             else
             {
-                // Reset the counter if a non-increasing packet is received
-                mMonotonicOutOfOrderIncreaseCount = 0;
-                logDebug("Non-increasing packet received. Resetting monotonic increase count.");
+                mStats.lost++;
             }
+            mNextPacketIdx++;
         }
-        // If buffer size exceeds MAX_BUFFER_SIZE, handle buffer overflow
-        if (mPackets.size() >= MAX_BUFFER_SIZE)
-        {
-            logWarning(
-                "Buffer size exceeded MAX_BUFFER_SIZE (%zu). Processing in-order buffered packets.", MAX_BUFFER_SIZE);
-            restartBuffering(callback, currPacketIdx);
-        }
+        logDebug("Released up to Sequence=%u, %zu packets still buffered", end, mBuffered);
+        processBufferedPackets(callback);
     }
 
     /**
-     * @brief Checks if the incoming packet is a duplicate.
-     * @param currPacketIdx Sequence index of the incoming packet.
-     * @return True if the packet is a duplicate; otherwise, false.
-     */
-    bool isDuplicatePacket(SeqType currPacketIdx) const { return mPackets.find(currPacketIdx) != mPackets.end(); }
-
-    /**
-     * @brief Buffers an out-of-order packet.
-     * @param currPacketIdx Sequence index of the incoming packet.
-     * @param data Pointer to the packet data.
-     * @param data_length Size of the packet data.
+     * @brief Delivers all buffered packets in order, without counting the gaps between them as lost.
      */
-    void bufferPacket(SeqType currPacketIdx, const uint8_t* data, std::size_t data_length)
+    template <typename Callback>
+    void releaseAll(Callback& callback)
     {
-        mPackets[currPacketIdx] = std::vector<uint8_t>(data, data + data_length);
-        logDebug("Buffered out-of-order packet. Buffer size: %zu", mPackets.size());
+        while (mBuffered > 0)
+        {
+            if (isBuffered(mNextPacketIdx)) deliverBuffered(mNextPacketIdx, callback);
+            mNextPacketIdx++;
+        }
     }
 
     /**
-     * @brief Handles buffer overflow by processing in-order packets and discarding others.
-     * @tparam Callback A callable type that processes the packet data.
-     * @param callback Callable to handle processed packets.
+     * @brief Gives up on gaps as long as the packets behind them have waited for longer than the latency deadline.
      */
     template <typename Callback>
-    void restartBuffering(Callback& callback, SeqType currPacketIdx)
+    void releaseExpired(Callback& callback, uint64_t nowMs)
     {
-        // Process as many in-order buffered packets as possible
-        processBufferedPackets(callback);
-
-        if (!mPackets.empty())
+        while (mBuffered > 0 && nowMs - mOldestArrivalMs >= mMaxLatencyMs)
         {
-            logWarning("Processing %zu buffered packets that might be out of order.", mPackets.size());
-
-            // Create a vector of iterators to the map elements
-            std::vector<std::unordered_map<uint16_t, std::vector<uint8_t>>::const_iterator> sortedPackets;
-            sortedPackets.reserve(mPackets.size());
-
-            // Populate the vector with iterators to the map elements
-            for (auto it = mPackets.cbegin(); it != mPackets.cend(); ++it)
-            {
-                sortedPackets.push_back(it);
-            }
-
-            // Sort the vector based on the keys
-            std::sort(
-                sortedPackets.begin(),
-                sortedPackets.end(),
-                [](const auto& a, const auto& b) { return a->first < b->first; });
-
-            // Iterate over the sorted packets and invoke the callback
-            for (const auto& it : sortedPackets)
-            {
-                const auto& packet = it->second;
-                logDebug("Processing possibly out-of-order buffered packet with Sequence=%u.", it->first);
-                callback(packet.data(), packet.size());
-            }
+            mStats.deadlineReleases++;
+            SeqType end = mNextPacketIdx;
+            while (!isBuffered(end)) end++;
+            releaseUpTo(end, callback);
+        }
+    }
 
-            mPackets.clear();
-            // Reset the monotonic increase counter
-            mMonotonicOutOfOrderIncreaseCount = 0;
+    template <typename Callback>
+    static void deliver(Callback& callback, const uint8_t* data, std::size_t data_length, TimePoint rxTime)
+    {
+        if constexpr (std::is_invocable_v<Callback&, const uint8_t*, std::size_t, TimePoint>)
+        {
+            callback(data, data_length, rxTime);
+        }
+        else
+        {
+            callback(data, data_length);
         }
-        mLastPacketIdx = currPacketIdx;
     }
 
-    /**
-     * @brief Compares two sequence numbers considering wrap-around.
-     * @param a First sequence number.
-     * @param b Second sequence number.
-     * @return True if sequence a is less than b, accounting for wrap-around.
-     */
-    bool seqLessThan(SeqType a, SeqType b) const
+    template <typename Callback>
+    void deliverBuffered(SeqType seq, Callback& callback)
     {
-        bool result = calculateDistance(a, b) > 0;
-        logDebug("seqLessThan: a=%u, b=%u, result=%s", a, b, result ? "true" : "false");
-        return result;
+        Slot& slot = slotFor(seq);
+        deliver(callback, slotData(seq), static_cast<std::size_t>(slot.size), slot.rxTime);
+        slot.used = false;
+        mBuffered--;
     }
 
-    template <typename T>
-    typename std::make_signed<T>::type to_signed(T value)
+    void updateOldestArrival()
     {
-        static_assert(std::is_unsigned<T>::value, "Type must be unsigned");
-        using SignedType = typename std::make_signed<T>::type;
-        return static_cast<SignedType>(value);
+        if (mBuffered == 0) return;
+        mOldestArrivalMs = std::numeric_limits<uint64_t>::max();
+        for (const Slot& slot : mSlots)
+        {
+            if (slot.used && slot.arrivalMs < mOldestArrivalMs) mOldestArrivalMs = slot.arrivalMs;
+        }
     }
 
     /**
@@ -310,9 +400,13 @@ class BufferedPacketQueue
      * @param to Destination sequence number.
      * @return The distance from 'from' to 'to'.
      */
-    static std::make_signed<SeqType>::type calculateDistance(SeqType a, SeqType b)
+    static SignedSeq calculateDistance(SeqType from, SeqType to) { return static_cast<SignedSeq>(to - from); }
+
+    static size_t roundUpToPowerOfTwo(size_t value)
     {
-        return static_cast<std::make_signed<SeqType>::type>(b - a);
+        size_t result = 1;
+        while (result < value && result < (size_t{1} << 15)) result <<= 1;
+        return result;
     }
 
     /**
@@ -0,0 +1,163 @@
+//
+// Receives up to a batch of datagrams per recvmmsg() syscall into preallocated buffers.
+// Shared by UDPReceiver and UDSReceiver.
+//
+
+#ifndef PIXELPILOT_DATAGRAMBATCH_H
+#define PIXELPILOT_DATAGRAMBATCH_H
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <time.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <vector>
+
+/**
+ * One datagram of a batch. data and source point into the DatagramBatch and stay valid until its next receive().
+ */
+struct ReceivedDatagram
+{
+    const uint8_t*  data;
+    size_t          size;
+    const sockaddr* source;
+    socklen_t       sourceLen;
+    // When the kernel received it if SO_TIMESTAMPNS is enabled on the socket, else when receive() returned
+    std::chrono::steady_clock::time_point rxTime;
+};
+
+/**
+ * @brief Fixed set of batchSize receive buffers (maxDatagramSize bytes each) plus the recvmmsg() bookkeeping.
+ *
+ * receive() blocks until at least one datagram arrived (MSG_WAITFORONE), then also takes whatever else is already
+ * queued on the socket, without waiting for more. A quiet stream therefore costs one syscall per datagram like
+ * recvfrom(), a busy one (or a receiver thread that got scheduled out for a moment) one per batch.
+ *
+ * Nothing is allocated after construction. The buffers are not initialized, so only the pages datagrams actually
+ * get written to become resident.
+ *
+ * Kernel receive timestamps (SO_TIMESTAMPNS, CLOCK_REALTIME) are converted to the steady clock, so they can be compared
+ * with the rest of the pipeline. That is off by however much the wall clock was stepped between receiving and now.
+ */
+class DatagramBatch
+{
+  public:
+    DatagramBatch(size_t batchSize, size_t maxDatagramSize)
+        : mMaxDatagramSize(maxDatagramSize),
+          mBuffers(new uint8_t[batchSize * maxDatagramSize]),
+          mIovecs(batchSize),
+          mSources(batchSize),
+          mHeaders(batchSize),
+          mControl(batchSize * CONTROL_SIZE),
+          mDatagrams(batchSize)
+    {
+        for (size_t i = 0; i < batchSize; ++i)
+        {
+            mIovecs[i]                         = {mBuffers.get() + i * maxDatagramSize, maxDatagramSize};
+            mHeaders[i].msg_hdr.msg_iov        = &mIovecs[i];
+            mHeaders[i].msg_hdr.msg_iovlen     = 1;
+            mHeaders[i].msg_hdr.msg_name       = &mSources[i];
+            mHeaders[i].msg_hdr.msg_namelen    = sizeof(sockaddr_storage);
+            mHeaders[i].msg_hdr.msg_control    = mControl.data() + i * CONTROL_SIZE;
+            mHeaders[i].msg_hdr.msg_controllen = CONTROL_SIZE;
+        }
+    }
+
+    DatagramBatch(const DatagramBatch&)            = delete;
+    DatagramBatch& operator=(const DatagramBatch&) = delete;
+
+    /**
+     * @brief Blocking receive of 1..batch size datagrams from fd, or with flags = MSG_DONTWAIT whatever is queued.
+     * @return Number of (non-empty) datagrams received, 0 if there were none (e.g. the socket was shut down), -1 on
+     *         error (errno is set, EAGAIN if there was nothing to receive with MSG_DONTWAIT).
+     */
+    int receive(int fd, int flags = MSG_WAITFORONE)
+    {
+        nSyscalls++;
+        const int n = recvmmsg(fd, mHeaders.data(), static_cast<unsigned int>(mHeaders.size()), flags, nullptr);
+        mCount      = 0;
+        if (n <= 0) return n < 0 ? -1 : 0;
+        const auto steadyNow = std::chrono::steady_clock::now();
+        timespec   realtimeNow{};
+        clock_gettime(CLOCK_REALTIME, &realtimeNow);
+        for (int i = 0; i < n; ++i)
+        {
+            const mmsghdr& header = mHeaders[i];
+            // A shut down socket reports one empty message
+            if (header.msg_len == 0) continue;
+            if (header.msg_hdr.msg_flags & MSG_TRUNC) nTruncated++;
+            mDatagrams[mCount++] = {
+                static_cast<const uint8_t*>(mIovecs[i].iov_base),
+                header.msg_len,
+                reinterpret_cast<const sockaddr*>(&mSources[i]),
+                header.msg_hdr.msg_namelen,
+                kernelRxTime(header.msg_hdr, steadyNow, realtimeNow)};
+        }
+        for (int i = 0; i < n; ++i)
+        {
+            // recvmmsg overwrote the address and control lengths of the headers it filled
+            mHeaders[i].msg_hdr.msg_namelen    = sizeof(sockaddr_storage);
+            mHeaders[i].msg_hdr.msg_controllen = CONTROL_SIZE;
+        }
+        nDatagrams += mCount;
+        return static_cast<int>(mCount);
+    }
+
+    // Ask the kernel to timestamp every datagram received on fd, see ReceivedDatagram::rxTime
+    static bool enableTimestamps(int fd)
+    {
+        const int enable = 1;
+        return setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable)) == 0;
+    }
+
+    // The datagrams of the last receive()
+    std::span<const ReceivedDatagram> datagrams() const { return {mDatagrams.data(), mCount}; }
+
+    size_t batchSize() const { return mHeaders.size(); }
+
+    size_t maxDatagramSize() const { return mMaxDatagramSize; }
+
+  public:
+    long nSyscalls  = 0;
+    long nDatagrams = 0;
+    // Datagrams bigger than maxDatagramSize, cut off
+    long nTruncated = 0;
+
+  private:
+    // Room for one SCM_TIMESTAMPNS control message per datagram
+    static constexpr size_t CONTROL_SIZE = CMSG_SPACE(sizeof(timespec));
+
+    static std::chrono::steady_clock::time_point kernelRxTime(
+        const msghdr& header, const std::chrono::steady_clock::time_point steadyNow, const timespec& realtimeNow)
+    {
+        for (const cmsghdr* cmsg = CMSG_FIRSTHDR(&header); cmsg != nullptr;
+             cmsg                = CMSG_NXTHDR(const_cast<msghdr*>(&header), const_cast<cmsghdr*>(cmsg)))
+        {
+            if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_TIMESTAMPNS) continue;
+            timespec received;
+            std::memcpy(&received, CMSG_DATA(cmsg), sizeof(received));
+            const auto age = std::chrono::seconds(realtimeNow.tv_sec - received.tv_sec) +
+                             std::chrono::nanoseconds(realtimeNow.tv_nsec - received.tv_nsec);
+            // The wall clock may have been stepped back in between
+            return age.count() > 0 ? steadyNow - std::chrono::duration_cast<std::chrono::steady_clock::duration>(age)
+                                   : steadyNow;
+        }
+        return steadyNow;
+    }
+
+    const size_t                     mMaxDatagramSize;
+    const std::unique_ptr<uint8_t[]> mBuffers;
+    std::vector<iovec>               mIovecs;
+    std::vector<sockaddr_storage>    mSources;
+    std::vector<mmsghdr>             mHeaders;
+    std::vector<uint8_t>             mControl;
+    std::vector<ReceivedDatagram>    mDatagrams;
+    size_t                           mCount = 0;
+};
+
+#endif  // PIXELPILOT_DATAGRAMBATCH_H
@@ -0,0 +1,151 @@
+#include "DecoderProfiles.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include "helper/AndroidLogger.hpp"
+
+const std::vector<DecoderProfile>& decoderProfiles()
+{
+    static const std::vector<DecoderProfile> PROFILES = {
+        {"vendor-low-latency",
+         {{"low-latency", 1},
+          // MediaCodec supports two priorities: 0 - realtime, 1 - best effort
+          {"priority", 0},
+          {"vendor.low-latency.enable", 1},
+          {"vendor.qti-ext-dec-low-latency.enable", 1},
+          {"vendor.hisi-ext-low-latency-video-dec.video-scene-for-low-latency-req", 1},
+          {"vendor.rtc-ext-dec-low-latency.enable", 1}}},
+        {"low-latency", {{"low-latency", 1}, {"priority", 0}}},
+        {"realtime-priority", {{"priority", 0}}},
+        {"default", {}},
+    };
+    return PROFILES;
+}
+
+void DecoderProfileStore::setPath(std::string path)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mPath = std::move(path);
+    load();
+}
+
+int DecoderProfileStore::selected(const std::string& codecName) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    const auto                  it = mEntries.find(codecName);
+    return it == mEntries.end() ? -1 : it->second.selected;
+}
+
+int DecoderProfileStore::nextCandidate(const std::string& codecName, int from) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    const auto                  it     = mEntries.find(codecName);
+    const uint32_t              failed = it == mEntries.end() ? 0 : it->second.failed;
+    for (int i = from < 0 ? 0 : from; i < static_cast<int>(decoderProfiles().size()); ++i)
+    {
+        if (!(failed & (1u << i))) return i;
+    }
+    return -1;
+}
+
+void DecoderProfileStore::select(const std::string& codecName, int profile)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    Entry&                      entry = mEntries[codecName];
+    if (entry.selected == profile) return;
+    entry.selected           = profile;
+    entry.avgDecodingTime_ms = -1;
+    save();
+}
+
+void DecoderProfileStore::markFailed(const std::string& codecName, int profile)
+{
+    // Nothing to fall back to, whatever went wrong was not caused by the profile
+    if (profile < 0 || decoderProfiles()[profile].keys.empty()) return;
+    std::lock_guard<std::mutex> lock(mMutex);
+    markFailedLocked(mEntries[codecName], profile);
+}
+
+bool DecoderProfileStore::markStalled(const std::string& codecName, int profile)
+{
+    if (profile < 0 || decoderProfiles()[profile].keys.empty()) return false;
+    std::lock_guard<std::mutex> lock(mMutex);
+    Entry&                      entry = mEntries[codecName];
+    if (!(entry.stalled & (1u << profile)))
+    {
+        entry.stalled |= 1u << profile;
+        return false;
+    }
+    markFailedLocked(entry, profile);
+    return true;
+}
+
+void DecoderProfileStore::recordDecodingTime(const std::string& codecName, float avgDecodingTime_ms)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    Entry&                      entry = mEntries[codecName];
+    entry.avgDecodingTime_ms          = avgDecodingTime_ms;
+    if (entry.selected >= 0) entry.stalled &= ~(1u << entry.selected);
+    save();
+}
+
+void DecoderProfileStore::markFailedLocked(Entry& entry, int profile)
+{
+    entry.failed |= 1u << profile;
+    entry.stalled &= ~(1u << profile);
+    if (entry.selected == profile)
+    {
+        entry.selected           = -1;
+        entry.avgDecodingTime_ms = -1;
+    }
+    save();
+}
+
+float DecoderProfileStore::decodingTime(const std::string& codecName) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    const auto                  it = mEntries.find(codecName);
+    return it == mEntries.end() ? -1 : it->second.avgDecodingTime_ms;
+}
+
+void DecoderProfileStore::load()
+{
+    mEntries.clear();
+    if (mPath.empty()) return;
+    std::ifstream file(mPath);
+    std::string   line;
+    while (std::getline(file, line))
+    {
+        // <codec name> <selected profile> <failed profiles bit mask> <avg decoding time ms>
+        std::istringstream fields(line);
+        std::string        codecName;
+        Entry              entry;
+        if (!(fields >> codecName >> entry.selected >> entry.failed >> entry.avgDecodingTime_ms)) continue;
+        if (entry.selected >= static_cast<int>(decoderProfiles().size())) entry.selected = -1;
+        mEntries[codecName] = entry;
+    }
+    MLOGD << "Loaded decoder profiles for " << mEntries.size() << " decoders";
+}
+
+void DecoderProfileStore::save() const
+{
+    if (mPath.empty()) return;
+    // Written aside and renamed, a crash never leaves a truncated file behind
+    const std::string tmpPath = mPath + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::trunc);
+        for (const auto& [codecName, entry] : mEntries)
+        {
+            file << codecName << ' ' << entry.selected << ' ' << entry.failed << ' ' << entry.avgDecodingTime_ms
+                 << '\n';
+        }
+        if (!file)
+        {
+            MLOGE << "Cannot save decoder profiles to " << tmpPath;
+            return;
+        }
+    }
+    std::rename(tmpPath.c_str(), mPath.c_str());
+}
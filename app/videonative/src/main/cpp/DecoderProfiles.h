@@ -0,0 +1,90 @@
+//
+// Low-latency MediaCodec configuration profiles, and which one works best on which decoder.
+//
+
+#ifndef PIXELPILOT_DECODERPROFILES_H
+#define PIXELPILOT_DECODERPROFILES_H
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * A set of AMediaFormat int32 keys written when configuring the decoder. Unknown keys are usually ignored, but some
+ * decoders refuse to configure with them, or configure and then never output a frame.
+ */
+struct DecoderProfile
+{
+    const char*                                  name;
+    std::vector<std::pair<const char*, int32_t>> keys;
+};
+
+// Lowest latency first, the last one is the plain configuration
+const std::vector<DecoderProfile>& decoderProfiles();
+
+/**
+ * @brief Remembers per decoder (MediaCodec name, e.g. "c2.qti.avc.decoder") which profile to configure it with.
+ *
+ * A decoder without a selected profile is probed: profiles are tried lowest latency first, the first one the decoder
+ * configures with and decodes with is selected. Profiles that fail are remembered and skipped from then on, so the
+ * probing happens once per decoder, not on every start. A decoder that configures but outputs nothing may just have
+ * lost its key frame on the link, so a profile only fails after stalling twice in a row. The measured decode latency
+ * of the selected profile is kept for the logs.
+ *
+ * Persisted to a small text file (one line per decoder) if a path was set. Thread-safe.
+ */
+class DecoderProfileStore
+{
+  public:
+    // Number of frames the decode latency of a profile is averaged over
+    static constexpr long MEASURE_FRAMES = 120;
+
+    // Load the profiles saved at path (if any), and save there from now on
+    void setPath(std::string path);
+
+    // Profile to configure the decoder with, -1 if it has to be probed
+    int selected(const std::string& codecName) const;
+
+    // First profile at or after from that did not fail on this decoder, -1 if none is left
+    int nextCandidate(const std::string& codecName, int from) const;
+
+    void select(const std::string& codecName, int profile);
+
+    // The decoder refused the profile. Un-selects it, the plain profile never fails
+    void markFailed(const std::string& codecName, int profile);
+
+    // The decoder did not output a frame with the profile. Fails it (see markFailed()) if it stalled before without
+    // decoding in between, returns true then. The first stall is not persisted, the profile gets another try
+    bool markStalled(const std::string& codecName, int profile);
+
+    // Also clears a stall of the selected profile, it decodes
+    void recordDecodingTime(const std::string& codecName, float avgDecodingTime_ms);
+
+    // Of the selected profile, -1 if not measured yet
+    float decodingTime(const std::string& codecName) const;
+
+  private:
+    struct Entry
+    {
+        int      selected           = -1;
+        uint32_t failed             = 0;
+        float    avgDecodingTime_ms = -1;
+        // Profiles that stalled once since the last decoded frames, not persisted
+        uint32_t stalled            = 0;
+    };
+
+    void markFailedLocked(Entry& entry, int profile);
+
+    void load();
+
+    void save() const;
+
+    mutable std::mutex           mMutex;
+    std::string                  mPath;
+    std::map<std::string, Entry> mEntries;
+};
+
+#endif  // PIXELPILOT_DECODERPROFILES_H
@@ -0,0 +1,178 @@
+#include "DvrArena.h"
+
+#include <cassert>
+
+DvrArena::DvrArena(std::size_t capacityBytes, std::size_t maxItems)
+    : mCapacity(capacityBytes), mData(new uint8_t[capacityBytes]), mEntries(maxItems)
+{
+    mStats.capacity = capacityBytes;
+}
+
+uint8_t* DvrArena::reserve(std::size_t size, const Info& info, uint64_t& generation)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    generation = mGeneration;
+    // Audio packets don't depend on the video key frames, they are never skipped with them
+    const bool skipped = mSkipToKeyFrame && !info.keyFrame && !info.isAudio;
+    if (mClosed || size == 0 || skipped)
+    {
+        countDropped(size);
+        return nullptr;
+    }
+    std::size_t offset = 0;
+    while (!fits(size, offset))
+    {
+        if (evictOldest(false) || (info.keyFrame && evictOldest(true))) continue;
+        // The writer holds the rest, or the item is bigger than the whole arena
+        countDropped(size);
+        if (!info.isAudio) mSkipToKeyFrame = true;
+        return nullptr;
+    }
+    // Dropping the run this item continues
+    if (mSkipToKeyFrame && !info.keyFrame && !info.isAudio)
+    {
+        countDropped(size);
+        return nullptr;
+    }
+    if (info.keyFrame) mSkipToKeyFrame = false;
+    Entry& entry = at(mCount++);
+    entry        = Entry{offset, size, info, false, false};
+    return mData.get() + offset;
+}
+
+bool DvrArena::commit(uint64_t generation)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        // Reset while the item was filled, its entry is gone
+        if (generation != mGeneration) return false;
+        Entry& entry    = at(mCount - 1);
+        entry.committed = true;
+        mStats.bytesBuffered += entry.size;
+        mStats.nBuffered++;
+    }
+    mCondition.notify_one();
+    return true;
+}
+
+bool DvrArena::acquire(Item& item, std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    assert(!mAcquired);
+    const auto available = [this] { return (mCount > 0 && at(0).committed) || mClosed; };
+    // Polling doesn't sleep at all (a timed wait, even an expired one, costs the timer slack)
+    if (!available() && (timeout.count() <= 0 || !mCondition.wait_for(lock, timeout, available))) return false;
+    if (mCount == 0 || !at(0).committed) return false;
+    const Entry& entry = at(0);
+    item               = Item{mData.get() + entry.offset, entry.size, entry.info};
+    mAcquired          = true;
+    return true;
+}
+
+bool DvrArena::drained() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mClosed && mCount == 0;
+}
+
+void DvrArena::release()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    assert(mAcquired);
+    mStats.bytesBuffered -= at(0).size;
+    mStats.nBuffered--;
+    mHead = (mHead + 1) % mEntries.size();
+    mCount--;
+    mAcquired = false;
+    trim();
+}
+
+void DvrArena::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mClosed = true;
+    }
+    mCondition.notify_all();
+}
+
+void DvrArena::reset()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mHead           = 0;
+    mCount          = 0;
+    mAcquired       = false;
+    mSkipToKeyFrame = false;
+    mClosed         = false;
+    mGeneration++;
+    mStats          = Stats{};
+    mStats.capacity = mCapacity;
+}
+
+DvrArena::Stats DvrArena::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
+
+bool DvrArena::fits(std::size_t size, std::size_t& offset) const
+{
+    if (mCount == mEntries.size()) return false;
+    if (mCount == 0)
+    {
+        offset = 0;
+        return size <= mCapacity;
+    }
+    const std::size_t begin = at(0).offset;
+    const std::size_t end   = at(mCount - 1).offset + at(mCount - 1).size;
+    if (end > begin)
+    {
+        // Not wrapped: after the newest item, else at the start (the rest of the end stays unused)
+        offset = size <= mCapacity - end ? end : 0;
+        return size <= mCapacity - end || size <= begin;
+    }
+    offset = end;
+    return size <= begin - end;
+}
+
+bool DvrArena::evictOldest(bool keyFrames)
+{
+    // The acquired item is being written
+    std::size_t i = mAcquired ? 1 : 0;
+    while (i < mCount && (at(i).dropped || at(i).info.keyFrame != keyFrames)) ++i;
+    if (i == mCount) return false;
+    if (keyFrames)
+    {
+        while (i < mCount && at(i).info.keyFrame) drop(at(i++));
+    }
+    while (i < mCount && !at(i).info.keyFrame) drop(at(i++));
+    // Items of the dropped run might still come in
+    if (i == mCount) mSkipToKeyFrame = true;
+    trim();
+    return true;
+}
+
+void DvrArena::drop(Entry& entry)
+{
+    if (entry.dropped) return;
+    entry.dropped = true;
+    mStats.bytesBuffered -= entry.size;
+    mStats.nBuffered--;
+    countDropped(entry.size);
+}
+
+void DvrArena::countDropped(std::size_t size)
+{
+    mStats.bytesDropped += size;
+    mStats.nDropped++;
+}
+
+void DvrArena::trim()
+{
+    while (mCount > 0 && !mAcquired && at(0).dropped)
+    {
+        mHead = (mHead + 1) % mEntries.size();
+        mCount--;
+    }
+    while (mCount > (mAcquired ? 1 : 0) && at(mCount - 1).dropped) mCount--;
+}
@@ -0,0 +1,141 @@
+//
+// Buffer between the video receive path and the DVR writer thread.
+//
+
+#ifndef PIXELPILOT_DVRARENA_H
+#define PIXELPILOT_DVRARENA_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief Fixed size ring of NALUs (and audio packets) on their way to the recording, one producer (the receive path)
+ * and one consumer (the writer thread).
+ *
+ * All memory is allocated in the constructor, NALUs are copied into one contiguous region each.
+ * The producer never waits: when the writer falls behind and the ring is full, the oldest run of non-keyframe NALUs
+ * (up to the next keyframe, the rest of it could not be decoded anyways) is dropped to make room. Key frames (IRAP
+ * slices and parameter sets) are only dropped for a newer key frame. A NALU that doesn't fit even then is dropped,
+ * and so is everything after it up to the next key frame. Audio packets are evicted along with the run they are in,
+ * but never skipped while waiting for a key frame: they don't depend on the video.
+ */
+class DvrArena
+{
+  public:
+    // Items without a timestamp
+    static constexpr int64_t NO_TIMESTAMP = -1;
+
+    // Passed through to the writer, only keyFrame and isAudio matter to the arena
+    struct Info
+    {
+        bool    keyFrame  = false;
+        bool    isH265    = false;
+        bool    isAudio   = false;
+        int64_t timestamp = NO_TIMESTAMP;
+        // When the item was received by the socket / radio
+        std::chrono::steady_clock::time_point receiveTime;
+    };
+
+    struct Item
+    {
+        const uint8_t* data = nullptr;
+        std::size_t    size = 0;
+        Info           info;
+    };
+
+    struct Stats
+    {
+        std::size_t capacity      = 0;
+        std::size_t bytesBuffered = 0;
+        std::size_t nBuffered     = 0;
+        uint64_t    bytesDropped  = 0;
+        uint64_t    nDropped      = 0;
+    };
+
+    DvrArena(std::size_t capacityBytes, std::size_t maxItems);
+
+    DvrArena(const DvrArena&)            = delete;
+    DvrArena& operator=(const DvrArena&) = delete;
+
+    // Producer. fill(uint8_t* dst) writes the size bytes of the item. false if it was dropped (or reset() meanwhile)
+    template <typename Fill>
+    bool push(std::size_t size, const Info& info, Fill&& fill)
+    {
+        uint64_t generation = 0;
+        uint8_t* dst        = reserve(size, info, generation);
+        if (dst == nullptr) return false;
+        fill(dst);
+        return commit(generation);
+    }
+
+    // Consumer. The oldest item, valid and never dropped until release(). false after timeout, or once closed and empty
+    bool acquire(Item& item, std::chrono::milliseconds timeout);
+
+    // Closed and nothing left to acquire: acquire() won't return an item anymore
+    bool drained() const;
+
+    void release();
+
+    // Items pushed afterwards are dropped, acquire() returns what is left and then false
+    void close();
+
+    // Empty and open again. Only while the consumer is not active, a push in progress is discarded
+    void reset();
+
+    Stats getStats() const;
+
+  private:
+    struct Entry
+    {
+        std::size_t offset    = 0;
+        std::size_t size      = 0;
+        Info        info;
+        bool        committed = false;
+        bool        dropped   = false;
+    };
+
+    // generation: of the arena the space belongs to, for commit()
+    uint8_t* reserve(std::size_t size, const Info& info, uint64_t& generation);
+
+    // false if the arena was reset() since the item was reserved
+    bool commit(uint64_t generation);
+
+    // Where size contiguous bytes are free
+    bool fits(std::size_t size, std::size_t& offset) const;
+
+    // Drops the oldest run of non-keyframe items (keyFrames: of key frame items and the non-keyframe ones after them)
+    bool evictOldest(bool keyFrames);
+
+    void drop(Entry& entry);
+
+    void countDropped(std::size_t size);
+
+    // Frees dropped items at either end
+    void trim();
+
+    Entry& at(std::size_t i) { return mEntries[(mHead + i) % mEntries.size()]; }
+
+    const Entry& at(std::size_t i) const { return mEntries[(mHead + i) % mEntries.size()]; }
+
+    const std::size_t          mCapacity;
+    std::unique_ptr<uint8_t[]> mData;
+    // Ring of mCount entries starting at mHead, oldest first. Dropped ones keep their space until they reach an end
+    std::vector<Entry>      mEntries;
+    std::size_t             mHead           = 0;
+    std::size_t             mCount          = 0;
+    bool                    mAcquired       = false;
+    bool                    mSkipToKeyFrame = false;
+    bool                    mClosed         = false;
+    // Incremented by reset()
+    uint64_t                mGeneration     = 0;
+    Stats                   mStats;
+    mutable std::mutex      mMutex;
+    std::condition_variable mCondition;
+};
+
+#endif  // PIXELPILOT_DVRARENA_H
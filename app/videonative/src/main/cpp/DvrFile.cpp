@@ -0,0 +1,170 @@
+#include "DvrFile.h"
+
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include "helper/AndroidLogger.hpp"
+
+DvrFile::DvrFile(int fd) : DvrFile(fd, Options{}) {}
+
+DvrFile::DvrFile(int fd, Options options) : mFd(fd), mOptions(options), mLastSync(std::chrono::steady_clock::now())
+{
+    mActive.data = std::make_unique<uint8_t[]>(mOptions.bufferSize);
+    if (mOptions.flusherThread)
+    {
+        mFlushing.data = std::make_unique<uint8_t[]>(mOptions.bufferSize);
+        mFlusher       = std::thread(&DvrFile::flushLoop, this);
+    }
+}
+
+int DvrFile::writeCallback(int64_t offset, const void* buffer, std::size_t size, void* token)
+{
+    return static_cast<DvrFile*>(token)->write(offset, buffer, size) ? 0 : 1;
+}
+
+bool DvrFile::write(int64_t offset, const void* data, std::size_t size)
+{
+    nWrites++;
+    if (mFailed || mFd < 0) return false;
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    // Appends to or overwrites part of the buffered range
+    if (mActive.size > 0 && offset >= mActive.offset && offset <= mActive.offset + (int64_t) mActive.size &&
+        offset - mActive.offset + size <= mOptions.bufferSize)
+    {
+        const std::size_t at = offset - mActive.offset;
+        std::memcpy(mActive.data.get() + at, bytes, size);
+        mActive.size = std::max(mActive.size, at + size);
+        return true;
+    }
+    if (mActive.size > 0) submit();
+    if (size >= mOptions.bufferSize)
+    {
+        // Not worth copying, but after what is queued
+        waitIdle();
+        return pwriteAll(offset, bytes, size) && !mFailed;
+    }
+    mActive.offset = offset;
+    mActive.size   = size;
+    std::memcpy(mActive.data.get(), bytes, size);
+    return !mFailed;
+}
+
+bool DvrFile::close()
+{
+    if (mFd < 0) return !mFailed;
+    if (mActive.size > 0) submit();
+    if (mFlusher.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStop = true;
+        }
+        mCondition.notify_all();
+        mFlusher.join();
+    }
+    sync();
+    ::close(mFd);
+    mFd = -1;
+    return !mFailed;
+}
+
+DvrFile::Stats DvrFile::getStats() const
+{
+    return Stats{nWrites, nSyscalls, nSyncs, bytesWritten};
+}
+
+void DvrFile::submit()
+{
+    if (!mFlusher.joinable())
+    {
+        pwriteAll(mActive.offset, mActive.data.get(), mActive.size);
+        mActive.size = 0;
+        if (mOptions.syncInterval.count() > 0 &&
+            std::chrono::steady_clock::now() - mLastSync >= mOptions.syncInterval)
+        {
+            sync();
+        }
+        return;
+    }
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        // Storage slower than the stream, the DVR arena takes up the slack
+        mCondition.wait(lock, [this] { return !mFlushPending; });
+        std::swap(mActive, mFlushing);
+        mFlushPending = true;
+    }
+    mCondition.notify_all();
+    mActive.size = 0;
+}
+
+void DvrFile::waitIdle()
+{
+    if (!mFlusher.joinable()) return;
+    std::unique_lock<std::mutex> lock(mMutex);
+    mCondition.wait(lock, [this] { return !mFlushPending; });
+}
+
+bool DvrFile::pwriteAll(int64_t offset, const uint8_t* data, std::size_t size)
+{
+    while (size > 0)
+    {
+        nSyscalls++;
+        const ssize_t written = pwrite(mFd, data, size, offset);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0)
+        {
+            if (!mFailed.exchange(true)) MLOGE << "DVR write failed: " << strerror(errno);
+            return false;
+        }
+        data += written;
+        offset += written;
+        size -= written;
+        bytesWritten += written;
+        mUnsynced = true;
+    }
+    return true;
+}
+
+void DvrFile::sync()
+{
+    mLastSync = std::chrono::steady_clock::now();
+    if (!mUnsynced.exchange(false)) return;
+    nSyscalls++;
+    nSyncs++;
+    // Not fatal, the data was written. Some fds (pipes, some SAF providers) can't be synced at all
+    if (fdatasync(mFd) != 0 && errno != EINVAL && errno != EROFS) MLOGE << "DVR sync failed: " << strerror(errno);
+}
+
+void DvrFile::flushLoop()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true)
+    {
+        if (mOptions.syncInterval.count() > 0)
+        {
+            mCondition.wait_until(
+                lock, mLastSync + mOptions.syncInterval, [this] { return mFlushPending || mStop; });
+        }
+        else
+        {
+            mCondition.wait(lock, [this] { return mFlushPending || mStop; });
+        }
+        if (mFlushPending)
+        {
+            // mFlushing belongs to the flusher until mFlushPending is cleared
+            lock.unlock();
+            pwriteAll(mFlushing.offset, mFlushing.data.get(), mFlushing.size);
+            lock.lock();
+            mFlushPending = false;
+            mCondition.notify_all();
+        }
+        if (mOptions.syncInterval.count() > 0 && std::chrono::steady_clock::now() - mLastSync >= mOptions.syncInterval)
+        {
+            lock.unlock();
+            sync();
+            lock.lock();
+        }
+        if (mStop && !mFlushPending) return;
+    }
+}
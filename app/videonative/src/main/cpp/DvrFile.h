@@ -0,0 +1,109 @@
+//
+// Output file of the DVR: positional writes through a write-behind buffer.
+//
+
+#ifndef PIXELPILOT_DVRFILE_H
+#define PIXELPILOT_DVRFILE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/**
+ * @brief Takes the many small writes of the MP4 muxer (a box header, a sample, the next header, ...) and turns them
+ * into few big pwrite() calls.
+ *
+ * Writes continuing (or overwriting part of) the buffered range are coalesced in memory, any other write hands the
+ * buffer over to be written out first. With a flusher thread the buffer is double buffered: the muxer fills one while
+ * the other one is written, and only waits when the storage is slower than the stream. The flusher also calls
+ * fdatasync() every syncInterval, so a crash or a pulled SD card loses at most that much of the recording.
+ */
+class DvrFile
+{
+  public:
+    struct Options
+    {
+        std::size_t bufferSize    = 4 * 1024 * 1024;
+        bool        flusherThread = true;
+        // 0: only when closing
+        std::chrono::milliseconds syncInterval{1000};
+    };
+
+    struct Stats
+    {
+        // write() calls
+        uint64_t nWrites = 0;
+        // pwrite() and fdatasync() calls
+        uint64_t nSyscalls    = 0;
+        uint64_t nSyncs       = 0;
+        uint64_t bytesWritten = 0;
+    };
+
+    // Takes over fd
+    explicit DvrFile(int fd);
+
+    DvrFile(int fd, Options options);
+
+    DvrFile(const DvrFile&)            = delete;
+    DvrFile& operator=(const DvrFile&) = delete;
+
+    ~DvrFile() { close(); }
+
+    // false once anything failed to be written
+    bool write(int64_t offset, const void* data, std::size_t size);
+
+    // Writes out what is buffered, syncs and closes the file. false if anything failed to be written
+    bool close();
+
+    Stats getStats() const;
+
+    // For MP4E_open(), token is the DvrFile. 0 on success
+    static int writeCallback(int64_t offset, const void* buffer, std::size_t size, void* token);
+
+  private:
+    struct Buffer
+    {
+        std::unique_ptr<uint8_t[]> data;
+        int64_t                    offset = 0;
+        std::size_t                size   = 0;
+    };
+
+    // Hands mActive over to be written (or writes it right away without flusher), mActive is empty afterwards
+    void submit();
+
+    // Without flusher: right away, with flusher: once it is done with what it has
+    void waitIdle();
+
+    bool pwriteAll(int64_t offset, const uint8_t* data, std::size_t size);
+
+    void sync();
+
+    void flushLoop();
+
+    int                                   mFd;
+    const Options                         mOptions;
+    Buffer                                mActive;
+    std::atomic<bool>                     mFailed{false};
+    std::chrono::steady_clock::time_point mLastSync;
+    // Written since the last sync. Big writes bypass the flusher
+    std::atomic<bool> mUnsynced{false};
+    // Flusher state, guarded by mMutex
+    Buffer                  mFlushing;
+    bool                    mFlushPending = false;
+    bool                    mStop         = false;
+    std::mutex              mMutex;
+    std::condition_variable mCondition;
+    std::thread             mFlusher;
+
+    std::atomic<uint64_t> nWrites{0};
+    std::atomic<uint64_t> nSyscalls{0};
+    std::atomic<uint64_t> nSyncs{0};
+    std::atomic<uint64_t> bytesWritten{0};
+};
+
+#endif  // PIXELPILOT_DVRFILE_H
@@ -0,0 +1,343 @@
+#include "DvrWriter.h"
+
+#include <cstring>
+
+#include "DvrFile.h"
+#include "helper/AndroidLogger.hpp"
+#include "helper/NDKThreadHelper.hpp"
+#include "minimp4.h"
+#include "parser/RTP.hpp"
+
+using namespace std::chrono;
+
+namespace
+{
+constexpr auto TIME_BETWEEN_LOGS = seconds(5);
+
+int64_t nowMs()
+{
+    return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// NALUs a recording can start with, or resume with after dropping
+bool isKeyFrame(const NALU& nalu)
+{
+    return nalu.isIRAPSlice() || nalu.isSPS() || nalu.isPPS() || (nalu.IS_H265_PACKET && nalu.isVPS());
+}
+
+// Opus always uses a 48 kHz clock, for RTP timestamps (RFC 7587) as well as in MP4
+constexpr int OPUS_SAMPLE_RATE = 48000;
+// Longer gaps between two audio packets are taken as a new stream
+constexpr int64_t MAX_AUDIO_GAP = 5 * OPUS_SAMPLE_RATE;
+
+// Samples in one frame of an Opus packet, from its TOC byte (RFC 6716 3.1)
+int opusFrameSamples(uint8_t toc)
+{
+    const int config = toc >> 3;
+    // SILK: 10, 20, 40, 60 ms
+    if (config < 12) return (config & 3) == 3 ? 2880 : 480 << (config & 3);
+    // Hybrid: 10, 20 ms
+    if (config < 16) return 480 << (config & 1);
+    // CELT: 2.5, 5, 10, 20 ms
+    return 120 << (config & 3);
+}
+
+// Samples in an Opus packet, 0 if it is malformed
+int opusSamples(const uint8_t* data, std::size_t size)
+{
+    if (size == 0) return 0;
+    switch (data[0] & 3)
+    {
+        case 0:
+            return opusFrameSamples(data[0]);
+        case 3:
+            return size < 2 ? 0 : (data[1] & 0x3f) * opusFrameSamples(data[0]);
+        default:
+            return 2 * opusFrameSamples(data[0]);
+    }
+}
+
+/**
+ * The Opus track of a recording. Placed on the video's timeline by the receive time of its first packet, gaps are
+ * filled with DTX (zero length) frames, which any Opus decoder plays as silence.
+ */
+class OpusTrack
+{
+  public:
+    // toc: of a packet of the stream, for the channel count
+    bool create(MP4E_mux_t* mux, uint8_t toc)
+    {
+        const int    channels = (toc & 0x04) ? 2 : 1;
+        MP4E_track_t track{};
+        track.object_type_indication = MP4_OBJECT_TYPE_OPUS;
+        track.track_media_kind       = e_audio;
+        track.time_scale             = OPUS_SAMPLE_RATE;
+        track.default_duration       = 0;
+        track.u.a.channelcount       = channels;
+        std::memcpy(track.language, "und", 4);
+        mTrack = MP4E_add_track(mux, &track);
+        if (mTrack < 0) return false;
+        // OpusSpecificBox: version, channels, pre-skip, input sample rate, output gain, mapping family (mono/stereo)
+        const uint8_t dOps[] = {0, (uint8_t) channels, 0, 0, 0x00, 0x00, 0xbb, 0x80, 0, 0, 0};
+        MP4E_set_dsi(mux, mTrack, dOps, sizeof(dOps));
+        mMux = mux;
+        return true;
+    }
+
+    bool exists() const { return mTrack >= 0; }
+
+    // recordingStart: receive time of the first video frame
+    void write(const DvrArena::Item& item, steady_clock::time_point recordingStart)
+    {
+        const int samples = opusSamples(item.data, item.size);
+        if (samples == 0) return;
+        int64_t target = -1;
+        if (mNextTimestamp != DvrArena::NO_TIMESTAMP)
+        {
+            // Modulo 2^32, RTP timestamps wrap around
+            const int64_t gap = static_cast<int32_t>(static_cast<uint32_t>(item.info.timestamp - mNextTimestamp));
+            // Late (or duplicate), its place is taken already
+            if (gap < 0 && gap > -MAX_AUDIO_GAP) return;
+            if (gap >= 0 && gap <= MAX_AUDIO_GAP) target = mPosition + gap;
+        }
+        if (target < 0)
+        {
+            // First packet, or a new stream
+            target = duration_cast<microseconds>(item.info.receiveTime - recordingStart).count() * OPUS_SAMPLE_RATE /
+                     1000000;
+        }
+        // Silence in frames of the packet's mode, so the decoder doesn't have to switch
+        const uint8_t dtx        = item.data[0] & 0xfc;
+        const int     dtxSamples = opusFrameSamples(dtx);
+        while (mPosition + dtxSamples <= target)
+        {
+            put(&dtx, 1, dtxSamples);
+            mSilence += dtxSamples;
+        }
+        put(item.data, item.size, samples);
+        mNextTimestamp = (item.info.timestamp + samples) & 0xffffffff;
+        mPackets++;
+    }
+
+    // Seconds of audio, and how much of it is filled in silence
+    float duration_s() const { return (float) mPosition / OPUS_SAMPLE_RATE; }
+
+    float silence_s() const { return (float) mSilence / OPUS_SAMPLE_RATE; }
+
+    long packets() const { return mPackets; }
+
+  private:
+    void put(const uint8_t* data, std::size_t size, int samples)
+    {
+        const int res = MP4E_put_sample(mMux, mTrack, data, (int) size, samples, MP4E_SAMPLE_RANDOM_ACCESS);
+        if (MP4E_STATUS_OK != res)
+        {
+            MLOGD << "MP4E_put_sample (audio) failed with " << res;
+        }
+        mPosition += samples;
+    }
+
+    MP4E_mux_t* mMux           = nullptr;
+    int         mTrack         = -1;
+    int64_t     mPosition      = 0;
+    int64_t     mSilence       = 0;
+    long        mPackets       = 0;
+    int64_t     mNextTimestamp = DvrArena::NO_TIMESTAMP;
+};
+}  // namespace
+
+DvrWriter::DvrWriter(VIDEO_FORMAT_CALLBACK getVideoFormat) : mGetVideoFormat(std::move(getVideoFormat)) {}
+
+DvrWriter::~DvrWriter()
+{
+    stop();
+}
+
+void DvrWriter::start(int fd, bool fragmented)
+{
+    stop();
+    if (!mArena) mArena = std::make_unique<DvrArena>(ARENA_SIZE, ARENA_MAX_NALUS);
+    mArena->reset();
+    mRunning = true;
+    mThread  = std::thread(&DvrWriter::writeLoop, this, fd, fragmented);
+    NDKThreadHelper::setName(mThread.native_handle(), "DvrWriter");
+}
+
+void DvrWriter::stop()
+{
+    if (!mThread.joinable()) return;
+    mRunning = false;
+    mArena->close();
+    mThread.join();
+}
+
+void DvrWriter::onNALU(const NALU& nalu)
+{
+    if (!mRunning) return;
+    DvrArena::Info info;
+    info.keyFrame    = isKeyFrame(nalu);
+    info.isH265      = nalu.IS_H265_PACKET;
+    info.timestamp   = nalu.hasRtpTimestamp ? nalu.rtpTimestamp : DvrArena::NO_TIMESTAMP;
+    info.receiveTime = nalu.receiveTime;
+    mArena->push(nalu.getSize(), info, [&nalu](uint8_t* dst) { nalu.copyTo(dst); });
+}
+
+void DvrWriter::onAudio(const uint8_t* rtpPacket, std::size_t size, steady_clock::time_point rxTime)
+{
+    if (!mRunning || size <= sizeof(rtp_header_t)) return;
+    const RTP::RTPPacket packet(rtpPacket, size);
+    DvrArena::Info       info;
+    info.isAudio     = true;
+    info.timestamp   = packet.header.getTimestamp();
+    info.receiveTime = rxTime == steady_clock::time_point{} ? steady_clock::now() : rxTime;
+    // Not a key frame: dropped first when the writer falls behind
+    mArena->push(
+        packet.rtpPayloadSize,
+        info,
+        [&packet](uint8_t* dst) { std::memcpy(dst, packet.rtpPayload, packet.rtpPayloadSize); });
+}
+
+bool DvrWriter::isRecording() const
+{
+    return nowMs() - mLastWriteMs <= 500;
+}
+
+DvrArena::Stats DvrWriter::getStats() const
+{
+    return mArena ? mArena->getStats() : DvrArena::Stats{};
+}
+
+uint32_t DvrWriter::frameDuration(int64_t from, int64_t to, uint32_t fallback)
+{
+    if (from == DvrArena::NO_TIMESTAMP || to == DvrArena::NO_TIMESTAMP) return fallback;
+    // Modulo 2^32, RTP timestamps wrap around
+    const uint32_t duration = static_cast<uint32_t>(to - from);
+    if (duration == 0 || duration > MAX_FRAME_DURATION) return fallback;
+    return duration;
+}
+
+void DvrWriter::writeLoop(int fd, bool fragmented)
+{
+    DvrFile           file(fd);
+    MP4E_mux_t*       mux = MP4E_open(0 /*sequential_mode*/, fragmented, &file, DvrFile::writeCallback);
+    mp4_h26x_writer_t mp4wr{};
+    float             framerate = 0;
+    if (mux == nullptr)
+    {
+        MLOGE << "dvr open failed";
+        mArena->close();
+        return;
+    }
+    auto lastLog = steady_clock::now();
+
+    // The pending access unit. Written as soon as the next one (its timestamp) arrives, NALUs without a timestamp
+    // are an access unit each
+    int64_t  pendingTimestamp = DvrArena::NO_TIMESTAMP;
+    uint32_t lastDuration     = 0;
+    // A fragmented file gets its header with the first sample: it has to be a video one (the header needs the
+    // parameter sets), and tracks can only be added before
+    bool videoWritten = false;
+
+    OpusTrack                audio;
+    int                      audioToc = -1;
+    steady_clock::time_point recordingStart;
+    mPending.clear();
+    mPendingSizes.clear();
+    const auto writePending = [&](uint32_t duration)
+    {
+        std::size_t offset = 0;
+        for (const std::size_t size : mPendingSizes)
+        {
+            // Only the first slice of the access unit adds its duration to the track
+            const int res = mp4_h26x_write_nal(&mp4wr, mPending.data() + offset, (int) size, duration);
+            if (MP4E_STATUS_OK != res)
+            {
+                MLOGD << "mp4_h26x_write_nal failed with " << res;
+            }
+            offset += size;
+        }
+        mPending.clear();
+        mPendingSizes.clear();
+        lastDuration = duration;
+        videoWritten = true;
+    };
+
+    DvrArena::Item item;
+    // Until stop() closed the arena and everything in it is written
+    while (true)
+    {
+        if (!mArena->acquire(item, milliseconds(100)))
+        {
+            if (mArena->drained()) break;
+            continue;
+        }
+        mLastWriteMs = nowMs();
+        if (item.info.isAudio)
+        {
+            if (framerate == 0)
+            {
+                // Audio starts with the video
+                audioToc = item.data[0];
+            }
+            else if (!audio.exists() && !(fragmented && videoWritten))
+            {
+                audio.create(mux, item.data[0]);
+            }
+            if (videoWritten && audio.exists()) audio.write(item, recordingStart);
+            mArena->release();
+            continue;
+        }
+        if (framerate == 0)
+        {
+            const VideoFormat format = mGetVideoFormat();
+            // The recording starts with a key frame
+            if (!item.info.keyFrame || format.fps <= 0)
+            {
+                mArena->release();
+                continue;
+            }
+            if (MP4E_STATUS_OK != mp4_h26x_write_init(&mp4wr, mux, format.width, format.height, item.info.isH265))
+            {
+                MLOGE << "mp4_h26x_write_init failed";
+            }
+            framerate      = format.fps;
+            recordingStart = item.info.receiveTime;
+            if (audioToc >= 0) audio.create(mux, audioToc);
+            MLOGD << "mp4 init with fps=" << framerate << ", res=" << format.width << "x" << format.height
+                  << ", hevc=" << item.info.isH265 << ", audio=" << audio.exists();
+        }
+        if (!mPendingSizes.empty() &&
+            (item.info.timestamp != pendingTimestamp || item.info.timestamp == DvrArena::NO_TIMESTAMP))
+        {
+            writePending(frameDuration(pendingTimestamp, item.info.timestamp, 90000 / framerate));
+        }
+        pendingTimestamp = item.info.timestamp;
+        mPending.insert(mPending.end(), item.data, item.data + item.size);
+        mPendingSizes.push_back(item.size);
+        mArena->release();
+        if (steady_clock::now() - lastLog > TIME_BETWEEN_LOGS)
+        {
+            lastLog                     = steady_clock::now();
+            const DvrArena::Stats stats = mArena->getStats();
+            MLOGD << "DVR buffered " << stats.bytesBuffered << "B of " << stats.capacity << "B | dropped "
+                  << stats.nDropped << " items, " << stats.bytesDropped << "B";
+        }
+    }
+
+    if (!mPendingSizes.empty())
+    {
+        // Nothing comes after it, as long as the one before
+        writePending(lastDuration > 0 ? lastDuration : 90000 / framerate);
+    }
+    MP4E_close(mux);
+    mp4_h26x_write_close(&mp4wr);
+    const bool           ok    = file.close();
+    const DvrFile::Stats stats = file.getStats();
+    MLOGD << "dvr thread done" << (ok ? "" : " (write failed)") << ": " << stats.bytesWritten << "B in "
+          << stats.nWrites << " writes, " << stats.nSyscalls << " syscalls";
+    if (audio.exists())
+    {
+        MLOGD << "dvr audio: " << audio.packets() << " packets, " << audio.duration_s() << " s, of that "
+              << audio.silence_s() << " s filled with silence";
+    }
+}
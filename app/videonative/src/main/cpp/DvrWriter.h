@@ -0,0 +1,90 @@
+//
+// Records the received video (and audio) into an MP4 file, on its own thread.
+//
+
+#ifndef PIXELPILOT_DVRWRITER_H
+#define PIXELPILOT_DVRWRITER_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "DvrArena.h"
+#include "NALU/NALU.hpp"
+
+/**
+ * @brief DVR pipeline: the receive path copies NALUs and Opus packets into a DvrArena, the writer thread muxes them
+ * from there.
+ *
+ * Nothing is allocated per NALU, the arena is allocated once with the first recording. A writer that falls behind
+ * (slow storage) costs dropped frames in the recording, never time on the receive path.
+ *
+ * Sample durations come from the RTP timestamps (90 kHz, the MP4 track's time scale), so the recording plays back at
+ * the pace the frames were captured at: with the encoder's real frame rate, and with frames lost on the link or
+ * dropped by the arena taking their time on the timeline instead of speeding playback up. Since a duration is only
+ * known once the next access unit arrives, the writer holds back one access unit.
+ *
+ * Audio goes into an Opus track on the same timeline: it starts where its first packet was received relative to the
+ * first video frame, and continues by its RTP timestamps (48 kHz). Audio that is missing (lost, not sent, dropped by
+ * the arena) is filled with silence (DTX frames), so the audio after a gap stays in sync with the video.
+ */
+class DvrWriter
+{
+  public:
+    struct VideoFormat
+    {
+        int   width  = 0;
+        int   height = 0;
+        float fps    = 0;
+    };
+    // Asked for once the first key frame is about to be written
+    typedef std::function<VideoFormat()> VIDEO_FORMAT_CALLBACK;
+
+    // About 4 s of a 30 MBit/s stream
+    static constexpr std::size_t ARENA_SIZE      = 16 * 1024 * 1024;
+    static constexpr std::size_t ARENA_MAX_NALUS = 8192;
+    // Longer gaps between two timestamps are taken as a new stream (restarted encoder / new time base)
+    static constexpr uint32_t MAX_FRAME_DURATION = 5 * 90000;
+
+    explicit DvrWriter(VIDEO_FORMAT_CALLBACK getVideoFormat);
+
+    ~DvrWriter();
+
+    // Record to fd (taken over) until stop(). fragmented: fragmented MP4, playable even if never finished
+    void start(int fd, bool fragmented);
+
+    // Writes what is still buffered and closes the file
+    void stop();
+
+    bool isRunning() const { return mRunning; }
+
+    // Receive path, never blocks. Dropped while not running
+    void onNALU(const NALU& nalu);
+
+    // Receive path, never blocks. An RTP packet with Opus payload. Dropped while not running
+    void onAudio(const uint8_t* rtpPacket, std::size_t size, std::chrono::steady_clock::time_point rxTime);
+
+    // Something was written in the last 500 ms
+    bool isRecording() const;
+
+    DvrArena::Stats getStats() const;
+
+  private:
+    void writeLoop(int fd, bool fragmented);
+
+    // 90 kHz, of the access unit with timestamp from until the next one at to. fallback if unknown
+    static uint32_t frameDuration(int64_t from, int64_t to, uint32_t fallback);
+
+    const VIDEO_FORMAT_CALLBACK mGetVideoFormat;
+    std::unique_ptr<DvrArena>   mArena;
+    std::thread                 mThread;
+    std::atomic<bool>           mRunning{false};
+    std::atomic<int64_t>        mLastWriteMs{0};
+    // The access unit waiting for its duration, grows to the biggest one and stays (writer thread only)
+    std::vector<uint8_t>     mPending;
+    std::vector<std::size_t> mPendingSizes;
+};
+
+#endif  // PIXELPILOT_DVRWRITER_H
@@ -0,0 +1,108 @@
+#include "FrameFanout.h"
+
+#include <utility>
+
+int FrameFanout::addSink(std::shared_ptr<FanoutSink> sink)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    Sink*                       slot = find(-1);
+    if (slot == nullptr) return -1;
+    *slot      = Sink{};
+    slot->id   = mNextId++;
+    slot->sink = std::move(sink);
+    return slot->id;
+}
+
+void FrameFanout::removeSink(int id)
+{
+    Sink removed;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        Sink*                       slot = find(id);
+        if (slot == nullptr) return;
+        removed = std::exchange(*slot, Sink{});
+    }
+    // Frames (and the sink) are released outside of the lock, that may call back into the decoder
+}
+
+void FrameFanout::onFrame(std::shared_ptr<FanoutFrame> frame)
+{
+    std::array<std::shared_ptr<FanoutSink>, MAX_SINKS>  ready;
+    std::array<std::shared_ptr<FanoutFrame>, MAX_SINKS> dropped;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (std::size_t i = 0; i < mSinks.size(); ++i)
+        {
+            Sink& sink = mSinks[i];
+            if (sink.id == -1) continue;
+            if (!sink.busy)
+            {
+                sink.busy = true;
+                sink.stats.nPresented++;
+                ready[i] = sink.sink;
+                continue;
+            }
+            if (sink.waiting)
+            {
+                sink.stats.nDropped++;
+                dropped[i] = std::move(sink.waiting);
+            }
+            sink.waiting = frame;
+        }
+    }
+    for (auto& sink : ready)
+    {
+        if (sink) sink->present(frame);
+    }
+}
+
+void FrameFanout::onSinkReady(int id)
+{
+    std::shared_ptr<FanoutSink>  sink;
+    std::shared_ptr<FanoutFrame> frame;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        Sink*                       slot = find(id);
+        if (slot == nullptr) return;
+        if (!slot->waiting)
+        {
+            slot->busy = false;
+            return;
+        }
+        // Stays busy with the waiting frame
+        slot->stats.nPresented++;
+        sink  = slot->sink;
+        frame = std::move(slot->waiting);
+    }
+    sink->present(std::move(frame));
+}
+
+FrameFanout::SinkStats FrameFanout::getStats(int id) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (const Sink& sink : mSinks)
+    {
+        if (sink.id == id && id != -1) return sink.stats;
+    }
+    return {};
+}
+
+std::size_t FrameFanout::nSinks() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    std::size_t                 n = 0;
+    for (const Sink& sink : mSinks)
+    {
+        if (sink.id != -1) n++;
+    }
+    return n;
+}
+
+FrameFanout::Sink* FrameFanout::find(int id)
+{
+    for (Sink& sink : mSinks)
+    {
+        if (sink.id == id) return &sink;
+    }
+    return nullptr;
+}
@@ -0,0 +1,98 @@
+//
+// Shows the frames of one decoder on several outputs (e.g. the phone screen and a second display / VR headset).
+//
+
+#ifndef PIXELPILOT_FRAMEFANOUT_H
+#define PIXELPILOT_FRAMEFANOUT_H
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+
+/**
+ * A decoded picture in the buffer queue shared by all outputs (an AImage of the decoder's AImageReader on Android).
+ * Goes back to the queue when the last reference is gone.
+ */
+class FanoutFrame
+{
+  public:
+    virtual ~FanoutFrame() = default;
+};
+
+/**
+ * One output. Gets at most one frame at a time: the next present() only comes after the sink reported it is ready for
+ * it with FrameFanout::onSinkReady(), possibly from within that call and on the thread that made it.
+ */
+class FanoutSink
+{
+  public:
+    virtual ~FanoutSink() = default;
+
+    // Show frame, and keep a reference for as long as it is read from (e.g. until the next frame replaced it on screen)
+    virtual void present(std::shared_ptr<FanoutFrame> frame) = 0;
+};
+
+/**
+ * @brief Hands every frame of one decoder to N sinks, without ever making the decoder wait for a slow sink.
+ *
+ * Frame drop policy, per sink: a sink that is still busy with its last frame when a new one arrives gets the new one
+ * as soon as it is ready, the frame that was waiting for it (if any) is dropped. So a slow sink always shows the
+ * newest frame, and never holds more than the one it shows, the one it is presenting and the one waiting for it.
+ * Other sinks are not affected. A frame goes back to the buffer queue once no sink references it anymore.
+ *
+ * Thread-safe: frames usually come from the decoder's output thread, sinks report ready from their own threads.
+ * Sinks are called without holding the lock.
+ */
+class FrameFanout
+{
+  public:
+    static constexpr std::size_t MAX_SINKS = 4;
+
+    struct SinkStats
+    {
+        long nPresented = 0;
+        long nDropped   = 0;
+    };
+
+    /**
+     * Frames the buffer queue needs so the decoder never waits for a free one: per sink the frame on screen, the one
+     * being presented and the one waiting, plus the one being decoded.
+     */
+    static constexpr std::size_t framesNeeded(std::size_t nSinks) { return 3 * nSinks + 1; }
+
+    // Returns the id of the sink, -1 if there are MAX_SINKS already
+    int addSink(std::shared_ptr<FanoutSink> sink);
+
+    // The frame waiting for the sink is released, frames it presents are up to the sink
+    void removeSink(int id);
+
+    // A new decoded frame
+    void onFrame(std::shared_ptr<FanoutFrame> frame);
+
+    // The sink can take the next frame. Ignored for removed sinks
+    void onSinkReady(int id);
+
+    SinkStats getStats(int id) const;
+
+    std::size_t nSinks() const;
+
+  private:
+    struct Sink
+    {
+        int                          id = -1;
+        std::shared_ptr<FanoutSink>  sink;
+        bool                         busy = false;
+        std::shared_ptr<FanoutFrame> waiting;
+        SinkStats                    stats;
+    };
+
+    // Sinks with id == -1 are unused slots
+    Sink* find(int id);
+
+    mutable std::mutex          mMutex;
+    std::array<Sink, MAX_SINKS> mSinks;
+    int                         mNextId = 0;
+};
+
+#endif  // PIXELPILOT_FRAMEFANOUT_H
@@ -0,0 +1,174 @@
+#include "InProcessReceiver.h"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <utility>
+
+#include "helper/AndroidLogger.hpp"
+#include "helper/NDKThreadHelper.hpp"
+
+namespace
+{
+// Upper bound for how long the receiver thread sleeps without re-checking the stop flag
+constexpr auto IDLE_WAIT_TIMEOUT = std::chrono::milliseconds(50);
+}  // namespace
+
+InProcessReceiver::InProcessReceiver(
+    JavaVM* javaVm, std::string name, int CPUPriority, DATA_CALLBACK onDataReceivedCallback)
+    : mName(std::move(name)),
+      mCPUPriority(CPUPriority),
+      onDataReceivedCallback(std::move(onDataReceivedCallback)),
+      javaVm(javaVm),
+      mSink{
+          this,
+          &InProcessReceiver::pushTrampoline,
+          &InProcessReceiver::keyframeRequestsTrampoline,
+          &InProcessReceiver::pushTimedTrampoline},
+      mWakeupFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+{
+}
+
+InProcessReceiver::~InProcessReceiver()
+{
+    stopReceiving();
+    if (mWakeupFd != -1) close(mWakeupFd);
+}
+
+void InProcessReceiver::setPacketRetention(
+    HOLDS_REFERENCES_CALLBACK holdsReferences, RELEASE_REFERENCES_CALLBACK releaseReferences)
+{
+    mHoldsReferences   = std::move(holdsReferences);
+    mReleaseReferences = std::move(releaseReferences);
+}
+
+void InProcessReceiver::startReceiving()
+{
+    receiving = true;
+    mThread   = std::make_unique<std::thread>([this] { receiveLoop(); });
+#ifdef __ANDROID__
+    NDKThreadHelper::setName(mThread->native_handle(), mName.c_str());
+#endif
+}
+
+void InProcessReceiver::stopReceiving()
+{
+    receiving = false;
+    mRing.wakeConsumer();
+    if (mThread && mThread->joinable()) mThread->join();
+    mThread.reset();
+}
+
+bool InProcessReceiver::openSource()
+{
+    if (mWakeupFd == -1 || mThread) return false;
+    mRing.setWakeupFd(mWakeupFd);
+    receiving = true;
+    return true;
+}
+
+void InProcessReceiver::closeSource()
+{
+    receiving = false;
+    mRing.setWakeupFd(-1);
+    discardPending();
+}
+
+size_t InProcessReceiver::drain(const size_t maxPackets, const bool deliver)
+{
+    size_t     taken   = 0;
+    const auto consume = [this](const uint8_t* data, size_t data_length, std::chrono::steady_clock::time_point rxTime)
+    {
+        onDataReceivedCallback(data, data_length, rxTime);
+        nReceivedBytes += static_cast<long>(data_length);
+    };
+    if (!deliver)
+    {
+        // pop() releases everything consumed so far, retained slots included
+        if (mHoldsReferences) mReleaseReferences();
+        while (taken < maxPackets && mRing.pop([](const uint8_t*, size_t) {}))
+        {
+            taken++;
+        }
+        return taken;
+    }
+    if (!mHoldsReferences)
+    {
+        while (taken < maxPackets && mRing.pop(consume))
+        {
+            taken++;
+        }
+        return taken;
+    }
+    while (taken < maxPackets && mRing.popRetain(consume))
+    {
+        taken++;
+        if (mHoldsReferences())
+        {
+            // Don't let one huge (or never ending) NALU starve the producer
+            if (mRing.retained() < MAX_RETAINED_SLOTS) continue;
+            mReleaseReferences();
+        }
+        mRing.release();
+    }
+    return taken;
+}
+
+void InProcessReceiver::discardPending()
+{
+    if (mHoldsReferences) mReleaseReferences();
+    mRing.release();
+    // Whatever is left belongs to a stream we are no longer interested in
+    while (mRing.pop([](const uint8_t*, size_t) {}))
+    {
+    }
+}
+
+void InProcessReceiver::push(const uint8_t* data, size_t data_length)
+{
+    pushTimed(data, data_length, std::chrono::steady_clock::now());
+}
+
+void InProcessReceiver::pushTimed(
+    const uint8_t* data, size_t data_length, const std::chrono::steady_clock::time_point rxTime)
+{
+    if (!receiving || !mRing.push(data, data_length, rxTime))
+    {
+        nDroppedPackets++;
+    }
+}
+
+void InProcessReceiver::pushTrampoline(void* opaque, const uint8_t* data, size_t data_length)
+{
+    static_cast<InProcessReceiver*>(opaque)->push(data, data_length);
+}
+
+void InProcessReceiver::pushTimedTrampoline(void* opaque, const uint8_t* data, size_t data_length, int64_t rx_time_ns)
+{
+    // Same clock, both libraries live in the same process
+    static_cast<InProcessReceiver*>(opaque)->pushTimed(
+        data, data_length, std::chrono::steady_clock::time_point(std::chrono::nanoseconds(rx_time_ns)));
+}
+
+uint32_t InProcessReceiver::keyframeRequestsTrampoline(void* opaque)
+{
+    return static_cast<InProcessReceiver*>(opaque)->nKeyframeRequests.load(std::memory_order_relaxed);
+}
+
+void InProcessReceiver::receiveLoop()
+{
+#ifdef __ANDROID__
+    if (javaVm) NDKThreadHelper::setProcessThreadPriorityAttachDetach(javaVm, mCPUPriority, mName.c_str());
+#endif
+    MLOGD << "In-process receiver '" << mName << "' started";
+
+    while (receiving)
+    {
+        if (drain(N_SLOTS, true) == 0)
+        {
+            mRing.waitForData(IDLE_WAIT_TIMEOUT);
+        }
+    }
+    discardPending();
+}
@@ -0,0 +1,135 @@
+//
+// In-process companion to UDPReceiver / UDSReceiver.
+// Receives RTP packets pushed by the wfb-ng aggregator (same process) through a lock-free SPSC ring.
+//
+
+#ifndef PIXELPILOT_INPROCESSRECEIVER_H
+#define PIXELPILOT_INPROCESSRECEIVER_H
+
+#include <jni.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "InProcessRtpSink.h"
+#include "IngestSource.h"
+#include "SpscPacketRing.h"
+
+class InProcessReceiver : public IngestSource
+{
+  public:
+    // rxTime: when wfb-ng received the packet from the radio (push_timed), or when it was pushed
+    using DATA_CALLBACK = std::function<void(const uint8_t*, size_t, std::chrono::steady_clock::time_point rxTime)>;
+    // Packet retention: does the consumer still reference packets / make it copy whatever it references
+    using HOLDS_REFERENCES_CALLBACK   = std::function<bool()>;
+    using RELEASE_REFERENCES_CALLBACK = std::function<void()>;
+
+    // wfb-ng never forwards more than one 802.11 payload per packet, 4k is plenty
+    static constexpr size_t MAX_PACKET_SIZE = 4096;
+    // ~4 MiB, roughly 1 second of video at 30 Mbit/s
+    static constexpr size_t N_SLOTS = 1024;
+    // With packet retention, the consumer is asked to release its references once this many slots are retained
+    static constexpr size_t MAX_RETAINED_SLOTS = N_SLOTS / 2;
+
+    /**
+     * @param javaVm used to set thread priority (attach and then detach) for android,
+       nullptr when priority doesn't matter/not using android
+     * @param CPUPriority: The priority the receiver thread will run with if javaVm!=nullptr
+     * @param onDataReceivedCallback: called on the receiver thread for every packet pushed into the sink
+     */
+    InProcessReceiver(JavaVM* javaVm, std::string name, int CPUPriority, DATA_CALLBACK onDataReceivedCallback);
+
+    InProcessReceiver(const InProcessReceiver&)            = delete;
+    InProcessReceiver& operator=(const InProcessReceiver&) = delete;
+
+    ~InProcessReceiver() override;
+
+    /**
+     * Keep the packets handed to onDataReceivedCallback valid (in the ring) while holdsReferences() returns true,
+     * instead of recycling each one as soon as the callback returns. Used for zero-copy NALU assembly.
+     * Must be set before startReceiving().
+     */
+    void setPacketRetention(HOLDS_REFERENCES_CALLBACK holdsReferences, RELEASE_REFERENCES_CALLBACK releaseReferences);
+
+    /**
+     * Start receiver thread, which drains the ring
+     */
+    void startReceiving();
+
+    /**
+     * Stop and join receiver thread. Packets pushed while stopped are dropped.
+     */
+    void stopReceiving();
+
+    // IngestSource, instead of startReceiving() / stopReceiving()
+    bool openSource() override;
+
+    void closeSource() override;
+
+    int pollFd() const override { return mWakeupFd; }
+
+    size_t drain(size_t maxPackets, bool deliver) override;
+
+    bool prepareWait() override { return !mRing.prepareExternalWait(); }
+
+    void finishWait() override { mRing.finishExternalWait(); }
+
+    /**
+     * Producer side, called from the wfb-ng aggregator thread. Never blocks.
+     */
+    void push(const uint8_t* data, size_t data_length);
+
+    void pushTimed(const uint8_t* data, size_t data_length, std::chrono::steady_clock::time_point rxTime);
+
+    /**
+     * C handle for the producer. Stays valid for the lifetime of this object.
+     */
+    const InProcessRtpSink* getSink() const { return &mSink; }
+
+    /**
+     * Ask the producer side for a keyframe (see InProcessRtpSink::keyframe_requests). Callable from any thread.
+     */
+    void requestKeyframe() { nKeyframeRequests.fetch_add(1, std::memory_order_relaxed); }
+
+    [[nodiscard]] long getNReceivedBytes() const { return nReceivedBytes; }
+
+    [[nodiscard]] long getNDroppedPackets() const { return nDroppedPackets; }
+
+  private:
+    void receiveLoop();
+
+    // Consumer side leftovers once receiving stopped
+    void discardPending();
+
+    static void pushTrampoline(void* opaque, const uint8_t* data, size_t data_length);
+
+    static void pushTimedTrampoline(void* opaque, const uint8_t* data, size_t data_length, int64_t rx_time_ns);
+
+    static uint32_t keyframeRequestsTrampoline(void* opaque);
+
+    const std::string   mName;
+    const int           mCPUPriority;
+    const DATA_CALLBACK onDataReceivedCallback;
+    JavaVM* const       javaVm;
+
+    HOLDS_REFERENCES_CALLBACK   mHoldsReferences;
+    RELEASE_REFERENCES_CALLBACK mReleaseReferences;
+
+    SpscPacketRing<MAX_PACKET_SIZE, N_SLOTS> mRing;
+    const InProcessRtpSink                   mSink;
+    // Signalled by the ring while the IngestReactor sleeps, open for the whole lifetime (the producer may still write)
+    const int mWakeupFd;
+
+    std::unique_ptr<std::thread> mThread;
+    std::atomic<bool>            receiving{false};
+    std::atomic<long>            nReceivedBytes{0};
+    std::atomic<long>            nDroppedPackets{0};
+    std::atomic<uint32_t>        nKeyframeRequests{0};
+};
+
+#endif  // PIXELPILOT_INPROCESSRECEIVER_H
@@ -0,0 +1,40 @@
+//
+// C interface shared between libVideoNative and libWfbngRtl8812.
+// Lets the wfb-ng video aggregator hand RTP packets directly to the VideoPlayer living in the same process,
+// instead of sending them to 127.0.0.1:5600 and reading them back with a UDPReceiver, and the VideoPlayer ask the
+// wfb-ng side for keyframes.
+//
+
+#ifndef PIXELPILOT_INPROCESSRTPSINK_H
+#define PIXELPILOT_INPROCESSRTPSINK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    struct InProcessRtpSink
+    {
+        // Owner of the sink, passed back as first argument of push
+        void* opaque;
+        // Called for every decrypted and FEC-recovered RTP packet. Must not block.
+        // Only one thread may call push at a time (single producer).
+        void (*push)(void* opaque, const uint8_t* data, size_t data_length);
+        // Optional (may be NULL). Number of keyframes the video consumer asked for so far, e.g. after losing data a
+        // keyframe is needed to recover from. Polled by the producer side, which forwards new requests to the air
+        // unit. Callable from any thread.
+        uint32_t (*keyframe_requests)(void* opaque);
+        // Optional (may be NULL), like push, with the time the packet was received from the radio (steady clock /
+        // CLOCK_MONOTONIC nanoseconds), for FEC-recovered packets the time the frame completing the block arrived.
+        // Same single producer rule as push.
+        void (*push_timed)(void* opaque, const uint8_t* data, size_t data_length, int64_t rx_time_ns);
+    };
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif  // PIXELPILOT_INPROCESSRTPSINK_H
@@ -0,0 +1,200 @@
+#include "IngestReactor.h"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#include "helper/AndroidLogger.hpp"
+#include "helper/NDKThreadHelper.hpp"
+
+namespace
+{
+// Upper bound for how long the reactor sleeps without re-checking the stop flag
+constexpr int IDLE_WAIT_TIMEOUT_MS = 50;
+// Marks the stop eventfd in epoll_event.data, sources use their index
+constexpr uint64_t STOP_EVENT = UINT64_MAX;
+}  // namespace
+
+IngestReactor::IngestReactor(JavaVM* javaVm, std::string name, int CPUPriority)
+    : mName(std::move(name)),
+      mCPUPriority(CPUPriority),
+      javaVm(javaVm)
+{
+}
+
+IngestReactor::~IngestReactor()
+{
+    stop();
+}
+
+void IngestReactor::addSource(IngestSource* source, int priority, std::string name)
+{
+    if (running) return;
+    const auto pos = std::find_if(
+        mEntries.begin(), mEntries.end(), [priority](const Entry& entry) { return entry.priority < priority; });
+    mEntries.insert(pos, Entry{source, priority, std::move(name)});
+}
+
+void IngestReactor::clearSources()
+{
+    if (running) return;
+    mEntries.clear();
+}
+
+void IngestReactor::setTick(Tick tick)
+{
+    if (running) return;
+    mTick = std::move(tick);
+}
+
+bool IngestReactor::start()
+{
+    if (mThread) return true;
+    mEpollFd = epoll_create1(EPOLL_CLOEXEC);
+    mStopFd  = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (mEpollFd == -1 || mStopFd == -1)
+    {
+        MLOGE << "Cannot set up reactor: " << strerror(errno);
+        stop();
+        return false;
+    }
+    epoll_event event{};
+    event.events   = EPOLLIN;
+    event.data.u64 = STOP_EVENT;
+    epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mStopFd, &event);
+
+    for (size_t i = 0; i < mEntries.size(); ++i)
+    {
+        Entry& entry = mEntries[i];
+        entry.open   = entry.source->openSource();
+        if (!entry.open)
+        {
+            MLOGE << "Ingest source '" << entry.name << "' not available";
+            continue;
+        }
+        event.data.u64 = i;
+        if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, entry.source->pollFd(), &event) == -1)
+        {
+            MLOGE << "Cannot poll ingest source '" << entry.name << "': " << strerror(errno);
+            entry.source->closeSource();
+            entry.open = false;
+        }
+    }
+
+    running = true;
+    mThread = std::make_unique<std::thread>([this] { loop(); });
+#ifdef __ANDROID__
+    NDKThreadHelper::setName(mThread->native_handle(), mName.c_str());
+#endif
+    return true;
+}
+
+void IngestReactor::stop()
+{
+    running = false;
+    if (mThread)
+    {
+        eventfd_write(mStopFd, 1);
+        if (mThread->joinable()) mThread->join();
+        mThread.reset();
+    }
+    for (Entry& entry : mEntries)
+    {
+        if (entry.open) entry.source->closeSource();
+        entry.open         = false;
+        entry.ready        = false;
+        entry.lastDelivery = {};
+    }
+    mActiveEntry = -1;
+    if (mEpollFd != -1) close(mEpollFd);
+    if (mStopFd != -1) close(mStopFd);
+    mEpollFd = -1;
+    mStopFd  = -1;
+}
+
+std::string IngestReactor::getActiveSourceName() const
+{
+    const int active = mActiveEntry;
+    return active >= 0 && static_cast<size_t>(active) < mEntries.size() ? mEntries[active].name : "";
+}
+
+bool IngestReactor::isShadowed(const Entry& entry, const std::chrono::steady_clock::time_point now) const
+{
+    for (const Entry& other : mEntries)
+    {
+        if (other.priority <= entry.priority) break;
+        if (other.open && other.lastDelivery != std::chrono::steady_clock::time_point{} &&
+            now - other.lastDelivery < SOURCE_HOLD_TIME)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void IngestReactor::loop()
+{
+#ifdef __ANDROID__
+    if (javaVm) NDKThreadHelper::setProcessThreadPriorityAttachDetach(javaVm, mCPUPriority, mName.c_str());
+#endif
+    MLOGD << "Ingest reactor '" << mName << "' started with " << mEntries.size() << " sources";
+
+    std::array<epoll_event, 8> events{};
+    while (running)
+    {
+        bool pending = false;
+        for (Entry& entry : mEntries)
+        {
+            entry.ready = entry.open && entry.source->prepareWait();
+            pending |= entry.ready;
+        }
+        std::chrono::milliseconds timeout{pending ? 0 : IDLE_WAIT_TIMEOUT_MS};
+        if (mTick) timeout = std::clamp(mTick(), std::chrono::milliseconds(0), timeout);
+        const int n = epoll_wait(mEpollFd, events.data(), events.size(), static_cast<int>(timeout.count()));
+        for (Entry& entry : mEntries)
+        {
+            if (entry.open) entry.source->finishWait();
+        }
+        if (n == -1 && errno != EINTR)
+        {
+            MLOGE << "epoll_wait failed: " << strerror(errno);
+            break;
+        }
+        for (int i = 0; i < n; ++i)
+        {
+            if (events[i].data.u64 == STOP_EVENT) continue;
+            mEntries[events[i].data.u64].ready = true;
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < mEntries.size(); ++i)
+        {
+            Entry& entry = mEntries[i];
+            if (!entry.ready) continue;
+            const bool   deliver = !isShadowed(entry, now);
+            const size_t taken   = entry.source->drain(PACKETS_PER_TURN, deliver);
+            if (taken == 0) continue;
+            if (!deliver)
+            {
+                nDroppedPackets += static_cast<long>(taken);
+                continue;
+            }
+            entry.lastDelivery = now;
+            // Only reported when the previous one went quiet (or got outranked), not between equal priority sources
+            const int active = mActiveEntry;
+            if (active != static_cast<int>(i) &&
+                (active < 0 || mEntries[active].priority < entry.priority ||
+                 now - mEntries[active].lastDelivery >= SOURCE_HOLD_TIME))
+            {
+                MLOGD << "Ingest source '" << entry.name << "' active";
+                mActiveEntry = static_cast<int>(i);
+            }
+        }
+    }
+}
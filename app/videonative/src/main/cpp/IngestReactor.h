@@ -0,0 +1,114 @@
+//
+// Single receive thread multiplexing all video ingest sources with epoll.
+//
+
+#ifndef PIXELPILOT_INGESTREACTOR_H
+#define PIXELPILOT_INGESTREACTOR_H
+
+#include <jni.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "IngestSource.h"
+
+/**
+ * @brief Drives N IngestSources (UDP, UDS, in-process ring, ...) from one thread, so whatever their data callbacks
+ * feed (BufferedPacketQueue, H26XParser, neither of them thread-safe) is only ever used from that thread.
+ *
+ * Each source has a priority. Ready sources are drained highest priority first, at most PACKETS_PER_TURN packets
+ * each per turn, so a flooding source can't starve the others. While a source delivered within SOURCE_HOLD_TIME,
+ * packets of lower priority sources are read and dropped instead of being interleaved into the same stream; they take
+ * over once it went quiet (e.g. in-process wfb-ng video first, UDP from an external wfb-ng as fallback).
+ *
+ * Sources are added while stopped and must outlive the reactor (or the next clearSources()). A tick callback can be set
+ * for work that is due without any packet arriving (e.g. jitter buffer deadlines), the reactor sleeps no longer than
+ * it asks for.
+ */
+class IngestReactor
+{
+  public:
+    static constexpr size_t                    PACKETS_PER_TURN = 64;
+    static constexpr std::chrono::milliseconds SOURCE_HOLD_TIME{500};
+
+    // Called on the reactor thread before every wait, returns how long the reactor may sleep before calling it again,
+    // milliseconds::max() if there is nothing due
+    using Tick = std::function<std::chrono::milliseconds()>;
+
+    /**
+     * @param javaVm used to set thread priority (attach and then detach) for android,
+       nullptr when priority doesn't matter/not using android
+     * @param CPUPriority: The priority the reactor thread will run with if javaVm!=nullptr
+     */
+    IngestReactor(JavaVM* javaVm, std::string name, int CPUPriority);
+
+    IngestReactor(const IngestReactor&)            = delete;
+    IngestReactor& operator=(const IngestReactor&) = delete;
+
+    ~IngestReactor();
+
+    /**
+     * Higher priority wins, sources with the same priority are delivered side by side. Only while stopped.
+     */
+    void addSource(IngestSource* source, int priority, std::string name);
+
+    // Only while stopped
+    void clearSources();
+
+    // Only while stopped
+    void setTick(Tick tick);
+
+    /**
+     * Open all sources and start the reactor thread. Sources that fail to open are skipped.
+     * @return false if the reactor itself could not be set up
+     */
+    bool start();
+
+    /**
+     * Stop and join the reactor thread, then close all sources
+     */
+    void stop();
+
+    // Name of the source whose packets are currently delivered, empty if none
+    [[nodiscard]] std::string getActiveSourceName() const;
+
+    [[nodiscard]] long getNDroppedPackets() const { return nDroppedPackets; }
+
+  private:
+    struct Entry
+    {
+        IngestSource*                         source;
+        int                                   priority;
+        std::string                           name;
+        bool                                  open  = false;
+        bool                                  ready = false;
+        std::chrono::steady_clock::time_point lastDelivery{};
+    };
+
+    void loop();
+
+    // A source with a higher priority than entry delivered recently
+    bool isShadowed(const Entry& entry, std::chrono::steady_clock::time_point now) const;
+
+    const std::string mName;
+    const int         mCPUPriority;
+    JavaVM* const     javaVm;
+    Tick              mTick;
+
+    // Sorted by descending priority
+    std::vector<Entry>           mEntries;
+    int                          mEpollFd = -1;
+    // Wakes up the reactor thread on stop()
+    int                          mStopFd  = -1;
+    std::unique_ptr<std::thread> mThread;
+    std::atomic<bool>            running{false};
+    std::atomic<int>             mActiveEntry{-1};
+    std::atomic<long>            nDroppedPackets{0};
+};
+
+#endif  // PIXELPILOT_INGESTREACTOR_H
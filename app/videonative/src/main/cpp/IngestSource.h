@@ -0,0 +1,43 @@
+//
+// A packet source (UDP port, Unix domain socket, in-process ring) that can be multiplexed by the IngestReactor.
+//
+
+#ifndef PIXELPILOT_INGESTSOURCE_H
+#define PIXELPILOT_INGESTSOURCE_H
+
+#include <cstddef>
+
+/**
+ * Besides running on its own receiver thread (startReceiving()), a receiver can be driven by an IngestReactor, which
+ * polls pollFd() and calls drain() when it becomes readable. All of these are then called on the reactor thread only,
+ * between openSource() and closeSource(). Received packets still go to the receiver's own data callback.
+ */
+class IngestSource
+{
+  public:
+    virtual ~IngestSource() = default;
+
+    // Create / bind whatever pollFd() refers to. false on failure, the source is skipped then
+    virtual bool openSource() = 0;
+
+    virtual void closeSource() = 0;
+
+    // Becomes readable (EPOLLIN, level triggered) while there is data to drain
+    virtual int pollFd() const = 0;
+
+    /**
+     * @brief Non-blocking: take up to maxPackets packets. If deliver is false they are read and dropped.
+     * @return Number of packets taken, 0 if there was nothing to read.
+     */
+    virtual size_t drain(size_t maxPackets, bool deliver) = 0;
+
+    /**
+     * Called right before the reactor sleeps on pollFd(). Returns true if there already is data that will not make
+     * pollFd() readable, so the reactor must not sleep. finishWait() follows after waking up.
+     */
+    virtual bool prepareWait() { return false; }
+
+    virtual void finishWait() {}
+};
+
+#endif  // PIXELPILOT_INGESTSOURCE_H
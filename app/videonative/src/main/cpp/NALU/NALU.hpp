@@ -12,6 +12,7 @@
 #include <chrono>
 #include <cstdint>  // for uint8_t
 #include <cstring>
+#include <functional>
 #include <iomanip>
 #include <iostream>
 #include <memory>
@@ -21,7 +22,9 @@
 #include <variant>
 #include <vector>
 
+#include "NALUFragments.hpp"
 #include "NALUnitType.hpp"
+#include "SpsParser.hpp"
 
 // dependency could be easily removed again
 #include <android/log.h>
@@ -35,6 +38,8 @@
  * store a NALU. Since H264 and H265 are that similar, we use this class for both (make sure to not call methds only
  * supported on h265 with a h264 nalu,though) The constructor of the NALU does some really basic validation - make sure
  * the parser never produces a NALU where this validation would fail
+ * A NALU can also be backed by a NALUFragments list (zero-copy RTP assembly). The header accessors then only read the
+ * first fragment, use copyTo() to get the data out - getData() has to gather it into a fallback buffer first.
  */
 class NALU
 {
@@ -51,6 +56,23 @@ class NALU
         m_nalu_prefix_size = get_nalu_prefix_size();
     }
 
+    // The first fragment has to contain the start code and the whole NAL header
+    NALU(
+        const NALUFragments&                        fragments,
+        const bool                                  IS_H265_PACKET1 = false,
+        const std::chrono::steady_clock::time_point creationTime    = std::chrono::steady_clock::now())
+        : m_data(fragments[0].data),
+          m_data_len(fragments.size()),
+          m_fragments(&fragments),
+          IS_H265_PACKET(IS_H265_PACKET1),
+          creationTime{creationTime}
+    {
+        assert(hasValidPrefix());
+        assert(getSize() >= getMinimumNaluSize(IS_H265_PACKET1));
+        m_nalu_prefix_size = get_nalu_prefix_size();
+        assert(fragments[0].size >= (size_t) m_nalu_prefix_size + (IS_H265_PACKET1 ? 2 : 1));
+    }
+
     ~NALU() = default;
 
     // test video white iceland: Max 1024*117. Video might not be decodable if its NALU buffers size exceed the limit
@@ -60,14 +82,24 @@ class NALU
     using NALU_BUFFER = std::array<uint8_t, NALU_MAXLEN>;
 
   private:
-    const uint8_t* m_data;
-    const size_t   m_data_len;
-    int            m_nalu_prefix_size;
+    // with fragments, only the first fragment (start code + NAL header)
+    const uint8_t*             m_data;
+    const size_t               m_data_len;
+    const NALUFragments* const m_fragments = nullptr;
+    int                        m_nalu_prefix_size;
 
   public:
     const bool IS_H265_PACKET;
     // creation time is used to measure latency
     const std::chrono::steady_clock::time_point creationTime;
+    // Set by the parser if this is the last NALU of its access unit (RTP marker bit). False if unknown.
+    bool endsAccessUnit = false;
+    // When the first packet of this NALU was received by the socket / radio, creationTime if unknown.
+    // creationTime - receiveTime is the time spent in the socket / ingest ring / jitter buffer
+    std::chrono::steady_clock::time_point receiveTime = creationTime;
+    // RTP timestamp (90 kHz clock) of the access unit this NALU belongs to, only valid if hasRtpTimestamp
+    uint32_t rtpTimestamp    = 0;
+    bool     hasRtpTimestamp = false;
 
   public:
     // returns true if starts with 0001, false otherwise
@@ -92,7 +124,17 @@ class NALU
 
   public:
     // pointer to the NALU data with 0001 prefix
-    const uint8_t* getData() const { return m_data; }
+    const uint8_t* getData() const { return m_fragments ? m_fragments->contiguous() : m_data; }
+
+    // copy the NALU data with 0001 prefix to dst (at least getSize() bytes), gathering the fragments if needed
+    size_t copyTo(uint8_t* dst) const
+    {
+        if (m_fragments) return m_fragments->copyTo(dst);
+        std::memcpy(dst, m_data, m_data_len);
+        return m_data_len;
+    }
+
+    bool isFragmented() const { return m_fragments != nullptr && m_fragments->count() > 1; }
 
     // size of the NALU data with 0001 prefix
     size_t getSize() const { return m_data_len; }
@@ -108,9 +150,9 @@ class NALU
     {
         if (IS_H265_PACKET)
         {
-            return (getDataWithoutPrefix()[0] & 0x7E) >> 1;
+            return (m_data[m_nalu_prefix_size] & 0x7E) >> 1;
         }
-        return getDataWithoutPrefix()[0] & 0x1f;
+        return m_data[m_nalu_prefix_size] & 0x1f;
     }
 
     std::string get_nal_unit_type_as_string() const
@@ -194,6 +236,50 @@ class NALU
         return false;
     }
 
+    // coded slice (segment) of a picture, i.e. a VCL NALU
+    bool isSlice() const
+    {
+        const auto nut = get_nal_unit_type();
+        if (IS_H265_PACKET)
+        {
+            return nut <= NALUnitType::H265::NAL_UNIT_RESERVED_VCL31;
+        }
+        return nut >= NALUnitType::H264::NAL_UNIT_TYPE_CODED_SLICE_NON_IDR &&
+               nut <= NALUnitType::H264::NAL_UNIT_TYPE_CODED_SLICE_IDR;
+    }
+
+    // Slice of a random access point picture, which does not reference any earlier picture.
+    // h265: IRAP (BLA / IDR / CRA), h264: IDR
+    bool isIRAPSlice() const
+    {
+        const auto nut = get_nal_unit_type();
+        if (IS_H265_PACKET)
+        {
+            return nut >= NALUnitType::H265::NAL_UNIT_CODED_SLICE_BLA_W_LP &&
+                   nut <= NALUnitType::H265::NAL_UNIT_RESERVED_IRAP_VCL23;
+        }
+        return nut == NALUnitType::H264::NAL_UNIT_TYPE_CODED_SLICE_IDR;
+    }
+
+    // h265 only: leading picture of a CRA that references pictures before it (not decodable when starting at the CRA)
+    bool isRASLSlice() const
+    {
+        if (!IS_H265_PACKET) return false;
+        const auto nut = get_nal_unit_type();
+        return nut == NALUnitType::H265::NAL_UNIT_CODED_SLICE_RASL_N ||
+               nut == NALUnitType::H265::NAL_UNIT_CODED_SLICE_RASL_R;
+    }
+
+    // For slices: true if this is the first slice of a new picture.
+    // h265: first_slice_segment_in_pic_flag, h264: first_mb_in_slice == 0 (ue(v), so a leading 1 bit).
+    // Both are the first bit after the NAL header.
+    bool isFirstSliceInPicture() const
+    {
+        const size_t offset = m_nalu_prefix_size + (IS_H265_PACKET ? 2 : 1);
+        if (getSize() <= offset) return false;
+        return (byteAt(offset) & 0x80) != 0;
+    }
+
     bool is_frame_but_not_keyframe() const
     {
         const auto nut = get_nal_unit_type();
@@ -202,6 +288,20 @@ class NALU
     }
     // XXX -----------
 
+    // Single byte of the NALU (prefix included), without gathering the fragments
+    uint8_t byteAt(size_t offset) const
+    {
+        if (m_fragments == nullptr) return m_data[offset];
+        for (size_t i = 0; i < m_fragments->count(); ++i)
+        {
+            const auto& f = (*m_fragments)[i];
+            if (offset < f.size) return f.data[offset];
+            offset -= f.size;
+        }
+        assert(false);
+        return 0;
+    }
+
     std::string getDataAsHexString() const
     {
         std::stringstream ss;
@@ -278,27 +378,20 @@ class NALU
     //        //MLOGD<<StringHelper::vectorAsString(tmp)<<" "<<tmp.size();
     //    }
 
-    // Returns video width and height if the NALU is an SPS
+    // Returns video width and height if the NALU is an SPS (640x480 / 1280x720 if it can't be parsed)
     std::array<int, 2> getVideoWidthHeightSPS() const
     {
         assert(isSPS());
+        const size_t headerSize = IS_H265_PACKET ? 2 : 1;
+        const auto   rbsp       = getDataWithoutPrefix() + headerSize;
+        const size_t rbspSize   = static_cast<size_t>(getDataSizeWithoutPrefix()) - headerSize;
         if (IS_H265_PACKET)
         {
-            return {1280, 720};
-            //            auto sps=h265nal::H265SpsParser::ParseSps(&getData()[6],getSize()-6);
-            //            if(sps!=absl::nullopt){
-            //                std::array<int,2>
-            //                ret={(int)sps->pic_width_in_luma_samples,(int)sps->pic_height_in_luma_samples}; return
-            //                ret;
-            //            }
-            //            MLOGE<<"Couldn't parse h265 sps";
-            //            return {640,480};
+            return SpsParser::h265PictureSize(rbsp, rbspSize).value_or(std::array<int, 2>{1280, 720});
         }
         else
         {
-            // const auto sps=H264::SPS(getData(),getSize());
-            // return sps.getWidthHeightPx();
-            return {640, 480};
+            return SpsParser::h264PictureSize(rbsp, rbspSize).value_or(std::array<int, 2>{640, 480});
         }
     }
     //
@@ -319,8 +412,12 @@ class NALUBuffer
 
     NALUBuffer(const NALU& nalu)
     {
-        m_data = std::make_shared<std::vector<uint8_t>>(nalu.getData(), nalu.getData() + nalu.getSize());
+        m_data = std::make_shared<std::vector<uint8_t>>(nalu.getSize());
+        nalu.copyTo(m_data->data());
         m_nalu = std::make_unique<NALU>(m_data->data(), m_data->size(), nalu.IS_H265_PACKET, nalu.creationTime);
+        m_nalu->receiveTime     = nalu.receiveTime;
+        m_nalu->rtpTimestamp    = nalu.rtpTimestamp;
+        m_nalu->hasRtpTimestamp = nalu.hasRtpTimestamp;
     }
 
     NALUBuffer(const NALUBuffer&) = delete;
@@ -0,0 +1,109 @@
+//
+// Scatter list of one NALU that is still spread over the RTP packets it arrived in.
+//
+
+#ifndef PIXELPILOT_NALUFRAGMENTS_H
+#define PIXELPILOT_NALUFRAGMENTS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * @brief (pointer, length) list describing one NALU, filled by the RTPDecoder in zero-copy assembly mode.
+ *
+ * The first fragment normally is the start code + (reconstructed) NAL header, written by the RTPDecoder into its own
+ * buffer. All following fragments point straight into received RTP packets, which therefore must stay valid until the
+ * NALU has been forwarded (see H26XParser::holdsPacketReferences()).
+ *
+ * copyTo() gathers the fragments exactly once into the final destination (codec input buffer, DVR buffer).
+ * contiguous() is the fallback for consumers that need a single pointer: it gathers into the buffer given on
+ * construction, which may be the one the first fragment lives in.
+ */
+class NALUFragments
+{
+  public:
+    struct Fragment
+    {
+        const uint8_t* data;
+        size_t         size;
+    };
+
+    // Typical key frames at 1080p fit easily (~1400 byte RTP payloads). When a NALU needs more, the RTPDecoder
+    // gathers what it has and starts a new list - which also bounds how many packets a receiver has to keep around.
+    static constexpr size_t MAX_FRAGMENTS = 512;
+
+    // fallback must be big enough for the biggest NALU the owner ever assembles
+    explicit NALUFragments(uint8_t* fallback) : m_fallback(fallback) {}
+
+    NALUFragments(const NALUFragments&)            = delete;
+    NALUFragments& operator=(const NALUFragments&) = delete;
+
+    void clear()
+    {
+        m_count      = 0;
+        m_size       = 0;
+        m_contiguous = nullptr;
+    }
+
+    // Returns false (and appends nothing) if the list is full
+    bool append(const uint8_t* data, size_t size)
+    {
+        if (m_count == MAX_FRAGMENTS) return false;
+        m_fragments[m_count++] = {data, size};
+        m_size += size;
+        m_contiguous = nullptr;
+        return true;
+    }
+
+    bool empty() const { return m_count == 0; }
+
+    size_t count() const { return m_count; }
+
+    // Total size of all fragments
+    size_t size() const { return m_size; }
+
+    const Fragment& operator[](size_t i) const { return m_fragments[i]; }
+
+    // Gather all fragments into dst, which must hold at least size() bytes. Returns size().
+    size_t copyTo(uint8_t* dst) const
+    {
+        size_t offset = 0;
+        for (size_t i = 0; i < m_count; ++i)
+        {
+            const Fragment& f = m_fragments[i];
+            // The first fragment may already be where it belongs (gathering into the fallback buffer)
+            if (f.data != dst + offset) std::memcpy(dst + offset, f.data, f.size);
+            offset += f.size;
+        }
+        return offset;
+    }
+
+    // Pointer to all fragments in one piece, gathered into the fallback buffer on first use
+    const uint8_t* contiguous() const
+    {
+        if (m_contiguous == nullptr)
+        {
+            if (m_count == 1)
+            {
+                m_contiguous = m_fragments[0].data;
+            }
+            else
+            {
+                copyTo(m_fallback);
+                m_contiguous = m_fallback;
+            }
+        }
+        return m_contiguous;
+    }
+
+  private:
+    std::array<Fragment, MAX_FRAGMENTS> m_fragments;
+    size_t                              m_count = 0;
+    size_t                              m_size  = 0;
+    uint8_t* const                      m_fallback;
+    mutable const uint8_t*              m_contiguous = nullptr;
+};
+
+#endif  // PIXELPILOT_NALUFRAGMENTS_H
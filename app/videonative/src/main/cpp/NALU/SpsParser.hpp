@@ -0,0 +1,252 @@
+//
+// Picture size out of a H264 / H265 sequence parameter set. Only the fields up to the size are parsed.
+//
+
+#ifndef PIXELPILOT_SPSPARSER_H
+#define PIXELPILOT_SPSPARSER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+namespace SpsParser
+{
+/**
+ * @brief Reads the RBSP of a NALU bit by bit, skipping the emulation prevention bytes (00 00 03).
+ * Reading past the end yields zero bits and sets overrun().
+ */
+class BitReader
+{
+  public:
+    BitReader(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+
+    uint32_t bit()
+    {
+        if (m_bit == 0)
+        {
+            if (m_pos >= m_size)
+            {
+                m_overrun = true;
+                return 0;
+            }
+            m_byte  = m_data[m_pos++];
+            m_zeros = m_byte == 0 ? m_zeros + 1 : 0;
+            m_bit   = 8;
+            // Emulation prevention byte, the one after it is data again
+            if (m_zeros == 2 && m_pos < m_size && m_data[m_pos] == 3)
+            {
+                m_pos++;
+                m_zeros = 0;
+            }
+        }
+        return (m_byte >> --m_bit) & 1;
+    }
+
+    uint32_t bits(int n)
+    {
+        uint32_t value = 0;
+        for (int i = 0; i < n; ++i) value = (value << 1) | bit();
+        return value;
+    }
+
+    void skip(int n)
+    {
+        for (int i = 0; i < n; ++i) bit();
+    }
+
+    // Exp-Golomb ue(v)
+    uint32_t ue()
+    {
+        int leadingZeros = 0;
+        while (bit() == 0)
+        {
+            // More than 31 can't be represented, it's garbage
+            if (++leadingZeros > 31 || m_overrun)
+            {
+                m_overrun = true;
+                return 0;
+            }
+        }
+        return (uint32_t) ((uint64_t{1} << leadingZeros) - 1 + bits(leadingZeros));
+    }
+
+    // Exp-Golomb se(v)
+    int32_t se()
+    {
+        const uint32_t value = ue();
+        return (value & 1) ? (int32_t) ((value + 1) / 2) : -(int32_t) (value / 2);
+    }
+
+    bool overrun() const { return m_overrun; }
+
+  private:
+    const uint8_t* m_data;
+    size_t         m_size;
+    size_t         m_pos     = 0;
+    uint8_t        m_byte    = 0;
+    int            m_bit     = 0;
+    int            m_zeros   = 0;
+    bool           m_overrun = false;
+};
+
+// SubWidthC / SubHeightC for chroma_format_idc, (1, 1) for monochrome and separate colour planes
+static inline std::array<int, 2> chromaSubsampling(uint32_t chromaFormatIdc, bool separateColourPlane)
+{
+    if (separateColourPlane) return {1, 1};
+    switch (chromaFormatIdc)
+    {
+        case 1:
+            return {2, 2};
+        case 2:
+            return {2, 1};
+        default:
+            return {1, 1};
+    }
+}
+
+/**
+ * @param rbsp H264 SPS after the prefix and the one byte NAL unit header
+ * @return Cropped picture size in pixels, nullopt if the SPS is invalid or truncated
+ */
+static inline std::optional<std::array<int, 2>> h264PictureSize(const uint8_t* rbsp, size_t size)
+{
+    BitReader      reader(rbsp, size);
+    const uint32_t profileIdc = reader.bits(8);
+    reader.skip(16);  // constraint flags, level_idc
+    reader.ue();      // seq_parameter_set_id
+    uint32_t chromaFormatIdc     = 1;
+    bool     separateColourPlane = false;
+    switch (profileIdc)
+    {
+        case 100:
+        case 110:
+        case 122:
+        case 244:
+        case 44:
+        case 83:
+        case 86:
+        case 118:
+        case 128:
+        case 138:
+        case 139:
+        case 134:
+        case 135:
+        {
+            chromaFormatIdc = reader.ue();
+            if (chromaFormatIdc == 3) separateColourPlane = reader.bit();
+            reader.ue();     // bit_depth_luma_minus8
+            reader.ue();     // bit_depth_chroma_minus8
+            reader.skip(1);  // qpprime_y_zero_transform_bypass_flag
+            if (reader.bit())
+            {
+                // seq_scaling_matrix_present_flag
+                const int nLists = chromaFormatIdc == 3 ? 12 : 8;
+                for (int i = 0; i < nLists; ++i)
+                {
+                    if (!reader.bit()) continue;
+                    const int listSize  = i < 6 ? 16 : 64;
+                    int       lastScale = 8, nextScale = 8;
+                    for (int j = 0; j < listSize && nextScale != 0; ++j)
+                    {
+                        nextScale = (lastScale + reader.se() + 256) % 256;
+                        if (nextScale != 0) lastScale = nextScale;
+                    }
+                }
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    reader.ue();  // log2_max_frame_num_minus4
+    const uint32_t picOrderCntType = reader.ue();
+    if (picOrderCntType == 0)
+    {
+        reader.ue();  // log2_max_pic_order_cnt_lsb_minus4
+    }
+    else if (picOrderCntType == 1)
+    {
+        reader.skip(1);  // delta_pic_order_always_zero_flag
+        reader.se();     // offset_for_non_ref_pic
+        reader.se();     // offset_for_top_to_bottom_field
+        const uint32_t nOffsets = reader.ue();
+        if (nOffsets > 255) return std::nullopt;
+        for (uint32_t i = 0; i < nOffsets; ++i) reader.se();
+    }
+    reader.ue();     // max_num_ref_frames
+    reader.skip(1);  // gaps_in_frame_num_value_allowed_flag
+    const uint32_t widthInMbs       = reader.ue() + 1;
+    const uint32_t heightInMapUnits = reader.ue() + 1;
+    const uint32_t frameMbsOnly     = reader.bit();
+    if (!frameMbsOnly) reader.skip(1);  // mb_adaptive_frame_field_flag
+    reader.skip(1);                     // direct_8x8_inference_flag
+    uint32_t cropLeft = 0, cropRight = 0, cropTop = 0, cropBottom = 0;
+    if (reader.bit())
+    {
+        cropLeft   = reader.ue();
+        cropRight  = reader.ue();
+        cropTop    = reader.ue();
+        cropBottom = reader.ue();
+    }
+    if (reader.overrun()) return std::nullopt;
+
+    const auto    sub        = chromaSubsampling(chromaFormatIdc, separateColourPlane);
+    const bool    monochrome = chromaFormatIdc == 0 || separateColourPlane;
+    const int64_t cropUnitX  = monochrome ? 1 : sub[0];
+    const int64_t cropUnitY  = (monochrome ? 1 : sub[1]) * (2 - frameMbsOnly);
+    const int64_t width      = int64_t{widthInMbs} * 16 - cropUnitX * (int64_t{cropLeft} + cropRight);
+    const int64_t height =
+        int64_t{heightInMapUnits} * 16 * (2 - frameMbsOnly) - cropUnitY * (int64_t{cropTop} + cropBottom);
+    if (width <= 0 || height <= 0 || width > 16384 || height > 16384) return std::nullopt;
+    return std::array<int, 2>{(int) width, (int) height};
+}
+
+/**
+ * @param rbsp H265 SPS after the prefix and the two byte NAL unit header
+ * @return Picture size in pixels (conformance window applied), nullopt if the SPS is invalid or truncated
+ */
+static inline std::optional<std::array<int, 2>> h265PictureSize(const uint8_t* rbsp, size_t size)
+{
+    BitReader reader(rbsp, size);
+    reader.skip(4);  // sps_video_parameter_set_id
+    const uint32_t maxSubLayersMinus1 = reader.bits(3);
+    reader.skip(1);  // sps_temporal_id_nesting_flag
+    // profile_tier_level(1, sps_max_sub_layers_minus1): general profile (88 bits) and level (8 bits)
+    reader.skip(96);
+    bool subLayerProfilePresent[8] = {}, subLayerLevelPresent[8] = {};
+    for (uint32_t i = 0; i < maxSubLayersMinus1; ++i)
+    {
+        subLayerProfilePresent[i] = reader.bit();
+        subLayerLevelPresent[i]   = reader.bit();
+    }
+    if (maxSubLayersMinus1 > 0) reader.skip(2 * (8 - (int) maxSubLayersMinus1));  // reserved_zero_2bits
+    for (uint32_t i = 0; i < maxSubLayersMinus1; ++i)
+    {
+        if (subLayerProfilePresent[i]) reader.skip(88);
+        if (subLayerLevelPresent[i]) reader.skip(8);
+    }
+    reader.ue();  // sps_seq_parameter_set_id
+    const uint32_t chromaFormatIdc     = reader.ue();
+    const bool     separateColourPlane = chromaFormatIdc == 3 && reader.bit();
+    const uint32_t width               = reader.ue();
+    const uint32_t height              = reader.ue();
+    uint32_t       confLeft = 0, confRight = 0, confTop = 0, confBottom = 0;
+    if (reader.bit())
+    {
+        confLeft   = reader.ue();
+        confRight  = reader.ue();
+        confTop    = reader.ue();
+        confBottom = reader.ue();
+    }
+    if (reader.overrun()) return std::nullopt;
+
+    const auto    sub           = chromaSubsampling(chromaFormatIdc, separateColourPlane);
+    const int64_t croppedWidth  = int64_t{width} - sub[0] * (int64_t{confLeft} + confRight);
+    const int64_t croppedHeight = int64_t{height} - sub[1] * (int64_t{confTop} + confBottom);
+    if (croppedWidth <= 0 || croppedHeight <= 0 || croppedWidth > 16384 || croppedHeight > 16384) return std::nullopt;
+    return std::array<int, 2>{(int) croppedWidth, (int) croppedHeight};
+}
+}  // namespace SpsParser
+
+#endif  // PIXELPILOT_SPSPARSER_H
@@ -0,0 +1,248 @@
+//
+// Lock-free single-producer / single-consumer ring of fixed size packet slots.
+// Used to hand RTP packets from the wfb-ng aggregator thread to the video receiver thread without a socket hop.
+//
+
+#ifndef PIXELPILOT_SPSCPACKETRING_H
+#define PIXELPILOT_SPSCPACKETRING_H
+
+#include <sys/eventfd.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+
+/**
+ * @brief Bounded SPSC ring buffer holding up to N_SLOTS packets of at most SLOT_SIZE bytes each.
+ *
+ * push() must only ever be called from one (producer) thread, pop()/popWait() only from one (consumer) thread.
+ * The consumer reads the packet in place (no copy out of the ring). Each packet carries the time it was received,
+ * callbacks taking (data, length, time point) get it passed. When the ring is full, push() fails and the
+ * packet is dropped - the producer (radio RX) must never block on the video pipeline.
+ *
+ * With popRetain() the consumer keeps reading but defers releasing the slots until release(), so it can keep
+ * referencing packet data (zero-copy NALU assembly). Retained slots count against the capacity.
+ *
+ * The consumer may sleep in popWait() while the ring is empty. The producer only touches the mutex / condition
+ * variable when the consumer actually announced it is about to sleep, so a busy stream costs no syscalls at all.
+ * Instead of sleeping in popWait() the consumer may also poll an eventfd (setWakeupFd()) together with other fds,
+ * announcing that with prepareExternalWait() / finishExternalWait().
+ */
+template <std::size_t SLOT_SIZE, std::size_t N_SLOTS>
+class SpscPacketRing
+{
+    static_assert((N_SLOTS & (N_SLOTS - 1)) == 0, "N_SLOTS must be a power of two");
+
+  public:
+    SpscPacketRing() : mSlots(std::make_unique<std::array<Slot, N_SLOTS>>()) {}
+
+    SpscPacketRing(const SpscPacketRing&)            = delete;
+    SpscPacketRing& operator=(const SpscPacketRing&) = delete;
+
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    /**
+     * @brief Producer: copy one packet into the ring, received at @param rxTime.
+     * @return false if the packet is too big or the ring is full (packet dropped).
+     */
+    bool push(const uint8_t* data, std::size_t data_length, TimePoint rxTime = std::chrono::steady_clock::now())
+    {
+        if (data_length > SLOT_SIZE) return false;
+        const std::size_t tail = mTail.load(std::memory_order_relaxed);
+        if (tail - mCachedHead == N_SLOTS)
+        {
+            mCachedHead = mHead.load(std::memory_order_acquire);
+            if (tail - mCachedHead == N_SLOTS) return false;
+        }
+        Slot& slot = (*mSlots)[tail & (N_SLOTS - 1)];
+        std::memcpy(slot.data.data(), data, data_length);
+        slot.length = data_length;
+        slot.rxTime = rxTime;
+        mTail.store(tail + 1, std::memory_order_release);
+
+        // Pairs with the fence in popWait(): either the consumer sees the new tail, or we see it is sleeping.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (mConsumerSleeping.load(std::memory_order_relaxed))
+        {
+            const int wakeupFd = mWakeupFd.load(std::memory_order_relaxed);
+            if (wakeupFd != -1)
+            {
+                // Flag after writing, so the consumer never resets the eventfd before it got signalled
+                eventfd_write(wakeupFd, 1);
+                mWakeupFdSignalled.store(true, std::memory_order_release);
+            }
+            std::lock_guard<std::mutex> lock(mMutex);
+            mCv.notify_one();
+        }
+        return true;
+    }
+
+    /**
+     * @brief Consumer: if a packet is available, call callback(data, length) on it in place and release the slot.
+     * @return true if a packet was consumed.
+     */
+    template <typename Callback>
+    bool pop(Callback&& callback)
+    {
+        if (!popRetain(callback)) return false;
+        release();
+        return true;
+    }
+
+    /**
+     * @brief Consumer: like pop(), but the slot (and the data passed to the callback) stays valid until release().
+     * @return true if a packet was consumed.
+     */
+    template <typename Callback>
+    bool popRetain(Callback&& callback)
+    {
+        if (mRead == mCachedTail)
+        {
+            mCachedTail = mTail.load(std::memory_order_acquire);
+            if (mRead == mCachedTail) return false;
+        }
+        const Slot& slot = (*mSlots)[mRead & (N_SLOTS - 1)];
+        if constexpr (std::is_invocable_v<Callback&, const uint8_t*, std::size_t, TimePoint>)
+        {
+            callback(slot.data.data(), slot.length, slot.rxTime);
+        }
+        else
+        {
+            callback(slot.data.data(), slot.length);
+        }
+        mRead++;
+        return true;
+    }
+
+    /**
+     * @brief Consumer: give all slots consumed so far back to the producer.
+     */
+    void release() { mHead.store(mRead, std::memory_order_release); }
+
+    /**
+     * @brief Consumer: number of slots consumed with popRetain() but not released yet.
+     */
+    std::size_t retained() const { return mRead - mHead.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Consumer: like pop(), but sleeps up to @param timeout if the ring is empty.
+     * @return true if a packet was consumed.
+     */
+    template <typename Callback, typename Rep, typename Period>
+    bool popWait(Callback&& callback, const std::chrono::duration<Rep, Period>& timeout)
+    {
+        if (pop(callback)) return true;
+        waitForData(timeout);
+        return pop(callback);
+    }
+
+    /**
+     * @brief Consumer: like popRetain(), but sleeps up to @param timeout if the ring is empty.
+     */
+    template <typename Callback, typename Rep, typename Period>
+    bool popRetainWait(Callback&& callback, const std::chrono::duration<Rep, Period>& timeout)
+    {
+        if (popRetain(callback)) return true;
+        waitForData(timeout);
+        return popRetain(callback);
+    }
+
+    /**
+     * @brief Consumer: eventfd to signal (besides the condition variable) when the consumer sleeps outside of the
+     * ring, -1 for none. Must stay open as long as a producer may push.
+     */
+    void setWakeupFd(int fd) { mWakeupFd.store(fd, std::memory_order_relaxed); }
+
+    /**
+     * @brief Consumer: about to sleep on the wakeup fd.
+     * @return false if there is data already (don't sleep), finishExternalWait() is still required.
+     */
+    bool prepareExternalWait()
+    {
+        mConsumerSleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return empty();
+    }
+
+    /**
+     * @brief Consumer: woke up (or didn't sleep at all), resets the wakeup fd if it got signalled.
+     */
+    void finishExternalWait()
+    {
+        mConsumerSleeping.store(false, std::memory_order_relaxed);
+        if (mWakeupFdSignalled.exchange(false, std::memory_order_acquire))
+        {
+            eventfd_t value;
+            eventfd_read(mWakeupFd.load(std::memory_order_relaxed), &value);
+        }
+    }
+
+    /**
+     * @brief Wake up a consumer sleeping in popWait() (e.g. on shutdown).
+     */
+    void wakeConsumer()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mCv.notify_all();
+    }
+
+    /**
+     * @brief Consumer: sleep up to @param timeout unless there is data already (or the producer pushes some).
+     */
+    template <typename Rep, typename Period>
+    void waitForData(const std::chrono::duration<Rep, Period>& timeout)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mConsumerSleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (empty())
+        {
+            mCv.wait_for(lock, timeout);
+        }
+        mConsumerSleeping.store(false, std::memory_order_relaxed);
+    }
+
+    // Consumer side: nothing left to read (retained slots don't count)
+    bool empty() const { return mRead == mTail.load(std::memory_order_acquire); }
+
+    // Slots in use, retained ones included
+    std::size_t size() const { return mTail.load(std::memory_order_acquire) - mHead.load(std::memory_order_acquire); }
+
+    static constexpr std::size_t capacity() { return N_SLOTS; }
+
+    static constexpr std::size_t slotSize() { return SLOT_SIZE; }
+
+  private:
+    struct Slot
+    {
+        std::size_t                     length = 0;
+        TimePoint                       rxTime;
+        std::array<uint8_t, SLOT_SIZE> data;
+    };
+
+    std::unique_ptr<std::array<Slot, N_SLOTS>> mSlots;
+
+    // Consumer owned. mHead is what the producer may overwrite up to, mRead is the next slot to read.
+    alignas(64) std::atomic<std::size_t> mHead{0};
+    std::size_t mRead       = 0;
+    std::size_t mCachedTail = 0;
+    // Producer owned
+    alignas(64) std::atomic<std::size_t> mTail{0};
+    std::size_t mCachedHead = 0;
+
+    // Only used when the consumer runs out of data
+    alignas(64) std::atomic<bool> mConsumerSleeping{false};
+    std::mutex              mMutex;
+    std::condition_variable mCv;
+    std::atomic<int>        mWakeupFd{-1};
+    std::atomic<bool>       mWakeupFdSignalled{false};
+};
+
+#endif  // PIXELPILOT_SPSCPACKETRING_H
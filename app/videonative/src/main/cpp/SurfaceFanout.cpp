@@ -0,0 +1,376 @@
+#include "SurfaceFanout.h"
+
+#include <android/hardware_buffer.h>
+#include <android/sync.h>
+#include <dlfcn.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include "helper/AndroidLogger.hpp"
+
+// The SurfaceControl NDK api is Android 10+, looked up at runtime since minSdk is lower
+struct ASurfaceControl;
+struct ASurfaceTransaction;
+struct ASurfaceTransactionStats;
+
+namespace
+{
+constexpr int8_t VISIBILITY_SHOW = 1;  // ASURFACE_TRANSACTION_VISIBILITY_SHOW
+
+struct SurfaceControlApi
+{
+    using OnComplete       = void (*)(void* context, ASurfaceTransactionStats* stats);
+    using CreateFromWindow = ASurfaceControl* (*) (ANativeWindow*, const char*);
+    using Release          = void (*)(ASurfaceControl*);
+    using Create           = ASurfaceTransaction* (*) ();
+    using Transaction      = void (*)(ASurfaceTransaction*);
+    using SetOnComplete    = void (*)(ASurfaceTransaction*, void*, OnComplete);
+    using Reparent         = void (*)(ASurfaceTransaction*, ASurfaceControl*, ASurfaceControl*);
+    using SetVisibility    = void (*)(ASurfaceTransaction*, ASurfaceControl*, int8_t);
+    using SetBuffer        = void (*)(ASurfaceTransaction*, ASurfaceControl*, AHardwareBuffer*, int);
+    using SetGeometry      = void (*)(ASurfaceTransaction*, ASurfaceControl*, const ARect&, const ARect&, int32_t);
+    using GetReleaseFence  = int (*)(ASurfaceTransactionStats*, ASurfaceControl*);
+
+    CreateFromWindow createFromWindow          = nullptr;
+    Release          release                   = nullptr;
+    Create           createTransaction         = nullptr;
+    Transaction      deleteTransaction         = nullptr;
+    Transaction      apply                     = nullptr;
+    SetOnComplete    setOnComplete             = nullptr;
+    Reparent         reparent                  = nullptr;
+    SetVisibility    setVisibility             = nullptr;
+    SetBuffer        setBuffer                 = nullptr;
+    SetGeometry      setGeometry               = nullptr;
+    GetReleaseFence  getPreviousReleaseFenceFd = nullptr;
+    // All of the above were found
+    bool available = true;
+
+    SurfaceControlApi()
+    {
+        lookup(createFromWindow, "ASurfaceControl_createFromWindow");
+        lookup(release, "ASurfaceControl_release");
+        lookup(createTransaction, "ASurfaceTransaction_create");
+        lookup(deleteTransaction, "ASurfaceTransaction_delete");
+        lookup(apply, "ASurfaceTransaction_apply");
+        lookup(setOnComplete, "ASurfaceTransaction_setOnComplete");
+        lookup(reparent, "ASurfaceTransaction_reparent");
+        lookup(setVisibility, "ASurfaceTransaction_setVisibility");
+        lookup(setBuffer, "ASurfaceTransaction_setBuffer");
+        lookup(setGeometry, "ASurfaceTransaction_setGeometry");
+        lookup(getPreviousReleaseFenceFd, "ASurfaceTransactionStats_getPreviousReleaseFenceFd");
+    }
+
+    template <typename F>
+    void lookup(F& function, const char* name)
+    {
+        function = reinterpret_cast<F>(dlsym(RTLD_DEFAULT, name));
+        if (function == nullptr) MLOGD << name << " not available";
+        available = available && function != nullptr;
+    }
+};
+
+const SurfaceControlApi& api()
+{
+    static const SurfaceControlApi API;
+    return API;
+}
+
+// Biggest rectangle with the aspect ratio of width x height that fits into the output, centered
+ARect letterbox(int32_t width, int32_t height, int32_t outputWidth, int32_t outputHeight)
+{
+    if (width <= 0 || height <= 0 || outputWidth <= 0 || outputHeight <= 0) return {0, 0, outputWidth, outputHeight};
+    if (int64_t{outputWidth} * height <= int64_t{outputHeight} * width)
+    {
+        // Full width, bars at the top and bottom
+        const auto scaled = static_cast<int32_t>(int64_t{outputWidth} * height / width);
+        const auto top    = (outputHeight - scaled) / 2;
+        return {0, top, outputWidth, top + scaled};
+    }
+    const auto scaled = static_cast<int32_t>(int64_t{outputHeight} * width / height);
+    const auto left   = (outputWidth - scaled) / 2;
+    return {left, 0, left + scaled, outputHeight};
+}
+
+// A decoded picture of the image reader, back to the decoder once the last output is done reading it
+class ImageFrame : public FanoutFrame
+{
+  public:
+    ImageFrame(std::shared_ptr<AImageReader> reader, AImage* image, int acquireFence)
+        : mReader(std::move(reader)), mImage(image), mAcquireFence(acquireFence)
+    {
+    }
+
+    ~ImageFrame() override
+    {
+        if (mAcquireFence >= 0) close(mAcquireFence);
+        // Takes the release fence, the decoder writes to the buffer again once it signaled
+        AImage_deleteAsync(mImage, mReleaseFence);
+    }
+
+    AHardwareBuffer* getBuffer() const
+    {
+        AHardwareBuffer* buffer = nullptr;
+        AImage_getHardwareBuffer(mImage, &buffer);
+        return buffer;
+    }
+
+    // -1 if the decoder is done writing already
+    int dupAcquireFence() const { return mAcquireFence < 0 ? -1 : dup(mAcquireFence); }
+
+    // An output stopped reading the buffer when fence signals, takes fence
+    void addReleaseFence(int fence)
+    {
+        if (fence < 0) return;
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mReleaseFence < 0)
+        {
+            mReleaseFence = fence;
+            return;
+        }
+        const int merged = sync_merge("fanout", mReleaseFence, fence);
+        close(mReleaseFence);
+        close(fence);
+        mReleaseFence = merged;
+    }
+
+  private:
+    const std::shared_ptr<AImageReader> mReader;
+    AImage* const                       mImage;
+    const int                           mAcquireFence;
+    std::mutex                          mMutex;
+    int                                 mReleaseFence = -1;
+};
+}  // namespace
+
+// One output surface. Its SurfaceControl is a child of the output window, showing the frames on top of it
+class SurfaceSink : public FanoutSink, public std::enable_shared_from_this<SurfaceSink>
+{
+  public:
+    SurfaceSink(ASurfaceControl* surfaceControl, ANativeWindow* output, std::weak_ptr<FrameFanout> fanout)
+        : mSurfaceControl(surfaceControl), mOutput(output), mFanout(std::move(fanout))
+    {
+    }
+
+    ~SurfaceSink() override { api().release(mSurfaceControl); }
+
+    void setId(int id) { mId = id; }
+
+    int getId() const { return mId; }
+
+    // Part of the frames to show, the whole buffer while empty
+    void setPicture(const ARect& picture)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mPicture = picture;
+    }
+
+    void present(std::shared_ptr<FanoutFrame> frame) override
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mDetached) return;
+        auto&                image = static_cast<ImageFrame&>(*frame);
+        AHardwareBuffer_Desc desc{};
+        AHardwareBuffer_describe(image.getBuffer(), &desc);
+        ARect source{0, 0, static_cast<int32_t>(desc.width), static_cast<int32_t>(desc.height)};
+        if (mPicture.right > mPicture.left && mPicture.bottom > mPicture.top)
+        {
+            source = {
+                std::max(mPicture.left, 0),
+                std::max(mPicture.top, 0),
+                std::min(mPicture.right, source.right),
+                std::min(mPicture.bottom, source.bottom)};
+        }
+        // The output window follows the video ratio only after a layout pass, the bars fill in until then
+        const ARect destination = letterbox(
+            source.right - source.left,
+            source.bottom - source.top,
+            ANativeWindow_getWidth(mOutput),
+            ANativeWindow_getHeight(mOutput));
+
+        ASurfaceTransaction* transaction = api().createTransaction();
+        api().setBuffer(transaction, mSurfaceControl, image.getBuffer(), image.dupAcquireFence());
+        api().setGeometry(transaction, mSurfaceControl, source, destination, 0);
+        api().setVisibility(transaction, mSurfaceControl, VISIBILITY_SHOW);
+        // The sink and the frame stay alive until the transaction completed
+        api().setOnComplete(transaction, new Presented{shared_from_this(), std::move(frame)}, &SurfaceSink::onComplete);
+        api().apply(transaction);
+        api().deleteTransaction(transaction);
+    }
+
+    // Hides the surface, frames presented afterwards are ignored
+    void detach()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mDetached                        = true;
+        ASurfaceTransaction* transaction = api().createTransaction();
+        api().reparent(transaction, mSurfaceControl, nullptr);
+        api().apply(transaction);
+        api().deleteTransaction(transaction);
+    }
+
+  private:
+    struct Presented
+    {
+        std::shared_ptr<SurfaceSink> sink;
+        std::shared_ptr<FanoutFrame> frame;
+    };
+
+    // On a binder thread, once the frame is on screen
+    static void onComplete(void* context, ASurfaceTransactionStats* stats)
+    {
+        std::unique_ptr<Presented>   presented(static_cast<Presented*>(context));
+        SurfaceSink&                 self = *presented->sink;
+        std::shared_ptr<FanoutFrame> replaced;
+        {
+            std::lock_guard<std::mutex> lock(self.mMutex);
+            // The fence of the buffer this transaction replaced on screen
+            if (self.mOnScreen)
+            {
+                static_cast<ImageFrame&>(*self.mOnScreen)
+                    .addReleaseFence(api().getPreviousReleaseFenceFd(stats, self.mSurfaceControl));
+            }
+            replaced       = std::move(self.mOnScreen);
+            self.mOnScreen = std::move(presented->frame);
+        }
+        replaced.reset();
+        if (auto fanout = self.mFanout.lock()) fanout->onSinkReady(self.mId);
+    }
+
+    ASurfaceControl* const           mSurfaceControl;
+    ANativeWindow* const             mOutput;
+    const std::weak_ptr<FrameFanout> mFanout;
+    ARect                            mPicture{};
+    int                              mId = -1;
+    std::mutex                       mMutex;
+    bool                             mDetached = false;
+    std::shared_ptr<FanoutFrame>     mOnScreen;
+};
+
+bool SurfaceFanout::isSupported()
+{
+    return api().available;
+}
+
+std::unique_ptr<SurfaceFanout> SurfaceFanout::create(
+    int videoWidth, int videoHeight, const std::vector<ANativeWindow*>& outputs)
+{
+    if (!isSupported() || outputs.empty() || outputs.size() > FrameFanout::MAX_SINKS) return nullptr;
+    std::unique_ptr<SurfaceFanout> self(new SurfaceFanout());
+
+    for (ANativeWindow* output : outputs)
+    {
+        ASurfaceControl* surfaceControl = api().createFromWindow(output, "PixelPilotFanout");
+        if (surfaceControl == nullptr)
+        {
+            MLOGE << "Cannot create surface control";
+            return nullptr;
+        }
+        auto sink = std::make_shared<SurfaceSink>(surfaceControl, output, self->mFanout);
+        sink->setId(self->mFanout->addSink(sink));
+        self->mSinks.push_back(std::move(sink));
+    }
+
+    if (!self->createReader(videoWidth, videoHeight)) return nullptr;
+    MLOGD << "Decoding " << videoWidth << "x" << videoHeight << " for " << outputs.size() << " surfaces";
+    return self;
+}
+
+bool SurfaceFanout::createReader(int width, int height)
+{
+    AImageReader*  reader = nullptr;
+    media_status_t status = AImageReader_newWithUsage(
+        width,
+        height,
+        AIMAGE_FORMAT_PRIVATE,
+        AHARDWAREBUFFER_USAGE_GPU_SAMPLED_IMAGE | AHARDWAREBUFFER_USAGE_COMPOSER_OVERLAY,
+        static_cast<int32_t>(FrameFanout::framesNeeded(mSinks.size())),
+        &reader);
+    if (status != AMEDIA_OK)
+    {
+        MLOGE << "Cannot create image reader " << width << "x" << height << ": " << (int) status;
+        return false;
+    }
+    ANativeWindow* window = nullptr;
+    if (AImageReader_getWindow(reader, &window) != AMEDIA_OK)
+    {
+        AImageReader_delete(reader);
+        return false;
+    }
+    AImageReader_ImageListener listener{this, &SurfaceFanout::onImageAvailable};
+    AImageReader_setImageListener(reader, &listener);
+    {
+        std::lock_guard<std::mutex> lock(mReaderMutex);
+        // The previous reader lives on until the frames acquired from it are released
+        if (mReader) AImageReader_setImageListener(mReader.get(), nullptr);
+        mReader = std::shared_ptr<AImageReader>(reader, AImageReader_delete);
+    }
+    mDecoderWindow = window;
+    mWidth         = width;
+    mHeight        = height;
+    return true;
+}
+
+bool SurfaceFanout::onOutputFormatChanged(
+    int width, int height, const ARect& picture, const std::function<bool(ANativeWindow*)>& setDecoderWindow)
+{
+    for (auto& sink : mSinks) sink->setPicture(picture);
+    if (width == mWidth && height == mHeight) return true;
+    MLOGD << "Frame size changed from " << mWidth << "x" << mHeight << " to " << width << "x" << height;
+    const std::shared_ptr<AImageReader> previous       = mReader;
+    ANativeWindow* const                previousWindow = mDecoderWindow;
+    const int                           previousWidth  = mWidth;
+    const int                           previousHeight = mHeight;
+    if (!createReader(width, height)) return false;
+    if (setDecoderWindow(mDecoderWindow)) return true;
+    MLOGE << "Cannot switch the decoder to the new image reader";
+    // Back to the reader the decoder still renders into
+    AImageReader_ImageListener listener{this, &SurfaceFanout::onImageAvailable};
+    AImageReader_setImageListener(previous.get(), &listener);
+    {
+        std::lock_guard<std::mutex> lock(mReaderMutex);
+        AImageReader_setImageListener(mReader.get(), nullptr);
+        mReader = previous;
+    }
+    mDecoderWindow = previousWindow;
+    mWidth         = previousWidth;
+    mHeight        = previousHeight;
+    return false;
+}
+
+SurfaceFanout::~SurfaceFanout()
+{
+    {
+        std::lock_guard<std::mutex> lock(mReaderMutex);
+        if (mReader) AImageReader_setImageListener(mReader.get(), nullptr);
+    }
+    for (auto& sink : mSinks) sink->detach();
+    // Frames still on screen or in flight keep their sink and the image reader alive until the transaction completed
+    mFanout.reset();
+    mSinks.clear();
+}
+
+long SurfaceFanout::getDroppedFrames() const
+{
+    long dropped = 0;
+    for (const auto& sink : mSinks) dropped += mFanout->getStats(sink->getId()).nDropped;
+    return dropped;
+}
+
+// On the image reader's thread
+void SurfaceFanout::onImageAvailable(void* context, AImageReader* reader)
+{
+    auto*                         self = static_cast<SurfaceFanout*>(context);
+    std::shared_ptr<AImageReader> owner;
+    {
+        std::lock_guard<std::mutex> lock(self->mReaderMutex);
+        // A reader replaced after a frame size change
+        if (self->mReader.get() != reader) return;
+        owner = self->mReader;
+    }
+    AImage* image = nullptr;
+    int     fence = -1;
+    // Only the newest one, older ones would be dropped by every output anyways
+    if (AImageReader_acquireLatestImageAsync(reader, &image, &fence) != AMEDIA_OK || image == nullptr) return;
+    self->mFanout->onFrame(std::make_shared<ImageFrame>(std::move(owner), image, fence));
+}
@@ -0,0 +1,72 @@
+//
+// Android side of FrameFanout: the decoder renders into an AImageReader, every output surface shows its images with a
+// SurfaceControl. Android 10+ (SurfaceControl NDK api).
+//
+
+#ifndef PIXELPILOT_SURFACEFANOUT_H
+#define PIXELPILOT_SURFACEFANOUT_H
+
+#include <android/native_window.h>
+#include <media/NdkImageReader.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "FrameFanout.h"
+
+class SurfaceSink;
+
+/**
+ * @brief One decoder for several output surfaces.
+ *
+ * Configure the decoder with getDecoderWindow() instead of an output surface. Each decoded picture is shown on all
+ * outputs from the same hardware buffer, no copies. A slow output drops frames (see FrameFanout) instead of holding
+ * back the decoder or the other outputs. Every output shows the picture letterboxed, keeping its aspect ratio.
+ * Destroy only after the decoder was stopped.
+ */
+class SurfaceFanout
+{
+  public:
+    // False before Android 10
+    static bool isSupported();
+
+    // nullptr on failure. The windows are not taken over, they have to stay valid for as long as the fan-out exists
+    static std::unique_ptr<SurfaceFanout> create(
+        int videoWidth, int videoHeight, const std::vector<ANativeWindow*>& outputs);
+
+    /**
+     * The decoder output format changed: frames are width x height, of which picture is shown.
+     * If the frame size differs from the one of the image reader, a new reader is created and its window handed to
+     * setDecoderWindow (AMediaCodec_setOutputSurface()). false if that failed, the old reader is kept then.
+     */
+    bool onOutputFormatChanged(
+        int width, int height, const ARect& picture, const std::function<bool(ANativeWindow*)>& setDecoderWindow);
+
+    ~SurfaceFanout();
+
+    // Owned by the fan-out
+    ANativeWindow* getDecoderWindow() const { return mDecoderWindow; }
+
+    // Frames dropped by all outputs together
+    long getDroppedFrames() const;
+
+  private:
+    SurfaceFanout() = default;
+
+    // Sets mReader and mDecoderWindow, false on failure
+    bool createReader(int width, int height);
+
+    static void onImageAvailable(void* context, AImageReader* reader);
+
+    // Deleted with the last image acquired from it, AImage_deleteAsync() needs it. Replaced on a frame size change,
+    // guarded by mReaderMutex
+    std::shared_ptr<AImageReader>             mReader;
+    std::mutex                                mReaderMutex;
+    ANativeWindow*                            mDecoderWindow = nullptr;
+    int                                       mWidth         = 0;
+    int                                       mHeight        = 0;
+    std::shared_ptr<FrameFanout>              mFanout        = std::make_shared<FrameFanout>();
+    std::vector<std::shared_ptr<SurfaceSink>> mSinks;
+};
+
+#endif  // PIXELPILOT_SURFACEFANOUT_H
@@ -35,6 +35,11 @@ void UDPReceiver::registerOnSourceIPFound(SOURCE_IP_CALLBACK onSourceIP1)
     this->onSourceIP = std::move(onSourceIP1);
 }
 
+void UDPReceiver::setBatchCallback(BATCH_CALLBACK onBatchReceived1)
+{
+    this->onBatchReceived = std::move(onBatchReceived1);
+}
+
 long UDPReceiver::getNReceivedBytes() const
 {
     return nReceivedBytes;
@@ -59,20 +64,55 @@ void UDPReceiver::stopReceiving()
     receiving = false;
     // this stops the recvfrom even if in blocking mode
     shutdown(mSocket, SHUT_RD);
-    if (mUDPReceiverThread->joinable())
+    if (mUDPReceiverThread && mUDPReceiverThread->joinable())
     {
         mUDPReceiverThread->join();
     }
     mUDPReceiverThread.reset();
 }
 
-void UDPReceiver::receiveFromUDPLoop()
+bool UDPReceiver::openSource()
+{
+    if (mUDPReceiverThread || !openSocket()) return false;
+    MLOGD << "Polling " << INADDR_ANY << ":" << mPort;
+    return true;
+}
+
+void UDPReceiver::closeSource()
+{
+    close(mSocket);
+    mSocket = -1;
+}
+
+size_t UDPReceiver::drain(const size_t maxPackets, const bool deliver)
+{
+    size_t taken = 0;
+    while (taken < maxPackets)
+    {
+        const int n = mBatch->receive(mSocket, MSG_DONTWAIT);
+        if (n <= 0)
+        {
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                MLOGE << "Error on recvmmsg. errno=" << errno << " " << strerror(errno);
+            }
+            break;
+        }
+        taken += n;
+        if (deliver) onDatagrams(mBatch->datagrams());
+        // Less than a full batch, the socket is empty
+        if (static_cast<size_t>(n) < mBatch->batchSize()) break;
+    }
+    return taken;
+}
+
+bool UDPReceiver::openSocket()
 {
     mSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
     if (mSocket == -1)
     {
         MLOGD << "Error creating socket";
-        return;
+        return false;
     }
     int enable = 1;
     if (setsockopt(mSocket, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(int)) < 0)
@@ -95,11 +135,10 @@ void UDPReceiver::receiveFromUDPLoop()
         MLOGD << "Wanted " << StringHelper::memorySizeReadable(WANTED_RCVBUF_SIZE) << " Set "
               << StringHelper::memorySizeReadable(recvBufferSize);
     }
-    if (javaVm != nullptr)
+    // Kernel receive timestamps, to tell how long packets waited in the socket buffer
+    if (!DatagramBatch::enableTimestamps(mSocket))
     {
-#ifdef __ANDROID__
-        NDKThreadHelper::setProcessThreadPriorityAttachDetach(javaVm, mCPUPriority, mName.c_str());
-#endif
+        MLOGD << "Cannot enable receive timestamps";
     }
     struct sockaddr_in myaddr;
     memset((uint8_t*) &myaddr, 0, sizeof(myaddr));
@@ -109,53 +148,82 @@ void UDPReceiver::receiveFromUDPLoop()
     if (bind(mSocket, (struct sockaddr*) &myaddr, sizeof(myaddr)) == -1)
     {
         MLOGE << "Error binding Port; " << mPort;
-        return;
+        close(mSocket);
+        mSocket = -1;
+        return false;
     }
-    // wrap into unique pointer to avoid running out of stack
-    const auto buff = std::make_unique<std::array<uint8_t, UDP_PACKET_MAX_SIZE>>();
+    // Up to BATCH_SIZE datagrams per syscall
+    if (!mBatch) mBatch = std::make_unique<DatagramBatch>(BATCH_SIZE, UDP_PACKET_MAX_SIZE);
+    return true;
+}
 
+void UDPReceiver::receiveFromUDPLoop()
+{
+    if (!openSocket()) return;
+    if (javaVm != nullptr)
+    {
+#ifdef __ANDROID__
+        NDKThreadHelper::setProcessThreadPriorityAttachDetach(javaVm, mCPUPriority, mName.c_str());
+#endif
+    }
     MLOGD << "Listening on " << INADDR_ANY << ":" << mPort;
 
-    sockaddr_in source;
-    socklen_t   sourceLen = sizeof(sockaddr_in);
-
     while (receiving)
     {
-        // TODO investigate: does a big buffer size create latency with MSG_WAITALL ?
-        // I do not think so. recvfrom should return as soon as new data arrived,not when the buffer is full
-        // But with a bigger buffer we do not loose packets when the receiver thread cannot keep up for a short amount
-        // of time
-        //  MSG_WAITALL does not wait until we have __n data, but a new UDP packet (that can be smaller than __n)
-        const ssize_t message_length =
-            recvfrom(mSocket, buff->data(), UDP_PACKET_MAX_SIZE, 0, (sockaddr*) &source, &sourceLen);
-        // ssize_t message_length = recv(mSocket, buff, (size_t) mBuffsize, MSG_WAITALL);
-        if (message_length > 0)
-        {  // else -1 was returned;timeout/No data received
-            onDataReceivedCallback(buff->data(), (size_t) message_length);
-
-            nReceivedBytes += message_length;
-            // The source ip stuff
-            const char* p  = inet_ntoa(source.sin_addr);
-            std::string s1 = std::string(p);
-            // MLOGE << "received " << message_length <<  " bytes from " << s1;
-            if (senderIP != s1)
-            {
-                senderIP = s1;
-            }
-            if (onSourceIP != nullptr)
-            {
-                onSourceIP(p);
-            }
+        // Returns as soon as one datagram arrived, plus whatever else is already queued (at high data rates, or
+        // after this thread got scheduled out for a moment), so there is one syscall per batch instead of per packet
+        const int n = mBatch->receive(mSocket);
+        if (n > 0)
+        {
+            onDatagrams(mBatch->datagrams());
         }
-        else
+        else if (n < 0)
         {
             if (errno != EWOULDBLOCK)
             {
-                MLOGE << "Error on recvfrom. errno=" << errno << " " << strerror(errno);
+                MLOGE << "Error on recvmmsg. errno=" << errno << " " << strerror(errno);
             }
         }
     }
     close(mSocket);
+    mSocket = -1;
+}
+
+void UDPReceiver::onDatagrams(const std::span<const ReceivedDatagram> datagrams)
+{
+    if (onBatchReceived != nullptr)
+    {
+        onBatchReceived(datagrams);
+    }
+    else
+    {
+        for (const ReceivedDatagram& datagram : datagrams)
+        {
+            onDataReceivedCallback(datagram.data, datagram.size);
+        }
+    }
+    for (const ReceivedDatagram& datagram : datagrams)
+    {
+        nReceivedBytes += datagram.size;
+    }
+    // The source ip stuff, only when the sender changed
+    const ReceivedDatagram& last = datagrams.back();
+    updateSourceIP(last.source, last.sourceLen);
+}
+
+void UDPReceiver::updateSourceIP(const sockaddr* source, const socklen_t sourceLen)
+{
+    if (sourceLen < sizeof(sockaddr_in)) return;
+    const auto& address = *reinterpret_cast<const sockaddr_in*>(source);
+    if (address.sin_addr.s_addr == lastSource.sin_addr.s_addr && lastSource.sin_family == AF_INET) return;
+    lastSource = address;
+    char ip[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &address.sin_addr, ip, sizeof(ip));
+    senderIP = ip;
+    if (onSourceIP != nullptr)
+    {
+        onSourceIP(senderIP);
+    }
 }
 
 int UDPReceiver::getPort() const
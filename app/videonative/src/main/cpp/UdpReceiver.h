@@ -11,15 +11,22 @@
 #include <unistd.h>
 #include <atomic>
 #include <cstdio>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <span>
 #include <thread>
-// Starts a new thread that continuously checks for new data on UDP port
+#include "DatagramBatch.h"
+#include "IngestSource.h"
+// Starts a new thread that continuously checks for new data on UDP port, or is polled by an IngestReactor
 
-class UDPReceiver
+class UDPReceiver : public IngestSource
 {
   public:
-    typedef std::function<void(const uint8_t[], size_t)> DATA_CALLBACK;
-    typedef std::function<void(const std::string)>       SOURCE_IP_CALLBACK;
+    typedef std::function<void(const uint8_t[], size_t)>          DATA_CALLBACK;
+    typedef std::function<void(const std::string)>                SOURCE_IP_CALLBACK;
+    // All datagrams one recvmmsg call returned
+    typedef std::function<void(std::span<const ReceivedDatagram>)> BATCH_CALLBACK;
 
   public:
     /**
@@ -43,10 +50,17 @@ class UDPReceiver
         size_t        WANTED_RCVBUF_SIZE = 0);
 
     /**
-     * Register a callback that is called once and contains the IP address of the first received packet's sender
+     * Register a callback that is called with the IP address of the first received packet's sender, and again
+     * whenever the sender changes
      */
     void registerOnSourceIPFound(SOURCE_IP_CALLBACK onSourceIP1);
 
+    /**
+     * Hand over received datagrams batch-wise instead of one by one to onDataReceivedCallback.
+     * Must be set before startReceiving().
+     */
+    void setBatchCallback(BATCH_CALLBACK onBatchReceived1);
+
     /**
      * Start receiver thread,which opens UDP port
      */
@@ -57,6 +71,15 @@ class UDPReceiver
      */
     void stopReceiving();
 
+    // IngestSource, instead of startReceiving() / stopReceiving()
+    bool openSource() override;
+
+    void closeSource() override;
+
+    int pollFd() const override { return mSocket; }
+
+    size_t drain(size_t maxPackets, bool deliver) override;
+
     // Get function(s) for private member variables
     long getNReceivedBytes() const;
 
@@ -67,22 +90,35 @@ class UDPReceiver
   private:
     void receiveFromUDPLoop();
 
+    // Create and bind mSocket, allocate mBatch
+    bool openSocket();
+
+    void onDatagrams(std::span<const ReceivedDatagram> datagrams);
+
+    void updateSourceIP(const sockaddr* source, socklen_t sourceLen);
+
     const DATA_CALLBACK onDataReceivedCallback = nullptr;
     SOURCE_IP_CALLBACK  onSourceIP             = nullptr;
+    BATCH_CALLBACK      onBatchReceived        = nullptr;
     const int           mPort;
     const int           mCPUPriority;
     // Hmm....
     const size_t      WANTED_RCVBUF_SIZE;
     const std::string mName;
     /// We need this reference to stop the receiving thread
-    int                          mSocket        = 0;
-    std::string                  senderIP       = "0.0.0.0";
-    std::atomic<bool>            receiving      = false;
-    std::atomic<long>            nReceivedBytes = 0;
-    std::unique_ptr<std::thread> mUDPReceiverThread;
+    int                            mSocket = -1;
+    std::unique_ptr<DatagramBatch> mBatch;
+    std::string                    senderIP = "0.0.0.0";
+    // Sender of the last datagram, senderIP is only rebuilt when it changes
+    sockaddr_in                    lastSource{};
+    std::atomic<bool>              receiving      = false;
+    std::atomic<long>              nReceivedBytes = 0;
+    std::unique_ptr<std::thread>   mUDPReceiverThread;
     // https://en.wikipedia.org/wiki/User_Datagram_Protocol
     // 65,507 bytes (65,535 − 8 byte UDP header − 20 byte IP header).
     static constexpr const size_t UDP_PACKET_MAX_SIZE = 65507;
+    // Datagrams taken per recvmmsg call at most
+    static constexpr const size_t BATCH_SIZE = 16;
     JavaVM*                       javaVm;
 };
 
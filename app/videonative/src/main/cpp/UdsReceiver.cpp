@@ -1,6 +1,7 @@
 #include "UdsReceiver.h"
 
-#include <array>
+#include <algorithm>
+#include <cstddef>
 #include <cstring>
 #include "helper/AndroidLogger.hpp"
 #include "helper/NDKThreadHelper.hpp"
@@ -8,7 +9,8 @@
 
 namespace
 {
-constexpr size_t MAX_PKT = 3700;  // safe MTU‑sized buffer
+constexpr size_t MAX_PKT    = 3700;  // safe MTU‑sized buffer
+constexpr size_t BATCH_SIZE = 16;    // datagrams per recvmmsg at most
 }
 
 UDSReceiver::UDSReceiver(JavaVM* jvm, std::string path, std::string name, int prio, DATA_CALLBACK cb, size_t wanted)
@@ -38,13 +40,46 @@ void UDSReceiver::stopReceiving()
     mThread.reset();
 }
 
-void UDSReceiver::receiveLoop()
+bool UDSReceiver::openSource()
+{
+    if (mThread || !openSocket()) return false;
+    MLOGD << "UDS polled on '" << mSocketPath << '\'';
+    return true;
+}
+
+void UDSReceiver::closeSource()
+{
+    closeSocket();
+}
+
+size_t UDSReceiver::drain(const size_t maxPackets, const bool deliver)
+{
+    size_t taken = 0;
+    while (taken < maxPackets)
+    {
+        const int n = mBatch->receive(mSocket, MSG_DONTWAIT);
+        if (n <= 0)
+        {
+            if (n == -1 && errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                MLOGE << "recvmmsg error: " << strerror(errno);
+            }
+            break;
+        }
+        taken += n;
+        if (deliver) onDatagrams(mBatch->datagrams());
+        if (static_cast<size_t>(n) < mBatch->batchSize()) break;
+    }
+    return taken;
+}
+
+bool UDSReceiver::openSocket()
 {
     mSocket = socket(AF_UNIX, SOCK_DGRAM, 0);
     if (mSocket == -1)
     {
         MLOGE << "socket(AF_UNIX) failed: " << strerror(errno);
-        return;
+        return false;
     }
 
     // upscale recv buf (same logic as UDP)
@@ -58,6 +93,8 @@ void UDSReceiver::receiveLoop()
         MLOGD << "UDS recvbuf set to " << StringHelper::memorySizeReadable(cur);
     }
 
+    DatagramBatch::enableTimestamps(mSocket);
+
     // ---- bind to either abstract or filesystem Unix‑domain socket ----
     sockaddr_un addr{};
     addr.sun_family = AF_UNIX;
@@ -85,44 +122,75 @@ void UDSReceiver::receiveLoop()
         MLOGE << "bind(" << what << ") failed: " << strerror(errno);
         close(mSocket);
         mSocket = -1;
-        return;
+        return false;
     }
+    if (!mBatch) mBatch = std::make_unique<DatagramBatch>(BATCH_SIZE, MAX_PKT);
+    return true;
+}
+
+void UDSReceiver::closeSocket()
+{
+    close(mSocket);
+    unlink(mSocketPath.c_str());
+    mSocket = -1;
+}
+
+void UDSReceiver::receiveLoop()
+{
+    if (!openSocket()) return;
 
 #ifdef __ANDROID__
     if (javaVm) NDKThreadHelper::setProcessThreadPriorityAttachDetach(javaVm, mCPUPriority, mName.c_str());
 #endif
 
-    const auto buf = std::make_unique<std::array<uint8_t, MAX_PKT>>();
     MLOGD << "UDS listening on '" << mSocketPath << '\'';
 
-    sockaddr_un peer{};
-    socklen_t   peerLen = sizeof(peer);
-
     while (receiving)
     {
-        ssize_t n = recvfrom(mSocket, buf->data(), buf->size(), 0, reinterpret_cast<sockaddr*>(&peer), &peerLen);
+        const int n = mBatch->receive(mSocket);
         if (n > 0)
         {
-            onData(buf->data(), static_cast<size_t>(n));
-            nReceivedBytes += n;
-
-            if (peer.sun_path[0] != '\0')
-            {
-                std::string p(peer.sun_path);
-                if (p != senderPath)
-                {
-                    senderPath = p;
-                    if (onSource) onSource(senderPath.c_str());
-                }
-            }
+            onDatagrams(mBatch->datagrams());
         }
         else if (n == -1 && errno != EAGAIN && errno != EWOULDBLOCK)
         {
-            MLOGE << "recvfrom error: " << strerror(errno);
+            MLOGE << "recvmmsg error: " << strerror(errno);
         }
     }
 
-    close(mSocket);
-    unlink(mSocketPath.c_str());
-    mSocket = -1;
+    closeSocket();
+}
+
+void UDSReceiver::onDatagrams(const std::span<const ReceivedDatagram> datagrams)
+{
+    if (onBatch)
+    {
+        onBatch(datagrams);
+    }
+    else
+    {
+        for (const ReceivedDatagram& d : datagrams)
+        {
+            onData(d.data, d.size);
+        }
+    }
+    for (const ReceivedDatagram& d : datagrams)
+    {
+        nReceivedBytes += d.size;
+    }
+    updateSource(datagrams.back().source, datagrams.back().sourceLen);
+}
+
+void UDSReceiver::updateSource(const sockaddr* source, socklen_t sourceLen)
+{
+    sourceLen = std::min<socklen_t>(sourceLen, sizeof(lastPeer));
+    if (sourceLen == lastPeerLen && memcmp(source, &lastPeer, sourceLen) == 0) return;
+    memcpy(&lastPeer, source, sourceLen);
+    lastPeerLen = sourceLen;
+
+    // Unnamed (unbound) senders have no path, abstract ones start with '\0'
+    const size_t pathLen = sourceLen > offsetof(sockaddr_un, sun_path) ? sourceLen - offsetof(sockaddr_un, sun_path) : 0;
+    if (pathLen == 0 || lastPeer.sun_path[0] == '\0') return;
+    senderPath = std::string(lastPeer.sun_path, strnlen(lastPeer.sun_path, pathLen));
+    if (onSource) onSource(senderPath.c_str());
 }
@@ -17,14 +17,20 @@
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <span>
 #include <string>
 #include <thread>
 
-class UDSReceiver
+#include "DatagramBatch.h"
+#include "IngestSource.h"
+
+class UDSReceiver : public IngestSource
 {
   public:
     using DATA_CALLBACK   = std::function<void(const uint8_t*, size_t)>;
     using SOURCE_CALLBACK = std::function<void(const char* /*peerPath*/)>;
+    // All datagrams one recvmmsg call returned
+    using BATCH_CALLBACK  = std::function<void(std::span<const ReceivedDatagram>)>;
 
     UDSReceiver(
         JavaVM*       javaVm,
@@ -40,14 +46,22 @@ class UDSReceiver
     UDSReceiver(UDSReceiver&&)                 = delete;
     UDSReceiver& operator=(UDSReceiver&&)      = delete;
 
-    ~UDSReceiver() { stopReceiving(); }
+    ~UDSReceiver() override { stopReceiving(); }
 
     // control
     void startReceiving();
     void stopReceiving();
 
+    // IngestSource, instead of startReceiving() / stopReceiving()
+    bool   openSource() override;
+    void   closeSource() override;
+    int    pollFd() const override { return mSocket; }
+    size_t drain(size_t maxPackets, bool deliver) override;
+
     // callbacks
     void registerOnSourceFound(SOURCE_CALLBACK cb) { onSource = std::move(cb); }
+    // batch-wise instead of onData, set before startReceiving()
+    void setBatchCallback(BATCH_CALLBACK cb) { onBatch = std::move(cb); }
 
     // stats / info
     [[nodiscard]] long        getNReceivedBytes() const { return nReceivedBytes; }
@@ -55,6 +69,10 @@ class UDSReceiver
 
   private:
     void receiveLoop();
+    bool openSocket();
+    void closeSocket();
+    void onDatagrams(std::span<const ReceivedDatagram> datagrams);
+    void updateSource(const sockaddr* source, socklen_t sourceLen);
 
     // ctor constants
     const std::string   mSocketPath;
@@ -65,10 +83,15 @@ class UDSReceiver
     JavaVM* const       javaVm;
 
     // runtime
-    int                          mSocket = -1;
-    std::unique_ptr<std::thread> mThread;
+    int                            mSocket = -1;
+    std::unique_ptr<DatagramBatch> mBatch;
+    std::unique_ptr<std::thread>   mThread;
     std::atomic<bool>            receiving{false};
     std::atomic<long>            nReceivedBytes{0};
     std::string                  senderPath;
     SOURCE_CALLBACK              onSource;
+    BATCH_CALLBACK               onBatch;
+    // Address of the last sender, senderPath is only rebuilt when it changes
+    sockaddr_un                  lastPeer{};
+    socklen_t                    lastPeerLen = 0;
 };
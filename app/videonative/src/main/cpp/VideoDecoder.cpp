@@ -3,6 +3,7 @@
 //
 
 #include "VideoDecoder.h"
+#include <dlfcn.h>
 #include <unistd.h>
 #include <sstream>
 #include "AndroidThreadPrioValues.hpp"
@@ -16,6 +17,27 @@
 
 using namespace std::chrono;
 
+namespace
+{
+// MediaCodec component name (e.g. "c2.qti.avc.decoder"), the MIME type where AMediaCodec_getName() is not available
+std::string getCodecName(AMediaCodec* codec, const std::string& mime)
+{
+    // Android 9 and newer, looked up at runtime since minSdk is lower
+    using GET_NAME     = media_status_t (*)(AMediaCodec*, char**);
+    using RELEASE_NAME = void (*)(AMediaCodec*, char*);
+    static const auto getName     = reinterpret_cast<GET_NAME>(dlsym(RTLD_DEFAULT, "AMediaCodec_getName"));
+    static const auto releaseName = reinterpret_cast<RELEASE_NAME>(dlsym(RTLD_DEFAULT, "AMediaCodec_releaseName"));
+    char*             name        = nullptr;
+    if (getName == nullptr || releaseName == nullptr || getName(codec, &name) != AMEDIA_OK || name == nullptr)
+    {
+        return mime;
+    }
+    std::string ret(name);
+    releaseName(codec, name);
+    return ret;
+}
+}  // namespace
+
 VideoDecoder::VideoDecoder(JNIEnv* env)
 {
     env->GetJavaVM(&javaVm);
@@ -35,19 +57,19 @@ void VideoDecoder::setOutputSurface(JNIEnv* env, jobject surface, jint idx)
         }
         std::lock_guard<std::mutex> lock(mMutexInputPipe);
         inputPipeClosed = true;
+        if (mFanout)
+        {
+            // The remaining surface gets a decoder of its own with the next key frame
+            if (decoder.configured[0]) releaseDecoder(0);
+            mFanout.reset();
+            mKeyFrameFinder.reset();
+            MLOGD << "Stopped decoding for both surfaces";
+        }
         if (decoder.configured[idx])
         {
-            AMediaCodec_stop(decoder.codec[idx]);
-            AMediaCodec_delete(decoder.codec[idx]);
-            decoder.codec[idx] = nullptr;
+            releaseDecoder(idx);
             MLOGD << "Set decoder.codec null idx: " << idx;
             mKeyFrameFinder.reset();
-            decoder.configured[idx] = false;
-            if (mCheckOutputThread[idx]->joinable())
-            {
-                mCheckOutputThread[idx]->join();
-                mCheckOutputThread[idx].reset();
-            }
         }
         if (decoder.window[idx])
         {
@@ -102,9 +124,18 @@ void VideoDecoder::interpretNALU(const NALU& nalu)
     }
     if (decoder.configured[0] || decoder.configured[1])
     {
-        feedDecoder(nalu, 0);
-        feedDecoder(nalu, 1);
+        if (mAccessUnitMode)
+        {
+            // fed as part of its access unit
+            return;
+        }
+        const uint32_t flags = (IS_H265 && (nalu.isSPS() || nalu.isPPS() || nalu.isVPS()))
+                                   ? AMEDIACODEC_BUFFER_FLAG_CODEC_CONFIG
+                                   : accessUnitFlags(nalu);
+        feedDecoder(nalu, 0, flags);
+        feedDecoder(nalu, 1, flags);
         decodingInfo.nNALUSFeeded++;
+        checkDecoderProfile();
         // manually feeding AUDs doesn't seem to change anything for high latency streams
         // Only for the x264 sw encoded example stream it might improve latency slightly
         // if(!nalu.IS_H265_PACKET && nalu.get_nal_unit_type()==NAL_UNIT_TYPE_CODED_SLICE_NON_IDR){
@@ -120,43 +151,118 @@ void VideoDecoder::interpretNALU(const NALU& nalu)
         if (mKeyFrameFinder.allKeyFramesAvailable(IS_H265))
         {
             MLOGD << "Configuring decoder...";
+            setUpFanout();
             configureStartDecoder(0);
             configureStartDecoder(1);
         }
     }
 }
 
-void VideoDecoder::configureStartDecoder(int idx)
+void VideoDecoder::interpretAccessUnit(const NALU& accessUnit)
 {
-    if (decoder.window[idx] == nullptr) return;
-    const std::string MIME = IS_H265 ? "video/hevc" : "video/avc";
-    decoder.codec[idx]     = AMediaCodec_createDecoderByType(MIME.c_str());
-
-    AMediaFormat* format = AMediaFormat_new();
-    AMediaFormat_setString(format, AMEDIAFORMAT_KEY_MIME, MIME.c_str());
+    std::lock_guard<std::mutex> lock(mMutexInputPipe);
+    if (!mAccessUnitMode || inputPipeClosed || !(decoder.configured[0] || decoder.configured[1]))
+    {
+        return;
+    }
+    // In-band parameter sets are fine in a regular input buffer, only a buffer holding nothing but them needs the
+    // codec config flag
+    feedDecoder(accessUnit, 0, 0);
+    feedDecoder(accessUnit, 1, 0);
+    decodingInfo.nNALUSFeeded++;
+    checkDecoderProfile();
+}
 
-    // AMediaFormat_setInt32(format, "low-latency", 1);
-    // AMediaFormat_setInt32(format, "vendor.low-latency.enable", 1);
-    // AMediaFormat_setInt32(format, "vendor.qti-ext-dec-low-latency.enable", 1);
-    // AMediaFormat_setInt32(format, "vendor.hisi-ext-low-latency-video-dec.video-scene-for-low-latency-req", 1);
-    // AMediaFormat_setInt32(format, "vendor.rtc-ext-dec-low-latency.enable", 1);
+void VideoDecoder::setAccessUnitMode(bool enable)
+{
+    std::lock_guard<std::mutex> lock(mMutexInputPipe);
+    mAccessUnitMode = enable;
+}
 
-    // MediaCodec supports two priorities: 0 - realtime, 1 - best effort
-    // AMediaFormat_setInt32(format, "priority", 0);
+void VideoDecoder::setSliceStreaming(bool enable)
+{
+    std::lock_guard<std::mutex> lock(mMutexInputPipe);
+    mSliceStreaming = enable;
+    mAccessUnitOpen = false;
+    mMissingMarkers = 0;
+}
 
-    if (IS_H265)
+uint32_t VideoDecoder::accessUnitFlags(const NALU& nalu)
+{
+    if (!mSliceStreaming) return 0;
+    if (mAccessUnitOpen && nalu.isSlice() && nalu.isFirstSliceInPicture())
     {
-        h265_configureAMediaFormat(mKeyFrameFinder, format);
+        // The previous picture never got its last slice: lost packet, or the sender doesn't set the marker bit
+        if (++mMissingMarkers >= MAX_MISSING_MARKERS)
+        {
+            MLOGE << "No RTP marker bits in the stream, disabling slice streaming";
+            mSliceStreaming = false;
+            mAccessUnitOpen = false;
+            return 0;
+        }
     }
-    else
+    if (nalu.endsAccessUnit)
     {
-        h264_configureAMediaFormat(mKeyFrameFinder, format);
+        mAccessUnitOpen = false;
+        if (nalu.isSlice()) mMissingMarkers = 0;
+        return 0;
     }
+    if (nalu.isSlice()) mAccessUnitOpen = true;
+    return AMEDIACODEC_BUFFER_FLAG_PARTIAL_FRAME;
+}
 
-    MLOGD << "Configuring decoder:" << AMediaFormat_toString(format);
+void VideoDecoder::configureStartDecoder(int idx)
+{
+    if (decoder.window[idx] == nullptr || (idx == 1 && mFanout)) return;
+    ANativeWindow* const window = (idx == 0 && mFanout) ? mFanout->getDecoderWindow() : decoder.window[idx];
+    const std::string MIME = IS_H265 ? "video/hevc" : "video/avc";
+    decoder.codec[idx]     = AMediaCodec_createDecoderByType(MIME.c_str());
+    if (decoder.codec[idx] == nullptr)
+    {
+        MLOGD << "Cannot create decoder";
+        return;
+    }
+    const std::string codecName = getCodecName(decoder.codec[idx], MIME);
+    const bool        probing   = mProfileStore.selected(codecName) < 0;
+    int profile = probing ? mProfileStore.nextCandidate(codecName, 0) : mProfileStore.selected(codecName);
+    if (profile < 0) profile = static_cast<int>(decoderProfiles().size()) - 1;
 
-    auto status = AMediaCodec_configure(decoder.codec[idx], format, decoder.window[idx], nullptr, 0);
-    AMediaFormat_delete(format);
+    media_status_t status;
+    while (true)
+    {
+        // Has to be set before configuring
+        decoder.async[idx] = enableAsyncMode(idx);
+        AMediaFormat* format = AMediaFormat_new();
+        AMediaFormat_setString(format, AMEDIAFORMAT_KEY_MIME, MIME.c_str());
+        writeAndroidPerformanceParams(format, decoderProfiles()[profile]);
+
+        if (IS_H265)
+        {
+            h265_configureAMediaFormat(mKeyFrameFinder, format);
+        }
+        else
+        {
+            h264_configureAMediaFormat(mKeyFrameFinder, format);
+        }
+
+        MLOGD << "Configuring decoder " << codecName << " with profile " << decoderProfiles()[profile].name << ":"
+              << AMediaFormat_toString(format);
+
+        status = AMediaCodec_configure(decoder.codec[idx], format, window, nullptr, 0);
+        AMediaFormat_delete(format);
+        if (status == AMEDIA_OK) break;
+
+        mProfileStore.markFailed(codecName, profile);
+        const int next = mProfileStore.nextCandidate(codecName, profile + 1);
+        if (next < 0) break;
+        MLOGE << "Decoder " << codecName << " refused profile " << decoderProfiles()[profile].name << ", trying "
+              << decoderProfiles()[next].name;
+        // A codec that failed to configure can't be configured again
+        AMediaCodec_delete(decoder.codec[idx]);
+        decoder.codec[idx] = AMediaCodec_createDecoderByType(MIME.c_str());
+        if (decoder.codec[idx] == nullptr) break;
+        profile = next;
+    }
 
     switch (status)
     {
@@ -203,41 +309,129 @@ void VideoDecoder::configureStartDecoder(int idx)
         // mKeyFrameFinder.reset();
         return;
     }
+    if (status == AMEDIA_OK)
+    {
+        mProfileStore.select(codecName, profile);
+        MLOGD << "Decoder " << codecName << " uses profile " << decoderProfiles()[profile].name
+              << (probing ? " (probed)" : "");
+    }
+    if (idx == 0)
+    {
+        mCodecName                  = codecName;
+        mProfile                    = profile;
+        mConfigureTime              = steady_clock::now();
+        mInputBuffersSinceConfigure = 0;
+        mFramesSinceConfigure       = 0;
+    }
     AMediaCodec_start(decoder.codec[idx]);
-    mCheckOutputThread[idx] = std::make_unique<std::thread>(&VideoDecoder::checkOutputLoop, this, idx);
-    NDKThreadHelper::setName(mCheckOutputThread[idx]->native_handle(), "LLDCheckOutput");
+    if (!decoder.async[idx])
+    {
+        mCheckOutputThread[idx] = std::make_unique<std::thread>(&VideoDecoder::checkOutputLoop, this, idx);
+        NDKThreadHelper::setName(mCheckOutputThread[idx]->native_handle(), "LLDCheckOutput");
+    }
+    MLOGD << "Decoder " << idx << (decoder.async[idx] ? " async" : " sync") << " mode";
     decoder.configured[idx] = true;
 }
 
-void VideoDecoder::feedDecoder(const NALU& nalu, int idx)
+void VideoDecoder::releaseDecoder(int idx)
+{
+    AMediaCodec_stop(decoder.codec[idx]);
+    // Stopped, the output thread leaves dequeueOutputBuffer() and exits
+    if (mCheckOutputThread[idx] && mCheckOutputThread[idx]->joinable())
+    {
+        mCheckOutputThread[idx]->join();
+    }
+    mCheckOutputThread[idx].reset();
+    // Also waits for the async callbacks to return
+    AMediaCodec_delete(decoder.codec[idx]);
+    decoder.codec[idx]      = nullptr;
+    decoder.configured[idx] = false;
+    decoder.async[idx]      = false;
+    mAsync[idx].freeInputBuffers.clear();
+    std::lock_guard<std::mutex> lock(mPendingInputs[idx].mutex);
+    mPendingInputs[idx].count = 0;
+}
+
+void VideoDecoder::setUpFanout()
+{
+    if (mFanout || decoder.window[0] == nullptr || decoder.window[1] == nullptr || !SurfaceFanout::isSupported())
+    {
+        return;
+    }
+    // Only the default buffer size, the decoder sets the size of the frames it outputs
+    const auto videoWH = mKeyFrameFinder.getCSD0().getVideoWidthHeightSPS();
+    mFanout            = SurfaceFanout::create(videoWH[0], videoWH[1], {decoder.window[0], decoder.window[1]});
+    if (mFanout == nullptr) MLOGE << "Cannot decode once for both surfaces, using a decoder per surface";
+}
+
+void VideoDecoder::checkDecoderProfile()
+{
+    const int profile = mProfile;
+    if (!decoder.configured[0] || profile < 0 || decoderProfiles()[profile].keys.empty()) return;
+    if (mFramesSinceConfigure > 0) return;
+    if (mStreamDamaged)
+    {
+        // Nothing to decode until the next key frame, the stall only counts from there
+        mConfigureTime              = steady_clock::now();
+        mInputBuffersSinceConfigure = 0;
+        return;
+    }
+    if (mInputBuffersSinceConfigure < PROFILE_STALL_INPUT_BUFFERS ||
+        steady_clock::now() - mConfigureTime < PROFILE_STALL_TIMEOUT)
+    {
+        return;
+    }
+    const bool failed = mProfileStore.markStalled(mCodecName, profile);
+    MLOGE << "Decoder " << mCodecName << " did not output a frame with profile " << decoderProfiles()[profile].name
+          << (failed ? ", trying the next one" : ", trying it once more");
+    mProfile = -1;
+    // The key frame data is kept, so they are configured again (with the same or the next profile) right away
+    for (int idx = 0; idx < 2; ++idx)
+    {
+        if (decoder.configured[idx]) releaseDecoder(idx);
+    }
+}
+
+void VideoDecoder::feedDecoder(const NALU& nalu, int idx, uint32_t flags)
 {
     if (!decoder.codec[idx]) return;
-    const auto now          = std::chrono::steady_clock::now();
-    const auto deltaParsing = now - nalu.creationTime;
+    const auto now = std::chrono::steady_clock::now();
+    if (decoder.async[idx])
+    {
+        auto&                       pending = mPendingInputs[idx];
+        std::lock_guard<std::mutex> lock(pending.mutex);
+        int32_t                     index;
+        // A free input buffer is only ever left in the queue while nothing is pending
+        if (pending.count == 0 && mAsync[idx].freeInputBuffers.pop(index))
+        {
+            queueInputBuffer(idx, (size_t) index, nalu, flags, now);
+            return;
+        }
+        if (pending.count == MAX_PENDING_INPUTS)
+        {
+            // Rather lose a few pictures (the decoder conceals until the next key frame) than fall behind for good
+            MLOGE << "Decoder " << idx << " fell behind, dropping " << pending.count << " NALUs";
+            nDroppedInputs += static_cast<long>(pending.count);
+            pending.count = 0;
+        }
+        // Queued by onAsyncInputAvailable() as soon as the codec frees an input buffer
+        PendingInput& input = pending.slots[(pending.head + pending.count) % MAX_PENDING_INPUTS];
+        if (input.data.size() < nalu.getSize()) input.data.resize(nalu.getSize());
+        input.size         = nalu.copyTo(input.data.data());
+        input.isH265       = nalu.IS_H265_PACKET;
+        input.flags        = flags;
+        input.fedAt        = now;
+        input.creationTime = nalu.creationTime;
+        input.receiveTime  = nalu.receiveTime;
+        pending.count++;
+        return;
+    }
     while (true)
     {
         const auto index = AMediaCodec_dequeueInputBuffer(decoder.codec[idx], BUFFER_TIMEOUT_US);
         if (index >= 0)
         {
-            size_t   inputBufferSize;
-            uint8_t* buf = AMediaCodec_getInputBuffer(decoder.codec[idx], (size_t) index, &inputBufferSize);
-            // I have not seen any case where the input buffer returned by MediaCodec is too small to hold the NALU
-            // But better be safe than crashing with a memory exception
-            if (nalu.getSize() > inputBufferSize)
-            {
-                MLOGD << "Nalu too big" << nalu.getSize();
-                return;
-            }
-
-            int flag =
-                (IS_H265 && (nalu.isSPS() || nalu.isPPS() || nalu.isVPS())) ? AMEDIACODEC_BUFFER_FLAG_CODEC_CONFIG : 0;
-            std::memcpy(buf, nalu.getData(), (size_t) nalu.getSize());
-            const uint64_t presentationTimeUS =
-                (uint64_t) duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
-            AMediaCodec_queueInputBuffer(
-                decoder.codec[idx], (size_t) index, 0, (size_t) nalu.getSize(), presentationTimeUS, flag);
-            waitForInputB.add(steady_clock::now() - now);
-            parsingTime.add(deltaParsing);
+            queueInputBuffer(idx, (size_t) index, nalu, flags, now);
             return;
         }
         else if (index == AMEDIACODEC_INFO_TRY_AGAIN_LATER)
@@ -263,6 +457,154 @@ void VideoDecoder::feedDecoder(const NALU& nalu, int idx)
     }
 }
 
+void VideoDecoder::queueInputBuffer(
+    int idx, size_t index, const NALU& nalu, uint32_t flags, const std::chrono::steady_clock::time_point fedAt)
+{
+    size_t   inputBufferSize = 0;
+    uint8_t* buf             = AMediaCodec_getInputBuffer(decoder.codec[idx], index, &inputBufferSize);
+    // I have not seen any case where the input buffer returned by MediaCodec is too small to hold the NALU
+    // But better be safe than crashing with a memory exception
+    if (buf == nullptr || nalu.getSize() > inputBufferSize)
+    {
+        MLOGD << "Nalu too big" << nalu.getSize();
+        // Hand the buffer back empty, it is not handed out again otherwise
+        AMediaCodec_queueInputBuffer(decoder.codec[idx], index, 0, 0, 0, 0);
+        return;
+    }
+
+    nalu.copyTo(buf);
+    const auto     now                = steady_clock::now();
+    const uint64_t presentationTimeUS = (uint64_t) duration_cast<microseconds>(now.time_since_epoch()).count();
+    AMediaCodec_queueInputBuffer(decoder.codec[idx], index, 0, (size_t) nalu.getSize(), presentationTimeUS, flags);
+    // Decoder 0 only: in async mode the two decoders queue from their own callback threads
+    if (idx == 0)
+    {
+        nCodecInputBuffers.add(1);
+        mInputBuffersSinceConfigure++;
+        waitForInputB.add(now - fedAt);
+        parsingTime.add(fedAt - nalu.creationTime);
+        receiveTime.add(nalu.creationTime - nalu.receiveTime);
+    }
+}
+
+bool VideoDecoder::feedPendingInput(int idx, int32_t index)
+{
+    auto& pending = mPendingInputs[idx];
+    if (pending.count == 0) return false;
+    const PendingInput& input = pending.slots[pending.head];
+    NALU                nalu(input.data.data(), input.size, input.isH265, input.creationTime);
+    nalu.receiveTime = input.receiveTime;
+    queueInputBuffer(idx, (size_t) index, nalu, input.flags, input.fedAt);
+    pending.head = (pending.head + 1) % MAX_PENDING_INPUTS;
+    pending.count--;
+    return true;
+}
+
+bool VideoDecoder::enableAsyncMode(int idx)
+{
+    // Android 9 and newer, looked up at runtime since minSdk is lower
+    using SET_CALLBACK = media_status_t (*)(AMediaCodec*, AMediaCodecOnAsyncNotifyCallback, void*);
+    static const auto setAsyncNotifyCallback =
+        reinterpret_cast<SET_CALLBACK>(dlsym(RTLD_DEFAULT, "AMediaCodec_setAsyncNotifyCallback"));
+    if (setAsyncNotifyCallback == nullptr) return false;
+    mAsync[idx].self = this;
+    mAsync[idx].idx  = idx;
+    mAsync[idx].freeInputBuffers.clear();
+    for (PendingInput& input : mPendingInputs[idx].slots)
+    {
+        if (input.data.size() < PENDING_INPUT_PREALLOC) input.data.resize(PENDING_INPUT_PREALLOC);
+    }
+    const AMediaCodecOnAsyncNotifyCallback callback{
+        &VideoDecoder::onAsyncInputAvailable,
+        &VideoDecoder::onAsyncOutputAvailable,
+        &VideoDecoder::onAsyncFormatChanged,
+        &VideoDecoder::onAsyncError};
+    return setAsyncNotifyCallback(decoder.codec[idx], callback, &mAsync[idx]) == AMEDIA_OK;
+}
+
+void VideoDecoder::onAsyncInputAvailable(AMediaCodec* codec, void* userdata, int32_t index)
+{
+    auto*                       context = static_cast<AsyncContext*>(userdata);
+    std::lock_guard<std::mutex> lock(context->self->mPendingInputs[context->idx].mutex);
+    // Feed a waiting NALU right away instead of with the next one, it might be the last slice of a picture
+    if (context->self->feedPendingInput(context->idx, index)) return;
+    if (!context->freeInputBuffers.push(index))
+    {
+        // Can't happen, a codec has less input buffers than the queue can hold
+        MLOGE << "Too many free input buffers";
+    }
+}
+
+void VideoDecoder::onAsyncOutputAvailable(AMediaCodec* codec, void* userdata, int32_t index, AMediaCodecBufferInfo* info)
+{
+    auto* context = static_cast<AsyncContext*>(userdata);
+    // Render right away, see checkOutputLoop()
+    AMediaCodec_releaseOutputBuffer(codec, (size_t) index, true);
+    context->self->onFrameDecoded(context->idx, *info);
+    context->self->updateDecodingInfo(context->idx);
+}
+
+void VideoDecoder::onAsyncFormatChanged(AMediaCodec* codec, void* userdata, AMediaFormat* format)
+{
+    auto* context = static_cast<AsyncContext*>(userdata);
+    context->self->onOutputFormatChanged(context->idx, format);
+}
+
+void VideoDecoder::onAsyncError(
+    AMediaCodec* codec, void* userdata, media_status_t error, int32_t actionCode, const char* detail)
+{
+    auto* context = static_cast<AsyncContext*>(userdata);
+    MLOGE << "Decoder " << context->idx << " error " << (int) error << " action " << actionCode << ": "
+          << (detail ? detail : "");
+}
+
+void VideoDecoder::onFrameDecoded(int idx, const AMediaCodecBufferInfo& info)
+{
+    if (idx != 0) return;
+    // the presentationTime is in US
+    const int64_t nowUS = (int64_t) duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+    decodingTime.add(std::chrono::microseconds(nowUS - info.presentationTimeUs));
+    nDecodedFrames.add(1);
+    if (++mFramesSinceConfigure == DecoderProfileStore::MEASURE_FRAMES)
+    {
+        mProfileStore.recordDecodingTime(mCodecName, decodingTime.getAvg_ms());
+        MLOGD << "Decoder " << mCodecName << " with profile " << decoderProfiles()[mProfile].name << ": "
+              << decodingTime.getAvg_ms() << "ms decoding time";
+    }
+}
+
+void VideoDecoder::onOutputFormatChanged(int idx, AMediaFormat* format)
+{
+    int width = 0, height = 0;
+    AMediaFormat_getInt32(format, AMEDIAFORMAT_KEY_WIDTH, &width);
+    AMediaFormat_getInt32(format, AMEDIAFORMAT_KEY_HEIGHT, &height);
+    // The frames are aligned to the macroblock size, the crop rect (inclusive) is the actual picture
+    int cropLeft = 0, cropTop = 0, cropRight = width - 1, cropBottom = height - 1;
+    AMediaFormat_getInt32(format, "crop-left", &cropLeft);
+    AMediaFormat_getInt32(format, "crop-top", &cropTop);
+    AMediaFormat_getInt32(format, "crop-right", &cropRight);
+    AMediaFormat_getInt32(format, "crop-bottom", &cropBottom);
+    const int pictureWidth  = cropRight - cropLeft + 1;
+    const int pictureHeight = cropBottom - cropTop + 1;
+    MLOGD << "Actual Width and Height in output " << width << "," << height << " picture " << pictureWidth << ","
+          << pictureHeight;
+    if (idx == 0 && onDecoderRatioChangedCallback != nullptr && pictureWidth > 0 && pictureHeight > 0)
+    {
+        onDecoderRatioChangedCallback({pictureWidth, pictureHeight});
+    }
+    if (idx == 0 && mFanout && width > 0 && height > 0)
+    {
+        // Without a reader of the new size the frames would be scaled into the old one
+        mFanout->onOutputFormatChanged(
+            width,
+            height,
+            {cropLeft, cropTop, cropRight + 1, cropBottom + 1},
+            [codec = decoder.codec[0]](ANativeWindow* window)
+            { return AMediaCodec_setOutputSurface(codec, window) == AMEDIA_OK; });
+    }
+    MLOGD << "AMEDIACODEC_INFO_OUTPUT_FORMAT_CHANGED " << width << " " << height << " " << AMediaFormat_toString(format);
+}
+
 void VideoDecoder::checkOutputLoop(int idx)
 {
     NDKThreadHelper::setProcessThreadPriorityAttachDetach(javaVm, -16, "DecoderCheckOutput");
@@ -275,8 +617,6 @@ void VideoDecoder::checkOutputLoop(int idx)
         const ssize_t index = AMediaCodec_dequeueOutputBuffer(decoder.codec[idx], &info, BUFFER_TIMEOUT_US);
         if (index >= 0)
         {
-            const auto    now   = steady_clock::now();
-            const int64_t nowUS = (int64_t) duration_cast<microseconds>(now.time_since_epoch()).count();
             // the timestamp for releasing the buffer is in NS, just release as fast as possible (e.g. now)
             // https://android.googlesource.com/platform/frameworks/av/+/master/media/ndk/NdkMediaCodec.cpp
             //-> renderOutputBufferAndRelease which is in
@@ -285,12 +625,7 @@ void VideoDecoder::checkOutputLoop(int idx)
             //  also https://android.googlesource.com/platform/frameworks/native/+/5c1139f/libs/gui/SurfaceTexture.cpp
             if (!decoder.codec[idx]) break;
             AMediaCodec_releaseOutputBuffer(decoder.codec[idx], (size_t) index, true);
-            // but the presentationTime is in US
-            if (idx == 0)
-            {
-                decodingTime.add(std::chrono::microseconds(nowUS - info.presentationTimeUs));
-                nDecodedFrames.add(1);
-            }
+            onFrameDecoded(idx, info);
             if (info.flags & AMEDIACODEC_BUFFER_FLAG_END_OF_STREAM)
             {
                 MLOGD << "Decoder saw EOS";
@@ -300,17 +635,7 @@ void VideoDecoder::checkOutputLoop(int idx)
         }
         else if (index == AMEDIACODEC_INFO_OUTPUT_FORMAT_CHANGED)
         {
-            auto format = AMediaCodec_getOutputFormat(decoder.codec[idx]);
-            int  width = 0, height = 0;
-            AMediaFormat_getInt32(format, AMEDIAFORMAT_KEY_WIDTH, &width);
-            AMediaFormat_getInt32(format, AMEDIAFORMAT_KEY_HEIGHT, &height);
-            MLOGD << "Actual Width and Height in output " << width << "," << height;
-            if (idx == 0 && onDecoderRatioChangedCallback != nullptr && width != 0 && height != 0)
-            {
-                onDecoderRatioChangedCallback({width, height});
-            }
-            MLOGD << "AMEDIACODEC_INFO_OUTPUT_FORMAT_CHANGED " << width << " " << height << " "
-                  << AMediaFormat_toString(format);
+            onOutputFormatChanged(idx, AMediaCodec_getOutputFormat(decoder.codec[idx]));
         }
         else if (index == AMEDIACODEC_INFO_OUTPUT_BUFFERS_CHANGED)
         {
@@ -327,30 +652,38 @@ void VideoDecoder::checkOutputLoop(int idx)
             decoderProducedUnknown = true;
             continue;
         }
-        // every 2 seconds recalculate the current fps and bitrate
-        const auto now   = steady_clock::now();
-        const auto delta = now - decodingInfo.lastCalculation;
-        if (idx == 0 && delta > DECODING_INFO_RECALCULATION_INTERVAL)
+        updateDecodingInfo(idx);
+    }
+    MLOGD << "Exit CheckOutputLoop";
+}
+
+void VideoDecoder::updateDecodingInfo(int idx)
+{
+    // every 2 seconds recalculate the current fps and bitrate
+    const auto now   = steady_clock::now();
+    const auto delta = now - decodingInfo.lastCalculation;
+    if (idx == 0 && delta > DECODING_INFO_RECALCULATION_INTERVAL)
+    {
+        decodingInfo.lastCalculation = steady_clock::now();
+        const long decodedFrames     = nDecodedFrames.getDeltaSinceLastCall();
+        const long codecInputBuffers = nCodecInputBuffers.getDeltaSinceLastCall();
+        decodingInfo.currentFPS = (float) decodedFrames / (float) duration_cast<seconds>(delta).count();
+        decodingInfo.codecCallsPerFrame = decodedFrames > 0 ? (float) codecInputBuffers / (float) decodedFrames : 0;
+        decodingInfo.currentKiloBitsPerSecond =
+            ((float) nNALUBytesFed.getDeltaSinceLastCall() / duration_cast<seconds>(delta).count()) / 1024.0f *
+            8.0f;
+        // and recalculate the avg latencies. If needed,also print the log.
+        decodingInfo.avgDecodingTime_ms      = decodingTime.getAvg_ms();
+        decodingInfo.avgReceiveTime_ms       = receiveTime.getAvg_ms();
+        decodingInfo.avgParsingTime_ms       = parsingTime.getAvg_ms();
+        decodingInfo.avgWaitForInputBTime_ms = waitForInputB.getAvg_ms();
+        decodingInfo.nDecodedFrames          = nDecodedFrames.getAbsolute();
+        printAvgLog();
+        if (onDecodingInfoChangedCallback != nullptr)
         {
-            decodingInfo.lastCalculation = steady_clock::now();
-            decodingInfo.currentFPS =
-                (float) nDecodedFrames.getDeltaSinceLastCall() / (float) duration_cast<seconds>(delta).count();
-            decodingInfo.currentKiloBitsPerSecond =
-                ((float) nNALUBytesFed.getDeltaSinceLastCall() / duration_cast<seconds>(delta).count()) / 1024.0f *
-                8.0f;
-            // and recalculate the avg latencies. If needed,also print the log.
-            decodingInfo.avgDecodingTime_ms      = decodingTime.getAvg_ms();
-            decodingInfo.avgParsingTime_ms       = parsingTime.getAvg_ms();
-            decodingInfo.avgWaitForInputBTime_ms = waitForInputB.getAvg_ms();
-            decodingInfo.nDecodedFrames          = nDecodedFrames.getAbsolute();
-            printAvgLog();
-            if (onDecodingInfoChangedCallback != nullptr)
-            {
-                onDecodingInfoChangedCallback(decodingInfo);
-            }
+            onDecodingInfoChangedCallback(decodingInfo);
         }
     }
-    MLOGD << "Exit CheckOutputLoop";
 }
 
 void VideoDecoder::printAvgLog()
@@ -366,13 +699,22 @@ void VideoDecoder::printAvgLog()
             float avgDecodingLatencySum =
                 decodingInfo.avgParsingTime_ms + decodingInfo.avgWaitForInputBTime_ms + decodingInfo.avgDecodingTime_ms;
             frameLog << "......................Decoding Latency Averages......................"
-                     << "\nParsing:" << decodingInfo.avgParsingTime_ms
+                     << "\nReceive:" << decodingInfo.avgReceiveTime_ms
+                     << " | Parsing:" << decodingInfo.avgParsingTime_ms
                      << " | WaitInputBuffer:" << decodingInfo.avgWaitForInputBTime_ms
                      << " | Decoding:" << decodingInfo.avgDecodingTime_ms
-                     << " | Decoding Latency Sum:" << avgDecodingLatencySum << "\nN NALUS:" << decodingInfo.nNALU
+                     << " | Decoding Latency Sum:" << avgDecodingLatencySum
+                     << " | Receive To Decoded:" << decodingInfo.avgReceiveTime_ms + avgDecodingLatencySum
+                     << "\nN NALUS:" << decodingInfo.nNALU
                      << " | N NALUES feeded:" << decodingInfo.nNALUSFeeded
-                     << " | N Decoded Frames:" << nDecodedFrames.getAbsolute() << "\nFPS:" << decodingInfo.currentFPS
+                     << " | N Decoded Frames:" << nDecodedFrames.getAbsolute()
+                     << " | Codec calls per frame:" << decodingInfo.codecCallsPerFrame << "\nFPS:" << decodingInfo.currentFPS
                      << " | Codec:" << (decodingInfo.nCodec ? "H265" : "H264");
+            const int profile = mProfile;
+            if (profile >= 0) frameLog << " | Profile:" << decoderProfiles()[profile].name;
+            frameLog << " | Input:" << (decoder.async[0] ? "async" : "sync")
+                     << " | Dropped inputs:" << nDroppedInputs;
+            if (mFanout) frameLog << " | Fan-out dropped frames:" << mFanout->getDroppedFrames();
             MLOGD << frameLog.str();
         }
     }
@@ -382,6 +724,8 @@ void VideoDecoder::resetStatistics()
 {
     nDecodedFrames.reset();
     nNALUBytesFed.reset();
+    nCodecInputBuffers.reset();
+    receiveTime.reset();
     parsingTime.reset();
     waitForInputB.reset();
     decodingTime.reset();
@@ -9,11 +9,17 @@
 #include <android/native_window.h>
 #include <jni.h>
 #include <media/NdkMediaCodec.h>
+#include <array>
 #include <atomic>
 #include <iostream>
+#include <mutex>
 #include <thread>
+#include <vector>
+#include "DecoderProfiles.h"
 #include "NALU/KeyFrameFinder.hpp"
 #include "NALU/NALU.hpp"
+#include "SurfaceFanout.h"
+#include "helper/SpscQueue.hpp"
 #include "helper/TimeHelper.hpp"
 
 struct DecodingInfo
@@ -25,15 +31,20 @@ struct DecodingInfo
     long                                  nCodec                   = 0;
     float                                 currentFPS               = 0;
     float                                 currentKiloBitsPerSecond = 0;
+    // From the socket / radio receive time to the NALU leaving the parser, see NALU::receiveTime
+    float                                 avgReceiveTime_ms        = 0;
     float                                 avgParsingTime_ms        = 0;
     float                                 avgWaitForInputBTime_ms  = 0;
     float                                 avgDecodingTime_ms       = 0;
+    // queueInputBuffer() calls per decoded frame (per decoder)
+    float codecCallsPerFrame = 0;
 
     bool operator==(const DecodingInfo& d2) const
     {
         return nNALU == d2.nNALU && nNALUSFeeded == d2.nNALUSFeeded && currentFPS == d2.currentFPS &&
                currentKiloBitsPerSecond == d2.currentKiloBitsPerSecond && avgParsingTime_ms == d2.avgParsingTime_ms &&
-               avgWaitForInputBTime_ms == d2.avgWaitForInputBTime_ms && avgDecodingTime_ms == d2.avgDecodingTime_ms;
+               avgWaitForInputBTime_ms == d2.avgWaitForInputBTime_ms && avgDecodingTime_ms == d2.avgDecodingTime_ms &&
+               codecCallsPerFrame == d2.codecCallsPerFrame && avgReceiveTime_ms == d2.avgReceiveTime_ms;
     }
 
     bool operator!=(const DecodingInfo& d2) const { return !(*this == d2); }
@@ -59,6 +70,44 @@ class VideoDecoder
         bool           configured[2] = {false, false};
         AMediaCodec*   codec[2]      = {nullptr, nullptr};
         ANativeWindow* window[2]     = {nullptr, nullptr};
+        // Driven by AMediaCodec_setAsyncNotifyCallback instead of the blocking dequeue calls
+        bool async[2] = {false, false};
+    };
+
+    // Async mode (Android 9+): MediaCodec reports free input buffers and decoded frames on its own callback thread.
+    // Feeding never waits for the codec, the free input buffer indices are handed over through a lock-free queue.
+    struct AsyncContext
+    {
+        VideoDecoder*          self = nullptr;
+        int                    idx  = 0;
+        SpscQueue<int32_t, 64> freeInputBuffers;
+    };
+
+    // A NALU that found no free input buffer in async mode. The data buffer is reused, it only grows
+    struct PendingInput
+    {
+        std::vector<uint8_t>                  data;
+        size_t                                size   = 0;
+        bool                                  isH265 = false;
+        uint32_t                              flags  = 0;
+        std::chrono::steady_clock::time_point fedAt;
+        std::chrono::steady_clock::time_point creationTime;
+        std::chrono::steady_clock::time_point receiveTime;
+    };
+
+    // More than this many pending NALUs, the codec fell behind: drop the backlog
+    static constexpr size_t MAX_PENDING_INPUTS = 32;
+    // Allocated per pending slot up front, enough for the slices / P-frames of a live stream
+    static constexpr size_t PENDING_INPUT_PREALLOC = 64 * 1024;
+
+    // Fixed ring of pending NALUs, queued from the input-available callback as soon as the codec frees a buffer.
+    // Has a lock of its own: mMutexInputPipe is held while stopping a codec, which waits for the callbacks to return.
+    struct PendingRing
+    {
+        std::mutex                                   mutex;
+        std::array<PendingInput, MAX_PENDING_INPUTS> slots;
+        size_t                                       head  = 0;
+        size_t                                       count = 0;
     };
 
   public:
@@ -91,13 +140,74 @@ class VideoDecoder
     //  If the input pipe was closed (surface has been removed or is not set yet), only buffer key frames
     void interpretNALU(const NALU& nalu);
 
+    // Slice streaming: every slice is queued as soon as it is complete (as before), but all buffers of a picture
+    // except the last one are flagged as partial frame. The decoder then knows the picture is complete with its last
+    // slice, instead of waiting for the next picture to begin. Needs the RTP marker bit, turns itself off again if
+    // the stream doesn't set it.
+    void setSliceStreaming(bool enable);
+
+    // Access unit mode: NALUs passed to interpretNALU() are only used to configure the decoder, the data is fed one
+    // picture per input buffer via interpretAccessUnit() (see AccessUnitAssembler)
+    void setAccessUnitMode(bool enable);
+
+    void interpretAccessUnit(const NALU& accessUnit);
+
+    // The parser lost data the pictures fed from now on depend on (see LossTracker), until the next key frame.
+    // A decoder not outputting anything then is not taken as a problem with its profile
+    void setStreamDamaged(bool damaged) { mStreamDamaged = damaged; }
+
+    // Where the low-latency profile that works with each decoder is remembered, see DecoderProfileStore
+    void setProfileStorePath(std::string path) { mProfileStore.setPath(std::move(path)); }
+
   private:
     // Initialize decoder with SPS / PPS data from KeyFrameFinder
     // Set Decoder.configured to true on success
     void configureStartDecoder(int idx);
 
-    // Wait for input buffer to become available before feeding NALU
-    void feedDecoder(const NALU& nalu, int idx);
+    // Stop and free decoder idx, it is configured again with the next key frame
+    void releaseDecoder(int idx);
+
+    // With two output surfaces, decode once for both (decoder 0) instead of running a decoder per surface, if supported
+    void setUpFanout();
+
+    // If the decoder did not output anything with its profile (on an undamaged stream), start over. With the next
+    // profile if it stalled before, see DecoderProfileStore::markStalled()
+    void checkDecoderProfile();
+
+    // Sync mode: wait for input buffer to become available before feeding NALU
+    // Async mode: feed NALU if a free input buffer is available, keep it until the codec frees one otherwise
+    void feedDecoder(const NALU& nalu, int idx, uint32_t flags);
+
+    // Copy nalu into input buffer index and queue it. fedAt: when feedDecoder() was called with it
+    void queueInputBuffer(
+        int idx, size_t index, const NALU& nalu, uint32_t flags, std::chrono::steady_clock::time_point fedAt);
+
+    // Async mode: queue the oldest pending NALU of decoder idx into input buffer index. false if there is none.
+    // Called with mPendingInputs[idx].mutex held
+    bool feedPendingInput(int idx, int32_t index);
+
+    // Before configuring. false if async mode is not available (before Android 9)
+    bool enableAsyncMode(int idx);
+
+    static void onAsyncInputAvailable(AMediaCodec* codec, void* userdata, int32_t index);
+
+    static void onAsyncOutputAvailable(AMediaCodec* codec, void* userdata, int32_t index, AMediaCodecBufferInfo* info);
+
+    static void onAsyncFormatChanged(AMediaCodec* codec, void* userdata, AMediaFormat* format);
+
+    static void onAsyncError(
+        AMediaCodec* codec, void* userdata, media_status_t error, int32_t actionCode, const char* detail);
+
+    // A frame of decoder idx was rendered (its output buffer released). Called on the output thread / async callback
+    void onFrameDecoded(int idx, const AMediaCodecBufferInfo& info);
+
+    void onOutputFormatChanged(int idx, AMediaFormat* format);
+
+    // Every DECODING_INFO_RECALCULATION_INTERVAL: re-calculate the decoding info and notify the callback
+    void updateDecodingInfo(int idx);
+
+    // Input buffer flags for nalu in slice streaming mode
+    uint32_t accessUnitFlags(const NALU& nalu);
 
     // Runs until EOS arrives at output buffer or decoder is stopped
     void checkOutputLoop(int idx);
@@ -108,6 +218,9 @@ class VideoDecoder
     void resetStatistics();
 
     std::unique_ptr<std::thread> mCheckOutputThread[2]  = {nullptr, nullptr};
+    AsyncContext                 mAsync[2];
+    PendingRing                  mPendingInputs[2];
+    std::atomic<long>            nDroppedInputs{0};
     bool                         USE_SW_DECODER_INSTEAD = false;
     // Holds the AMediaCodec instance, as well as the state (configured or not configured)
     Decoder      decoder{};
@@ -122,6 +235,8 @@ class VideoDecoder
     std::chrono::steady_clock::time_point lastLog = std::chrono::steady_clock::now();
     RelativeCalculator                    nDecodedFrames;
     RelativeCalculator                    nNALUBytesFed;
+    RelativeCalculator                    nCodecInputBuffers;
+    AvgCalculator                         receiveTime;
     AvgCalculator                         parsingTime;
     AvgCalculator                         waitForInputB;
     AvgCalculator                         decodingTime;
@@ -133,6 +248,30 @@ class VideoDecoder
   private:
     KeyFrameFinder mKeyFrameFinder;
     bool           IS_H265 = false;
+    // Guarded by mMutexInputPipe
+    bool mAccessUnitMode = false;
+    // Slice streaming state, guarded by mMutexInputPipe
+    bool mSliceStreaming = false;
+    // Partial frame buffers of a picture were queued, but not its last slice yet
+    bool mAccessUnitOpen = false;
+    int  mMissingMarkers = 0;
+    // Consecutive pictures without marker bit before slice streaming gives up (single ones are packet loss)
+    static constexpr int MAX_MISSING_MARKERS = 3;
+    DecoderProfileStore  mProfileStore;
+    // MediaCodec name and profile of decoder 0, set before its output thread starts
+    std::string      mCodecName;
+    std::atomic<int> mProfile{-1};
+    // Since decoder 0 was configured, reset under mMutexInputPipe. Input buffers are counted by whichever thread queues
+    // them (the MediaCodec callback thread in async mode), frames by the output thread
+    std::chrono::steady_clock::time_point mConfigureTime;
+    std::atomic<long>                     mInputBuffersSinceConfigure{0};
+    std::atomic<long>                     mFramesSinceConfigure{0};
+    std::atomic<bool>                     mStreamDamaged{false};
+    // No frame after this many input buffers and this long: the decoder doesn't work with the profile
+    static constexpr long PROFILE_STALL_INPUT_BUFFERS = 120;
+    static constexpr auto PROFILE_STALL_TIMEOUT       = std::chrono::seconds(3);
+    // Decoder 0 renders for both surfaces, decoder 1 is not used. Guarded by mMutexInputPipe
+    std::unique_ptr<SurfaceFanout> mFanout;
 };
 
 #endif  // FPVUE_VIDEODECODER_H
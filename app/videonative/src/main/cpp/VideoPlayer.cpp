@@ -12,9 +12,33 @@
 #define TAG "pixelpilot"
 
 VideoPlayer::VideoPlayer(JNIEnv* env, jobject context)
-    : mParser{std::bind(&VideoPlayer::onNewNALU, this, std::placeholders::_1)}, videoDecoder(env)
+    : mParser{
+          std::bind(&VideoPlayer::onNewNALU, this, std::placeholders::_1),
+          [this](const NALU& accessUnit) { videoDecoder.interpretAccessUnit(accessUnit); },
+          // Reaches the air unit through the wfb-ng link quality messages (in-process video only)
+          [this] { mInProcessReceiver->requestKeyframe(); }},
+      mDvr(
+          [this]
+          {
+              return DvrWriter::VideoFormat{
+                  latestVideoRatio.width, latestVideoRatio.height, latestDecodingInfo.currentFPS};
+          }),
+      videoDecoder(env)
 {
     env->GetJavaVM(&javaVm);
+    mInProcessReceiver = std::make_unique<InProcessReceiver>(
+        javaVm,
+        "InProcessRx",
+        -16,
+        [this](const uint8_t* data, size_t data_length, std::chrono::steady_clock::time_point rxTime)
+        { onNewRTPData(data, data_length, rxTime, true); });
+    // Ring slots stay valid until released, so the parser can assemble NALUs without copying the packets
+    mInProcessReceiver->setPacketRetention(
+        [this] { return mParser.holdsPacketReferences(); }, [this] { mParser.releasePacketReferences(); });
+    mIngestReactor = std::make_unique<IngestReactor>(javaVm, "VideoIngest", -16);
+    // Held back packets go out at their deadline even if no further packet arrives (e.g. during a link fade)
+    mIngestReactor->setTick([this] { return releaseExpiredPackets(); });
+    videoDecoder.setProfileStorePath(NDKHelper::getFilesDir(env, context) + "/decoder_profiles.txt");
     videoDecoder.registerOnDecoderRatioChangedCallback(
         [this](const VideoRatio ratio)
         {
@@ -31,124 +55,108 @@ VideoPlayer::VideoPlayer(JNIEnv* env, jobject context)
         });
 }
 
-static int write_callback(int64_t offset, const void* buffer, size_t size, void* token)
-{
-    FILE* f = (FILE*) token;
-    fseek(f, offset, SEEK_SET);
-    return fwrite(buffer, 1, size, f) != size;
-}
-
-void VideoPlayer::processQueue()
-{
-    ::FILE*           fout = fdopen(dvr_fd, "wb");
-    MP4E_mux_t*       mux  = MP4E_open(0 /*sequential_mode*/, dvr_mp4_fragmentation, fout, write_callback);
-    mp4_h26x_writer_t mp4wr;
-    float             framerate = 0;
-    if (mux == nullptr)
-    {
-        __android_log_print(ANDROID_LOG_ERROR, TAG, "dvr open failed");
-        return;
-    }
-
-    while (true)
-    {
-        last_dvr_write = get_time_ms();
-        std::unique_lock<std::mutex> lock(mtx);
-        cv.wait(lock, [this] { return !naluQueue.empty() || stopFlag; });
-        if (stopFlag)
-        {
-            break;
-        }
-        if (!naluQueue.empty())
-        {
-            NALU nalu = naluQueue.front();
-            if (framerate == 0)
-            {
-                if (latestDecodingInfo.currentFPS <= 0)
-                {
-                    continue;
-                }
-                if (MP4E_STATUS_OK !=
-                    mp4_h26x_write_init(
-                        &mp4wr, mux, latestVideoRatio.width, latestVideoRatio.height, nalu.IS_H265_PACKET))
-                {
-                    __android_log_print(ANDROID_LOG_DEBUG, TAG, "error: mp4_h26x_write_init failed");
-                }
-                framerate = latestDecodingInfo.currentFPS;
-                __android_log_print(
-                    ANDROID_LOG_DEBUG,
-                    TAG,
-                    "mp4 init with fps=%.2f, res=%dx%d, hevc=%d",
-                    framerate,
-                    latestVideoRatio.width,
-                    latestVideoRatio.height,
-                    nalu.IS_H265_PACKET);
-            }
-            naluQueue.pop();
-            lock.unlock();
-            // Process the NALU
-            auto res = mp4_h26x_write_nal(&mp4wr, nalu.getData(), nalu.getSize(), 90000 / framerate);
-            if (MP4E_STATUS_OK != res)
-            {
-                __android_log_print(ANDROID_LOG_DEBUG, TAG, "mp4_h26x_write_nal failed with %d", res);
-            }
-        }
-    }
-
-    MP4E_close(mux);
-    mp4_h26x_write_close(&mp4wr);
-    if (fout)
-    {
-        fclose(fout);
-        fout = NULL;
-    }
-    dvr_fd = -1;
-    __android_log_print(ANDROID_LOG_DEBUG, TAG, "dvr thread done");
-}
-
 // Not yet parsed bit stream (e.g. raw h264 or rtp data)
-void VideoPlayer::onNewRTPData(const uint8_t* data, const std::size_t data_length)
+void VideoPlayer::onNewRTPData(
+    const uint8_t*                              data,
+    const std::size_t                           data_length,
+    const std::chrono::steady_clock::time_point rxTime,
+    const bool                                  packet_stays_valid)
 {
     // Parse the RTP packet
     const RTP::RTPPacket rtpPacket(data, data_length);
     uint16_t             idx = rtpPacket.header.getSequence();
 
     // Define the callback based on payload type
-    auto callback = [&](const uint8_t* packet_data, std::size_t packet_length)
+    auto callback = [&](const uint8_t*                        packet_data,
+                        std::size_t                           packet_length,
+                        std::chrono::steady_clock::time_point packet_rx_time)
     {
         if (rtpPacket.header.payload == RTP_PAYLOAD_TYPE_AUDIO)
         {
-            audioDecoder.enqueueAudio(packet_data, packet_length);
+            onAudioPacket(packet_data, packet_length, packet_rx_time);
         }
         else
         {
-            mParser.parse_rtp_stream(packet_data, packet_length);
+            // Packets re-ordered by the queue come from its own storage, which is recycled right away
+            onVideoPacket(packet_data, packet_length, packet_stays_valid && packet_data == data, packet_rx_time);
         }
     };
 
     // Process the packet using the queue
     if (rtpPacket.header.payload == RTP_PAYLOAD_TYPE_AUDIO)
     {
-        mBufferedPacketQueueAudio.processPacket(idx, data, data_length, callback);
+        mBufferedPacketQueueAudio.processPacket(idx, data, data_length, callback, rxTime);
     }
     else
     {
-        mBufferedPacketQueueVideo.processPacket(idx, data, data_length, callback);
+        // Re-ordered packets keep their own receive time
+        mBufferedPacketQueueVideo.processPacket(
+            idx,
+            rtpPacket.header.getTimestamp(),
+            rtpPacket.header.marker,
+            data,
+            data_length,
+            callback,
+            BufferedPacketQueue::steadyTimeMs(),
+            rxTime);
     }
 }
 
+void VideoPlayer::onVideoPacket(
+    const uint8_t*                              data,
+    const std::size_t                           data_length,
+    const bool                                  packet_stays_valid,
+    const std::chrono::steady_clock::time_point rxTime)
+{
+    mParser.parse_rtp_stream(data, data_length, packet_stays_valid, rxTime);
+}
+
+void VideoPlayer::onAudioPacket(
+    const uint8_t* data, const std::size_t data_length, const std::chrono::steady_clock::time_point rxTime)
+{
+    audioDecoder.enqueueAudio(data, data_length);
+    mDvr.onAudio(data, data_length, rxTime);
+}
+
+std::chrono::milliseconds VideoPlayer::releaseExpiredPackets()
+{
+    // Whatever the queues still hold comes from their own storage
+    auto videoCallback =
+        [this](const uint8_t* data, std::size_t data_length, std::chrono::steady_clock::time_point rxTime)
+    { onVideoPacket(data, data_length, false, rxTime); };
+    auto audioCallback =
+        [this](const uint8_t* data, std::size_t data_length, std::chrono::steady_clock::time_point rxTime)
+    { onAudioPacket(data, data_length, rxTime); };
+    const uint64_t nowMs = BufferedPacketQueue::steadyTimeMs();
+    mBufferedPacketQueueVideo.poll(videoCallback, nowMs);
+    mBufferedPacketQueueAudio.poll(audioCallback, nowMs);
+    const uint64_t deadline =
+        std::min(mBufferedPacketQueueVideo.nextDeadlineMs(), mBufferedPacketQueueAudio.nextDeadlineMs());
+    if (deadline == BufferedPacketQueue::NO_DEADLINE) return std::chrono::milliseconds::max();
+    return std::chrono::milliseconds(deadline > nowMs ? deadline - nowMs : 0);
+}
+
 void VideoPlayer::onNewNALU(const NALU& nalu)
 {
+    videoDecoder.setStreamDamaged(mParser.getLossTracker().isDamaged());
     videoDecoder.interpretNALU(nalu);
-    if (dvr_fd <= 0 || latestDecodingInfo.currentFPS <= 0)
+    if (!mDvr.isRunning() || latestDecodingInfo.currentFPS <= 0)
     {
         return;
     }
-    // Copy data to write if from a different thread.
-    uint8_t* m_data_copy = new uint8_t[nalu.getSize()];
-    memcpy(m_data_copy, nalu.getData(), nalu.getSize());
-    NALU nalu_(m_data_copy, nalu.getSize(), nalu.IS_H265_PACKET);
-    enqueueNALU(nalu_);
+    mDvr.onNALU(nalu);
+}
+
+void VideoPlayer::setAccessUnitMode(bool enable)
+{
+    // Decoder first: while switching on, NALUs of the current picture may get lost, but never fed twice
+    videoDecoder.setAccessUnitMode(enable);
+    mParser.setAccessUnitMode(enable);
+}
+
+void VideoPlayer::setLossPolicy(LossTracker::Policy policy)
+{
+    mParser.setLossPolicy(policy);
 }
 
 void VideoPlayer::setVideoSurface(JNIEnv* env, jobject surface, jint i)
@@ -172,7 +180,15 @@ void VideoPlayer::start(JNIEnv* env, jobject androidContext)
         -16,
         [this](const uint8_t* data, size_t data_length) { onNewRTPData(data, data_length); },
         WANTED_UDP_RCVBUF_SIZE);
-    mUDPReceiver->startReceiving();
+    // Batches carry the kernel receive time of each datagram
+    mUDPReceiver->setBatchCallback(
+        [this](std::span<const ReceivedDatagram> datagrams)
+        {
+            for (const ReceivedDatagram& datagram : datagrams)
+            {
+                onNewRTPData(datagram.data, datagram.size, datagram.rxTime);
+            }
+        });
 
     mUDSReceiver.release();
     // build the abstract socket name ("\0my_socket")
@@ -187,22 +203,31 @@ void VideoPlayer::start(JNIEnv* env, jobject androidContext)
         [this](const uint8_t* data, size_t data_length) { onNewRTPData(data, data_length); },
         WANTED_UDP_RCVBUF_SIZE  // your desired recv‑buffer size
     );
+    mUDSReceiver->setBatchCallback(
+        [this](std::span<const ReceivedDatagram> datagrams)
+        {
+            for (const ReceivedDatagram& datagram : datagrams)
+            {
+                onNewRTPData(datagram.data, datagram.size, datagram.rxTime);
+            }
+        });
 
-    mUDSReceiver->startReceiving();
+    // All sources on one thread. The in-process ring is fed by the wfb-ng aggregator when the in-process video path
+    // is enabled, the sockets are the fallback for an external wfb-ng
+    mIngestReactor->clearSources();
+    mIngestReactor->addSource(mInProcessReceiver.get(), 2, "in-process");
+    mIngestReactor->addSource(mUDSReceiver.get(), 1, "uds");
+    mIngestReactor->addSource(mUDPReceiver.get(), 0, "udp:" + std::to_string(VS_PORT));
+    mIngestReactor->start();
 }
 
 void VideoPlayer::stop(JNIEnv* env, jobject androidContext)
 {
-    if (mUDPReceiver)
-    {
-        mUDPReceiver->stopReceiving();
-        mUDPReceiver.reset();
-    }
-    if (mUDSReceiver)
-    {
-        mUDSReceiver->stopReceiving();
-        mUDSReceiver.reset();
-    }
+    // Closes the sources as well
+    mIngestReactor->stop();
+    mIngestReactor->clearSources();
+    mUDPReceiver.reset();
+    mUDSReceiver.reset();
 
     audioDecoder.stopAudio();
 }
@@ -210,7 +235,17 @@ void VideoPlayer::stop(JNIEnv* env, jobject androidContext)
 std::string VideoPlayer::getInfoString() const
 {
     std::stringstream ss;
-    if (mUDPReceiver)
+    if (const std::string active = mIngestReactor->getActiveSourceName(); !active.empty())
+    {
+        ss << "Receiving video from " << active << "\n";
+    }
+    if (mInProcessReceiver->getNReceivedBytes() > 0)
+    {
+        ss << "Receiving video in-process from wfb-ng";
+        ss << "\nReceived: " << mInProcessReceiver->getNReceivedBytes() << "B"
+           << " | dropped packets: " << mInProcessReceiver->getNDroppedPackets();
+    }
+    else if (mUDPReceiver)
     {
         ss << "Listening for video on port " << mUDPReceiver->getPort();
         ss << "\nReceived: " << mUDPReceiver->getNReceivedBytes() << "B"
@@ -228,26 +263,31 @@ std::string VideoPlayer::getInfoString() const
     {
         ss << "Not receiving udp raw / rtp / rtsp";
     }
+    if (mDvr.isRunning())
+    {
+        const DvrArena::Stats dvr = mDvr.getStats();
+        ss << "\nRecording: buffered " << dvr.bytesBuffered << "B of " << dvr.capacity << "B"
+           << " | dropped " << dvr.nDropped << " NALUs / audio packets, " << dvr.bytesDropped << "B";
+    }
     return ss.str();
 }
 
 void VideoPlayer::startDvr(JNIEnv* env, jint fd, jint dvr_fmp4_enabled)
 {
-    dvr_fd                = dup(fd);
-    dvr_mp4_fragmentation = dvr_fmp4_enabled;
+    const int dvr_fd = dup(fd);
     __android_log_print(ANDROID_LOG_DEBUG, TAG, "dvr_fd=%d", dvr_fd);
     if (dvr_fd == -1)
     {
         __android_log_print(ANDROID_LOG_DEBUG, TAG, "Failed to duplicate dvr file descriptor");
         return;
     }
-    startProcessing();
+    mDvr.start(dvr_fd, dvr_fmp4_enabled != 0);
 }
 
 void VideoPlayer::stopDvr()
 {
     __android_log_print(ANDROID_LOG_DEBUG, TAG, "Stop dvr");
-    stopProcessing();
+    mDvr.stop();
 }
 
 //----------------------------------------------------JAVA
@@ -322,6 +362,7 @@ extern "C"
         {
             ret |= (p->mUDSReceiver->getNReceivedBytes() > 0);
         }
+        ret |= (p->mInProcessReceiver->getNReceivedBytes() > 0);
 
         return (jboolean) ret;
     }
@@ -369,7 +410,7 @@ extern "C"
             {
                 jclass jcDecodingInfo = env->FindClass("com/openipc/videonative/DecodingInfo");
                 assert(jcDecodingInfo != nullptr);
-                jmethodID jcDecodingInfoConstructor = env->GetMethodID(jcDecodingInfo, "<init>", "(FFFFFIIII)V");
+                jmethodID jcDecodingInfoConstructor = env->GetMethodID(jcDecodingInfo, "<init>", "(FFFFFIIIIFF)V");
                 assert(jcDecodingInfoConstructor != nullptr);
                 const auto info         = p->latestDecodingInfo;
                 auto       decodingInfo = env->NewObject(
@@ -383,7 +424,9 @@ extern "C"
                     (jint) info.nNALU,
                     (jint) info.nNALUSFeeded,
                     (jint) info.nDecodedFrames,
-                    (jint) info.nCodec);
+                    (jint) info.nCodec,
+                    (jfloat) info.codecCallsPerFrame,
+                    (jfloat) info.avgReceiveTime_ms);
                 assert(decodingInfo != nullptr);
                 jmethodID onDecodingInfoChangedJAVA = env->GetMethodID(
                     jClassExtendsIVideoParamsChanged,
@@ -424,8 +467,32 @@ Java_com_openipc_videonative_VideoPlayer_nativeStartAudio(JNIEnv* env, jclass cl
     native(native_instance)->audioDecoder.stopAudioProcessing();
     native(native_instance)->audioDecoder.startAudioProcessing();
 }
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_openipc_videonative_VideoPlayer_nativeGetInProcessSink(JNIEnv* env, jclass clazz, jlong native_instance)
+{
+    return reinterpret_cast<intptr_t>(native(native_instance)->getInProcessSink());
+}
+
 extern "C" JNIEXPORT void JNICALL
 Java_com_openipc_videonative_VideoPlayer_nativeStopAudio(JNIEnv* env, jclass clazz, jlong native_instance)
 {
     native(native_instance)->audioDecoder.stopAudioProcessing();
 }
+
+extern "C" JNIEXPORT void JNICALL Java_com_openipc_videonative_VideoPlayer_nativeSetAccessUnitMode(
+    JNIEnv* env, jclass clazz, jlong native_instance, jboolean enable)
+{
+    native(native_instance)->setAccessUnitMode(enable);
+}
+
+extern "C" JNIEXPORT void JNICALL Java_com_openipc_videonative_VideoPlayer_nativeSetLossPolicy(
+    JNIEnv* env, jclass clazz, jlong native_instance, jint policy)
+{
+    native(native_instance)->setLossPolicy(static_cast<LossTracker::Policy>(policy));
+}
+
+extern "C" JNIEXPORT void JNICALL Java_com_openipc_videonative_VideoPlayer_nativeSetSliceStreaming(
+    JNIEnv* env, jclass clazz, jlong native_instance, jboolean enable)
+{
+    native(native_instance)->videoDecoder.setSliceStreaming(enable);
+}
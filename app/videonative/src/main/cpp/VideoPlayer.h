@@ -8,13 +8,14 @@
 #include <jni.h>
 #include <stdio.h>
 #include <fstream>
-#include <queue>
 #include "AudioDecoder.h"
 #include "BufferedPacketQueue.h"
+#include "DvrWriter.h"
+#include "InProcessReceiver.h"
+#include "IngestReactor.h"
 #include "UdpReceiver.h"
 #include "UdsReceiver.h"
 #include "VideoDecoder.h"
-#include "minimp4.h"
 #include "parser/H26XParser.h"
 #include "time_util.h"
 
@@ -23,7 +24,19 @@ class VideoPlayer
   public:
     VideoPlayer(JNIEnv* env, jobject context);
 
-    void onNewRTPData(const uint8_t* data, const std::size_t data_length);
+    // rxTime: when the packet was received by the socket / radio, now if unknown
+    // packet_stays_valid: data is kept alive until the parser no longer references it (in-process receiver)
+    void onNewRTPData(
+        const uint8_t*                        data,
+        const std::size_t                     data_length,
+        std::chrono::steady_clock::time_point rxTime             = {},
+        bool                                  packet_stays_valid = false);
+
+    // Feed the decoder one buffer per picture instead of one per NALU
+    void setAccessUnitMode(bool enable);
+
+    // Forward or drop pictures depending on lost data until the next keyframe, see LossTracker
+    void setLossPolicy(LossTracker::Policy policy);
 
     /*
      * Set the surface the decoder can be configured with. When @param surface==nullptr
@@ -50,11 +63,29 @@ class VideoPlayer
 
     void stopDvr();
 
-    bool isRecording() { return (get_time_ms() - last_dvr_write) <= 500; }
+    /*
+     * Sink the wfb-ng video aggregator can push RTP packets into directly (same process, no UDP hop).
+     * Valid for the whole lifetime of the VideoPlayer, packets are only consumed between start() and stop()
+     */
+    const InProcessRtpSink* getInProcessSink() const { return mInProcessReceiver->getSink(); }
+
+    bool isRecording() { return mDvr.isRecording(); }
 
   private:
     void onNewNALU(const NALU& nalu);
 
+    // In order RTP packets out of the packet queues
+    void onVideoPacket(
+        const uint8_t*                        data,
+        std::size_t                           data_length,
+        bool                                  packet_stays_valid,
+        std::chrono::steady_clock::time_point rxTime);
+
+    void onAudioPacket(const uint8_t* data, std::size_t data_length, std::chrono::steady_clock::time_point rxTime);
+
+    // Reactor tick: releases the packets whose gap deadline passed, returns the time until the next deadline
+    std::chrono::milliseconds releaseExpiredPackets();
+
     // Assumptions: Max bitrate: 40 MBit/s, Max time to buffer: 500ms
     // 25 MB should be plenty !
     static constexpr const size_t WANTED_UDP_RCVBUF_SIZE = 1024 * 1024 * 25;
@@ -72,51 +103,17 @@ class VideoPlayer
     H26XParser          mParser;
     BufferedPacketQueue mBufferedPacketQueueVideo, mBufferedPacketQueueAudio;
 
-    // DVR attributes
-    int                     dvr_fd;
-    std::queue<NALU>        naluQueue;
-    std::mutex              mtx;
-    std::condition_variable cv;
-    bool                    stopFlag = false;
-    std::thread             processingThread;
-    int                     dvr_mp4_fragmentation = 0;
-    uint64_t                last_dvr_write        = 0;
-
-    void enqueueNALU(const NALU& nalu)
-    {
-        {
-            std::lock_guard<std::mutex> lock(mtx);
-            naluQueue.push(nalu);
-        }
-        cv.notify_one();
-    }
-
-    void startProcessing()
-    {
-        stopFlag         = false;
-        processingThread = std::thread(&VideoPlayer::processQueue, this);
-    }
-
-    void stopProcessing()
-    {
-        {
-            std::lock_guard<std::mutex> lock(mtx);
-            stopFlag = true;
-        }
-        cv.notify_all();
-        if (processingThread.joinable())
-        {
-            processingThread.join();
-        }
-    }
-
-    void processQueue();
+    DvrWriter mDvr;
 
   public:
     AudioDecoder                 audioDecoder;
     VideoDecoder                 videoDecoder;
     std::unique_ptr<UDPReceiver> mUDPReceiver;
     std::unique_ptr<UDSReceiver> mUDSReceiver;
+    // Created once in the constructor, so the sink handed to wfb-ng never dangles
+    std::unique_ptr<InProcessReceiver> mInProcessReceiver;
+    // The one thread all of the above deliver on, so mParser and the packet queues are never used concurrently
+    std::unique_ptr<IngestReactor> mIngestReactor;
     long                         nNALUsAtLastCall = 0;
 
   public:
@@ -0,0 +1,228 @@
+// Host benchmark: the DVR file I/O under the MP4 muxer, for a synthetic recording.
+//   stdio    - fseek() + fwrite() for every write minimp4 issues, the old DVR write callback
+//   pwrite   - DvrFile, write-behind buffer and pwrite() on the muxer thread
+//   flusher  - DvrFile with its flusher thread and fdatasync() every second
+//
+// Write syscalls are the kernel's count (/proc/self/io syscw), seeks are counted for stdio. Writing to a file (not
+// /dev/null) also checks that all three modes produce the same file.
+//
+// Usage: dvr_write_bench [minutes=60] [output=/dev/null] [mbit=30] [fragmented=1]
+
+#include "DvrFile.h"
+#include "minimp4.h"
+
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+constexpr int FPS        = 30;
+constexpr int GOP_FRAMES = 60;
+constexpr int WIDTH      = 1280;
+constexpr int HEIGHT     = 720;
+
+// 1280x720 high profile parameter sets
+const std::vector<uint8_t> SPS = {0x00, 0x00, 0x00, 0x01, 0x67, 0x64, 0x00, 0x1f, 0xac, 0xd9, 0x40, 0x50, 0x05,
+                                  0xbb, 0x01, 0x10, 0x00, 0x00, 0x03, 0x00, 0x10, 0x00, 0x00, 0x03, 0x03, 0xc0,
+                                  0xf1, 0x83, 0x19, 0x60};
+const std::vector<uint8_t> PPS = {0x00, 0x00, 0x00, 0x01, 0x68, 0xeb, 0xe3, 0xcb, 0x22, 0xc0};
+
+struct Result
+{
+    double   seconds    = 0;
+    int64_t  muxerCpuNs = 0;
+    uint64_t bytes      = 0;
+    uint64_t writes     = 0;
+    uint64_t seeks      = 0;
+    long     syscw      = -1;
+    uint64_t syncs      = 0;
+    uint64_t checksum   = 0;
+};
+
+int64_t threadCpuNs()
+{
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+// Write syscalls of the whole process so far, -1 if not available
+long writeSyscalls()
+{
+    FILE* io = fopen("/proc/self/io", "r");
+    if (io == nullptr) return -1;
+    char line[128];
+    long syscw = -1;
+    while (fgets(line, sizeof(line), io))
+    {
+        if (sscanf(line, "syscw: %ld", &syscw) == 1) break;
+    }
+    fclose(io);
+    return syscw;
+}
+
+struct StdioFile
+{
+    FILE*    file;
+    uint64_t writes = 0, seeks = 0, bytes = 0;
+};
+
+int stdioWriteCallback(int64_t offset, const void* buffer, size_t size, void* token)
+{
+    auto* f = static_cast<StdioFile*>(token);
+    f->writes++;
+    f->seeks++;
+    f->bytes += size;
+    fseek(f->file, offset, SEEK_SET);
+    return fwrite(buffer, 1, size, f->file) != size;
+}
+
+uint64_t fnv1a(const std::string& path)
+{
+    FILE* f = fopen(path.c_str(), "rb");
+    if (f == nullptr) return 0;
+    uint64_t             hash = 1469598103934665603ULL;
+    std::vector<uint8_t> buffer(1 << 20);
+    size_t               n;
+    while ((n = fread(buffer.data(), 1, buffer.size(), f)) > 0)
+    {
+        for (size_t i = 0; i < n; ++i) hash = (hash ^ buffer[i]) * 1099511628211ULL;
+    }
+    fclose(f);
+    return hash;
+}
+
+// Muxes the synthetic stream, writing through token / callback
+void mux(
+    double minutes, double mbit, bool fragmented, void* token, int (*callback)(int64_t, const void*, size_t, void*))
+{
+    MP4E_mux_t*       mux = MP4E_open(0, fragmented, token, callback);
+    mp4_h26x_writer_t writer{};
+    if (mux == nullptr || mp4_h26x_write_init(&writer, mux, WIDTH, HEIGHT, 0) != MP4E_STATUS_OK)
+    {
+        fprintf(stderr, "mp4 init failed\n");
+        exit(1);
+    }
+    // Payload without zero bytes, so it never contains a start code
+    std::mt19937         random(1);
+    std::vector<uint8_t> payload(4 * 1024 * 1024);
+    for (auto& b : payload) b = 1 + random() % 255;
+    const size_t         averageFrame = static_cast<size_t>(mbit * 1e6 / 8 / FPS);
+    std::vector<uint8_t> nalu;
+
+    const long frames = static_cast<long>(minutes * 60 * FPS);
+    for (long frame = 0; frame < frames; ++frame)
+    {
+        const bool key = frame % GOP_FRAMES == 0;
+        if (key)
+        {
+            mp4_h26x_write_nal(&writer, SPS.data(), (int) SPS.size(), 90000 / FPS);
+            mp4_h26x_write_nal(&writer, PPS.data(), (int) PPS.size(), 90000 / FPS);
+        }
+        // Key frames 4x the size of the others, same average bit rate
+        const size_t size = key ? averageFrame * 4 * GOP_FRAMES / (GOP_FRAMES + 3)
+                                : averageFrame * GOP_FRAMES / (GOP_FRAMES + 3) + random() % 256;
+        nalu.assign({0x00, 0x00, 0x00, 0x01, static_cast<uint8_t>(key ? 0x65 : 0x41), 0x88, 0x84});
+        const size_t offset = random() % (payload.size() - size);
+        nalu.insert(nalu.end(), payload.begin() + offset, payload.begin() + offset + size);
+        if (mp4_h26x_write_nal(&writer, nalu.data(), (int) nalu.size(), 90000 / FPS) != MP4E_STATUS_OK)
+        {
+            fprintf(stderr, "mp4 write failed\n");
+            exit(1);
+        }
+    }
+    MP4E_close(mux);
+    mp4_h26x_write_close(&writer);
+}
+
+Result run(const char* mode, double minutes, const std::string& path, double mbit, bool fragmented)
+{
+    Result     result;
+    const int  fd         = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    const long syscwStart = writeSyscalls();
+    const auto start      = Clock::now();
+    const auto cpuStart   = threadCpuNs();
+    if (strcmp(mode, "stdio") == 0)
+    {
+        StdioFile file{fdopen(fd, "wb")};
+        mux(minutes, mbit, fragmented, &file, stdioWriteCallback);
+        fclose(file.file);
+        result.writes = file.writes;
+        result.seeks  = file.seeks;
+        result.bytes  = file.bytes;
+    }
+    else
+    {
+        DvrFile::Options options;
+        options.flusherThread = strcmp(mode, "flusher") == 0;
+        options.syncInterval  = std::chrono::milliseconds(options.flusherThread ? 1000 : 0);
+        DvrFile file(fd, options);
+        mux(minutes, mbit, fragmented, &file, DvrFile::writeCallback);
+        file.close();
+        const DvrFile::Stats stats = file.getStats();
+        result.writes              = stats.nWrites;
+        result.bytes               = stats.bytesWritten;
+        result.syncs               = stats.nSyncs;
+    }
+    result.muxerCpuNs = threadCpuNs() - cpuStart;
+    result.seconds    = std::chrono::duration<double>(Clock::now() - start).count();
+    if (syscwStart >= 0) result.syscw = writeSyscalls() - syscwStart;
+    if (path != "/dev/null") result.checksum = fnv1a(path);
+    return result;
+}
+
+void report(const char* name, const Result& r)
+{
+    printf(
+        "%-8s %.0f MB in %.2fs, %.0f MB/s | write calls=%lu | write syscalls=%ld (%.1f KB each) | seeks=%lu | "
+        "fdatasync=%lu | muxer thread cpu ms=%.0f\n",
+        name,
+        r.bytes / 1e6,
+        r.seconds,
+        r.bytes / 1e6 / r.seconds,
+        (unsigned long) r.writes,
+        r.syscw,
+        r.syscw > 0 ? r.bytes / 1024.0 / r.syscw : 0.0,
+        (unsigned long) r.seeks,
+        (unsigned long) r.syncs,
+        r.muxerCpuNs / 1e6);
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    const double      minutes    = argc > 1 ? atof(argv[1]) : 60.0;
+    const std::string output     = argc > 2 ? argv[2] : "/dev/null";
+    const double      mbit       = argc > 3 ? atof(argv[3]) : 30.0;
+    const bool        fragmented = argc > 4 ? atoi(argv[4]) != 0 : true;
+
+    printf(
+        "DVR write benchmark: %.1f minutes at %.1f Mbit/s, %s mp4, to %s\n",
+        minutes,
+        mbit,
+        fragmented ? "fragmented" : "plain",
+        output.c_str());
+    uint64_t checksum = 0;
+    bool     same     = true;
+    for (const char* mode : {"stdio", "pwrite", "flusher"})
+    {
+        const Result result = run(mode, minutes, output, mbit, fragmented);
+        report(mode, result);
+        if (checksum != 0 && result.checksum != checksum) same = false;
+        checksum = result.checksum;
+    }
+    if (output != "/dev/null") printf("files %s\n", same ? "identical" : "DIFFER");
+    return same ? 0 : 1;
+}
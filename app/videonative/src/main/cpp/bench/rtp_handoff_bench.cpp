@@ -0,0 +1,205 @@
+// Host benchmark: per-packet latency and CPU cost of handing RTP packets from the wfb-ng aggregator thread to the
+// video receiver thread.
+//   udp     - sendto(127.0.0.1) + recvfrom(), what AggregatorUDPv4 + UDPReceiver do
+//   inproc  - SpscPacketRing push + popWait(), what AggregatorInProcess + InProcessReceiver do
+//
+// Usage: rtp_handoff_bench [seconds=5] [mbit=30] [packet_size=1400]
+
+#include "SpscPacketRing.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+constexpr int    BENCH_PORT   = 56000;
+constexpr size_t MAX_PKT_SIZE = 4096;
+
+struct Result
+{
+    std::vector<int64_t> latencies_ns;
+    int64_t              producer_cpu_ns = 0;
+    int64_t              consumer_cpu_ns = 0;
+    long                 sent            = 0;
+    long                 dropped         = 0;
+};
+
+int64_t threadCpuNs()
+{
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+int64_t nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+// Paced producer, stamps the send time into the first 8 bytes of every packet
+void producerLoop(
+    double seconds, double mbit, size_t packet_size, Result& result, const std::function<bool(const uint8_t*, size_t)>& send)
+{
+    std::vector<uint8_t> packet(packet_size, 0x42);
+    const auto           interval = std::chrono::nanoseconds(static_cast<int64_t>(packet_size * 8 * 1e9 / (mbit * 1e6)));
+    const auto           end      = Clock::now() + std::chrono::duration<double>(seconds);
+    auto                 next     = Clock::now();
+    const int64_t        cpuStart = threadCpuNs();
+    while (next < end)
+    {
+        std::this_thread::sleep_until(next);
+        const int64_t ts = nowNs();
+        std::memcpy(packet.data(), &ts, sizeof(ts));
+        if (!send(packet.data(), packet.size())) result.dropped++;
+        result.sent++;
+        next += interval;
+    }
+    result.producer_cpu_ns = threadCpuNs() - cpuStart;
+}
+
+void recordLatency(Result& result, const uint8_t* data, size_t data_length)
+{
+    if (data_length < sizeof(int64_t)) return;
+    int64_t ts;
+    std::memcpy(&ts, data, sizeof(ts));
+    result.latencies_ns.push_back(nowNs() - ts);
+}
+
+Result runUdp(double seconds, double mbit, size_t packet_size)
+{
+    Result result;
+    result.latencies_ns.reserve(static_cast<size_t>(seconds * mbit * 1e6 / 8 / packet_size) + 1024);
+
+    const int   rx = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    const int   tx = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    sockaddr_in addr{};
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port        = htons(BENCH_PORT);
+    if (bind(rx, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+    {
+        perror("bind");
+        exit(1);
+    }
+    timeval tv{0, 100000};
+    setsockopt(rx, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    std::atomic<bool> running{true};
+    std::thread       consumer(
+        [&]
+        {
+            std::vector<uint8_t> buf(65507);
+            const int64_t        cpuStart = threadCpuNs();
+            while (running)
+            {
+                sockaddr_in   source{};
+                socklen_t     sourceLen = sizeof(source);
+                const ssize_t n = recvfrom(rx, buf.data(), buf.size(), 0, reinterpret_cast<sockaddr*>(&source), &sourceLen);
+                if (n > 0) recordLatency(result, buf.data(), static_cast<size_t>(n));
+            }
+            result.consumer_cpu_ns = threadCpuNs() - cpuStart;
+        });
+
+    producerLoop(
+        seconds,
+        mbit,
+        packet_size,
+        result,
+        [&](const uint8_t* data, size_t len)
+        { return sendto(tx, data, len, 0, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == (ssize_t) len; });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    running = false;
+    consumer.join();
+    close(rx);
+    close(tx);
+    return result;
+}
+
+Result runInProcess(double seconds, double mbit, size_t packet_size)
+{
+    Result result;
+    result.latencies_ns.reserve(static_cast<size_t>(seconds * mbit * 1e6 / 8 / packet_size) + 1024);
+
+    auto              ring = std::make_unique<SpscPacketRing<MAX_PKT_SIZE, 1024>>();
+    std::atomic<bool> running{true};
+    std::thread       consumer(
+        [&]
+        {
+            const int64_t cpuStart = threadCpuNs();
+            const auto    consume  = [&](const uint8_t* data, size_t len) { recordLatency(result, data, len); };
+            while (running)
+            {
+                ring->popWait(consume, std::chrono::milliseconds(50));
+            }
+            while (ring->pop(consume))
+            {
+            }
+            result.consumer_cpu_ns = threadCpuNs() - cpuStart;
+        });
+
+    producerLoop(
+        seconds, mbit, packet_size, result, [&](const uint8_t* data, size_t len) { return ring->push(data, len); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    running = false;
+    ring->wakeConsumer();
+    consumer.join();
+    return result;
+}
+
+void report(const char* name, Result& r, double seconds)
+{
+    auto& lat = r.latencies_ns;
+    std::sort(lat.begin(), lat.end());
+    const auto pct = [&](double p) -> double
+    {
+        if (lat.empty()) return 0;
+        return lat[std::min(lat.size() - 1, static_cast<size_t>(p * lat.size()))] / 1000.0;
+    };
+    const double n = std::max<size_t>(lat.size(), 1);
+    printf(
+        "%-7s sent=%ld recv=%zu dropped=%ld | latency us p50=%.1f p90=%.1f p99=%.1f max=%.1f | cpu/pkt us "
+        "producer=%.2f consumer=%.2f | cpu %%core=%.2f\n",
+        name,
+        r.sent,
+        lat.size(),
+        r.dropped,
+        pct(0.5),
+        pct(0.9),
+        pct(0.99),
+        lat.empty() ? 0.0 : lat.back() / 1000.0,
+        r.producer_cpu_ns / 1000.0 / n,
+        r.consumer_cpu_ns / 1000.0 / n,
+        100.0 * (r.producer_cpu_ns + r.consumer_cpu_ns) / (seconds * 1e9));
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    const double seconds     = argc > 1 ? atof(argv[1]) : 5.0;
+    const double mbit        = argc > 2 ? atof(argv[2]) : 30.0;
+    const size_t packet_size = argc > 3 ? std::clamp<size_t>(atoi(argv[3]), 16, MAX_PKT_SIZE) : 1400;
+
+    printf("RTP handoff benchmark: %.1fs at %.1f Mbit/s, %zu byte packets\n", seconds, mbit, packet_size);
+    auto udp = runUdp(seconds, mbit, packet_size);
+    report("udp", udp, seconds);
+    auto inproc = runInProcess(seconds, mbit, packet_size);
+    report("inproc", inproc, seconds);
+    return 0;
+}
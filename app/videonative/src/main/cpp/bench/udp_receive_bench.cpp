@@ -0,0 +1,220 @@
+// Host benchmark: syscalls and receiver CPU per Mbit of the UDP receive loop, fed by a local sender.
+//   recvfrom  - one recvfrom() per datagram plus inet_ntoa() / std::string per packet, the old UDPReceiver loop
+//   recvmmsg  - DatagramBatch (recvmmsg, MSG_WAITFORONE) with source tracking only on change, the current one
+//
+// Usage: udp_receive_bench [seconds=5] [mbit=30 (0: as fast as possible)] [packet_size=1400]
+
+#include "DatagramBatch.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+constexpr int    BENCH_PORT          = 56001;
+constexpr size_t UDP_PACKET_MAX_SIZE = 65507;
+constexpr size_t BATCH_SIZE          = 16;
+
+struct Result
+{
+    long    sent          = 0;
+    long    received      = 0;
+    long    receivedBytes = 0;
+    long    syscalls      = 0;
+    long    sourceChanges = 0;
+    int64_t consumerCpuNs = 0;
+};
+
+int64_t threadCpuNs()
+{
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+int openReceiver()
+{
+    const int   rx = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    sockaddr_in addr{};
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port        = htons(BENCH_PORT);
+    int enable           = 1;
+    setsockopt(rx, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    // Same as VideoPlayer::WANTED_UDP_RCVBUF_SIZE
+    const int rcvbuf = 1024 * 1024 * 25;
+    setsockopt(rx, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    if (bind(rx, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+    {
+        perror("bind");
+        exit(1);
+    }
+    return rx;
+}
+
+// Paced (or unpaced with mbit == 0) sender on its own thread
+void senderLoop(double seconds, double mbit, size_t packet_size, Result& result)
+{
+    const int   tx = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    sockaddr_in addr{};
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port        = htons(BENCH_PORT);
+
+    std::vector<uint8_t> packet(packet_size, 0x42);
+    const auto           interval =
+        std::chrono::nanoseconds(mbit > 0 ? static_cast<int64_t>(packet_size * 8 * 1e9 / (mbit * 1e6)) : 0);
+    const auto end  = Clock::now() + std::chrono::duration<double>(seconds);
+    auto       next = Clock::now();
+    while (next < end)
+    {
+        if (mbit > 0)
+        {
+            std::this_thread::sleep_until(next);
+            next += interval;
+        }
+        else
+        {
+            next = Clock::now();
+        }
+        if (sendto(tx, packet.data(), packet.size(), 0, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) > 0)
+        {
+            result.sent++;
+        }
+    }
+    close(tx);
+}
+
+Result run(double seconds, double mbit, size_t packet_size, const std::function<void(int, Result&)>& receiveOnce)
+{
+    Result            result;
+    const int         rx = openReceiver();
+    std::atomic<bool> running{true};
+    std::thread       consumer(
+        [&]
+        {
+            const int64_t cpuStart = threadCpuNs();
+            while (running)
+            {
+                receiveOnce(rx, result);
+            }
+            result.consumerCpuNs = threadCpuNs() - cpuStart;
+        });
+    senderLoop(seconds, mbit, packet_size, result);
+    // Let the receiver drain, then wake it up
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    running = false;
+    shutdown(rx, SHUT_RD);
+    consumer.join();
+    close(rx);
+    return result;
+}
+
+Result runRecvfrom(double seconds, double mbit, size_t packet_size)
+{
+    std::vector<uint8_t> buf(UDP_PACKET_MAX_SIZE);
+    std::string          senderIP = "0.0.0.0";
+    return run(
+        seconds,
+        mbit,
+        packet_size,
+        [&](int rx, Result& result)
+        {
+            sockaddr_in   source{};
+            socklen_t     sourceLen = sizeof(source);
+            const ssize_t n = recvfrom(rx, buf.data(), buf.size(), 0, reinterpret_cast<sockaddr*>(&source), &sourceLen);
+            result.syscalls++;
+            if (n <= 0) return;
+            result.received++;
+            result.receivedBytes += n;
+            const std::string s1 = inet_ntoa(source.sin_addr);
+            if (senderIP != s1)
+            {
+                senderIP = s1;
+                result.sourceChanges++;
+            }
+        });
+}
+
+Result runRecvmmsg(double seconds, double mbit, size_t packet_size)
+{
+    DatagramBatch batch(BATCH_SIZE, UDP_PACKET_MAX_SIZE);
+    sockaddr_in   lastSource{};
+    Result        total = run(
+        seconds,
+        mbit,
+        packet_size,
+        [&](int rx, Result& result)
+        {
+            if (batch.receive(rx) <= 0) return;
+            for (const ReceivedDatagram& datagram : batch.datagrams())
+            {
+                result.received++;
+                result.receivedBytes += datagram.size;
+            }
+            const auto& source = *reinterpret_cast<const sockaddr_in*>(batch.datagrams().back().source);
+            if (source.sin_addr.s_addr != lastSource.sin_addr.s_addr || lastSource.sin_family != AF_INET)
+            {
+                lastSource = source;
+                result.sourceChanges++;
+            }
+        });
+    total.syscalls = batch.nSyscalls;
+    return total;
+}
+
+void report(const char* name, const Result& r)
+{
+    const double mbits = r.receivedBytes * 8 / 1e6;
+    printf(
+        "%-9s sent=%ld recv=%ld lost=%ld | syscalls=%ld (%.3f per packet, %.2f packets per call) | source updates=%ld "
+        "| receiver cpu ms=%.1f, us/Mbit=%.2f, us/packet=%.3f\n",
+        name,
+        r.sent,
+        r.received,
+        r.sent - r.received,
+        r.syscalls,
+        r.received ? static_cast<double>(r.syscalls) / r.received : 0.0,
+        r.syscalls ? static_cast<double>(r.received) / r.syscalls : 0.0,
+        r.sourceChanges,
+        r.consumerCpuNs / 1e6,
+        mbits > 0 ? r.consumerCpuNs / 1000.0 / mbits : 0.0,
+        r.received ? r.consumerCpuNs / 1000.0 / r.received : 0.0);
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    const double seconds     = argc > 1 ? atof(argv[1]) : 5.0;
+    const double mbit        = argc > 2 ? atof(argv[2]) : 30.0;
+    const size_t packet_size = argc > 3 ? std::clamp<size_t>(atoi(argv[3]), 16, UDP_PACKET_MAX_SIZE) : 1400;
+
+    if (mbit > 0)
+    {
+        printf("UDP receive benchmark: %.1fs at %.1f Mbit/s, %zu byte packets\n", seconds, mbit, packet_size);
+    }
+    else
+    {
+        printf("UDP receive benchmark: %.1fs as fast as possible, %zu byte packets\n", seconds, packet_size);
+    }
+    report("recvfrom", runRecvfrom(seconds, mbit, packet_size));
+    report("recvmmsg", runRecvmmsg(seconds, mbit, packet_size));
+    return 0;
+}
@@ -3,20 +3,19 @@
 #define FPVUE_ANDROIDMEDIAFORMATHELPER_H
 
 #include <media/NdkMediaFormat.h>
+#include "../DecoderProfiles.h"
 #include "../NALU/KeyFrameFinder.hpp"
 
 // Some of these params are only supported on the latest Android versions
 // However,writing them has no negative affect on devices with older Android versions
+// (except for the few decoders that refuse them, see DecoderProfileStore)
 // Note that for example the low-latency key cannot fix any issues like the 'VUI' issue
-void writeAndroidPerformanceParams(AMediaFormat* format)
+static void writeAndroidPerformanceParams(AMediaFormat* format, const DecoderProfile& profile)
 {
-    // I think: KEY_LOW_LATENCY is for decoder. But it doesn't really make a difference anyways
-    static const auto PARAMETER_KEY_LOW_LATENCY = "low-latency";
-    AMediaFormat_setInt32(format, PARAMETER_KEY_LOW_LATENCY, 1);
-    // Lower values mean higher priority
-    // Works on pixel 3 (look at output format description)
-    static const auto AMEDIAFORMAT_KEY_PRIORITY = "priority";
-    AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_PRIORITY, 0);
+    for (const auto& [key, value] : profile.keys)
+    {
+        AMediaFormat_setInt32(format, key, value);
+    }
     // set operating rate ? - doesn't make a difference
     // static const auto AMEDIAFORMAT_KEY_OPERATING_RATE="operating-rate";
     // AMediaFormat_setInt32(format,AMEDIAFORMAT_KEY_OPERATING_RATE,60);
@@ -42,7 +41,6 @@ static void h264_configureAMediaFormat(KeyFrameFinder& kff, AMediaFormat* format
     // AVCProfileBaseline==1
     // AMediaFormat_setInt32(decoder.format,AMEDIAFORMAT_KEY_PROFILE,1);
     // AMediaFormat_setInt32(decoder.format,AMEDIAFORMAT_KEY_PRIORITY,0);
-    // writeAndroidPerformanceParams(format);
 }
 
 static void h265_configureAMediaFormat(KeyFrameFinder& kff, AMediaFormat* format)
@@ -60,7 +58,6 @@ static void h265_configureAMediaFormat(KeyFrameFinder& kff, AMediaFormat* format
     AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_HEIGHT, videoWH[1]);
     AMediaFormat_setBuffer(format, "csd-0", buff.data(), buff.size());
     MLOGD << "Video WH:" << videoWH[0] << " H:" << videoWH[1];
-    // writeAndroidPerformanceParams(format);
 }
 
 #endif  // FPVUE_ANDROIDMEDIAFORMATHELPER_H
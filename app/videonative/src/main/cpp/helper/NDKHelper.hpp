@@ -35,6 +35,21 @@ static AAssetManager* getAssetManagerFromContext2(JNIEnv* env, jobject androidCo
     return AAssetManager_fromJava(env, jobject1);
 }
 
+// Absolute path of the app private files directory (Context.getFilesDir())
+static std::string getFilesDir(JNIEnv* env, jobject androidContext)
+{
+    jclass      context_class = env->FindClass("android/content/Context");
+    jmethodID   get_files_dir = env->GetMethodID(context_class, "getFilesDir", "()Ljava/io/File;");
+    jobject     files_dir     = env->CallObjectMethod(androidContext, get_files_dir);
+    jclass      file_class    = env->FindClass("java/io/File");
+    jmethodID   get_path      = env->GetMethodID(file_class, "getAbsolutePath", "()Ljava/lang/String;");
+    auto        path          = (jstring) env->CallObjectMethod(files_dir, get_path);
+    const char* chars         = env->GetStringUTFChars(path, nullptr);
+    std::string ret(chars);
+    env->ReleaseStringUTFChars(path, chars);
+    return ret;
+}
+
 // Returns a java 'InputStream' instance by opening the Asset specified at path
 // If the specified file does not exist, java throws an exception.
 // In this case,the exception is cleared and nullptr is returned
@@ -7,6 +7,7 @@
 
 #include <jni.h>
 
+#ifdef __ANDROID__
 //
 // Workaround for issue https://github.com/android/ndk/issues/1255 and more
 // Java Thread utility methods
@@ -149,7 +150,35 @@ static void setName(pthread_t pthread, const char* name)
     }
 }
 }  // namespace NDKThreadHelper
+#else
+#include <pthread.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstdio>
+
+// Host build: no Java VM, android.os.Process.setThreadPriority() is a nice value on the calling thread's tid,
+// do the same directly. Raising priority (negative values) needs CAP_SYS_NICE, failures are ignored like on device.
+namespace NDKThreadHelper
+{
+static constexpr auto MY_DEFAULT_TAG = "NDKThreadHelper";
+
+static void setProcessThreadPriorityAttachDetach(JavaVM* vm, int wantedPriority, const char* TAG = MY_DEFAULT_TAG)
+{
+    setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), wantedPriority);
+}
+
+static void setName(pthread_t pthread, const char* name)
+{
+    // Linux limits thread names to 15 characters
+    char truncated[16];
+    snprintf(truncated, sizeof(truncated), "%s", name);
+    pthread_setname_np(pthread, truncated);
+}
+}  // namespace NDKThreadHelper
+#endif  // __ANDROID__
 
+#ifdef __ANDROID__
 #include <thread>
 
 namespace NDKTHREADHELPERTEST
@@ -188,5 +217,6 @@ static void test(JNIEnv* env)
     std::thread* thread1 = new std::thread(doSomething2, jvm, -20);
 }
 }  // namespace NDKTHREADHELPERTEST
+#endif  // __ANDROID__
 
 #endif  // FPVUE_NDKTHREAD_H
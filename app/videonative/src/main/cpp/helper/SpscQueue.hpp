@@ -0,0 +1,51 @@
+//
+// Fixed capacity lock-free queue between exactly one producer and one consumer thread.
+//
+
+#ifndef PIXELPILOT_SPSCQUEUE_HPP
+#define PIXELPILOT_SPSCQUEUE_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// For small trivially copyable values (buffer indices and the like), see SpscPacketRing for packets
+template <typename T, std::size_t CAPACITY>
+class SpscQueue
+{
+    static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY must be a power of two");
+
+  public:
+    // Producer only. false if the queue is full
+    bool push(const T& value)
+    {
+        const std::size_t tail = mTail.load(std::memory_order_relaxed);
+        if (tail - mHead.load(std::memory_order_acquire) == CAPACITY) return false;
+        mItems[tail & (CAPACITY - 1)] = value;
+        mTail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only. false if the queue is empty
+    bool pop(T& value)
+    {
+        const std::size_t head = mHead.load(std::memory_order_relaxed);
+        if (head == mTail.load(std::memory_order_acquire)) return false;
+        value = mItems[head & (CAPACITY - 1)];
+        mHead.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const { return mHead.load(std::memory_order_acquire) == mTail.load(std::memory_order_acquire); }
+
+    // Only while neither the producer nor the consumer is active
+    void clear() { mHead.store(mTail.load(std::memory_order_relaxed), std::memory_order_relaxed); }
+
+  private:
+    std::array<T, CAPACITY> mItems{};
+    // Separate cache lines, written by different threads
+    alignas(64) std::atomic<std::size_t> mHead{0};
+    alignas(64) std::atomic<std::size_t> mTail{0};
+};
+
+#endif  // PIXELPILOT_SPSCQUEUE_HPP
@@ -74,6 +74,8 @@ extern "C"
 #define MP4_OBJECT_TYPE_HEVC 0x23
 // http://www.mp4ra.org/object.html 0xC0-E0  && 0xE2 - 0xFE are specified as "user private"
 #define MP4_OBJECT_TYPE_USER_PRIVATE 0xC0
+// Opus audio: 'Opus' sample entry, the dsi (MP4E_set_dsi) is the OpusSpecificBox payload
+#define MP4_OBJECT_TYPE_OPUS 0xAD
 
 /************************************************************************/
 /*          API error codes                                             */
@@ -568,6 +570,10 @@ enum
     BOX_mp4a = FOUR_CHAR_INT('m', 'p', '4', 'a'),  // MPEGAudioSampleEntryAtomType
     BOX_mp4v = FOUR_CHAR_INT('m', 'p', '4', 'v'),  // MPEGVisualSampleEntryAtomType
 
+    // https://opus-codec.org/docs/opus_in_isobmff.html
+    BOX_Opus = FOUR_CHAR_INT('O', 'p', 'u', 's'),
+    BOX_dOps = FOUR_CHAR_INT('d', 'O', 'p', 's'),
+
     // http://www.itscj.ipsj.or.jp/sc29/open/29view/29n7644t.doc
     BOX_avc1 = FOUR_CHAR_INT('a', 'v', 'c', '1'),
     BOX_avc2 = FOUR_CHAR_INT('a', 'v', 'c', '2'),
@@ -1475,7 +1481,29 @@ static int mp4e_flush_index(MP4E_mux_t* mux)
         ATOM_FULL(BOX_stsd, 0);
         WRITE_4(1);  // entry_count;
 
-        if (tr->info.track_media_kind == e_audio || tr->info.track_media_kind == e_private)
+        if (tr->info.track_media_kind == e_audio && tr->info.object_type_indication == MP4_OBJECT_TYPE_OPUS)
+        {
+            ATOM(BOX_Opus);
+            // SampleEntry
+            WRITE_4(0);
+            WRITE_2(0);  // reserved[6]
+            WRITE_2(1);  // data_reference_index
+            // AudioSampleEntry
+            WRITE_4(0);
+            WRITE_4(0);                            // reserved[2]
+            WRITE_2(tr->info.u.a.channelcount);    // channelcount
+            WRITE_2(16);                           // samplesize
+            WRITE_4(0);                            // pre_defined+reserved
+            WRITE_4((tr->info.time_scale << 16));  // samplerate, 48000 for Opus
+            ATOM(BOX_dOps);
+            for (i = 0; i < tr->vsps.bytes - 2; i++)  //  - two bytes size field
+            {
+                WRITE_1(tr->vsps.data[2 + i]);
+            }
+            END_ATOM;
+            END_ATOM;
+        }
+        else if (tr->info.track_media_kind == e_audio || tr->info.track_media_kind == e_private)
         {
             // AudioSampleEntry() assume MP4E_HANDLER_TYPE_SOUN
             if (tr->info.track_media_kind == e_audio)
@@ -0,0 +1,84 @@
+//
+// Groups the NALUs of one picture into one buffer, see AccessUnitAssembler.h
+//
+
+#include "AccessUnitAssembler.h"
+
+#include "../helper/AndroidLogger.hpp"
+
+AccessUnitAssembler::AccessUnitAssembler(NALU_DATA_CALLBACK onNewAccessUnit)
+    : m_cb(std::move(onNewAccessUnit)), m_buffer(std::make_unique<NALU::NALU_BUFFER>())
+{
+}
+
+void AccessUnitAssembler::push(const NALU& nalu)
+{
+    if (m_size > 0 && (nalu.IS_H265_PACKET != m_is_h265 || (m_has_slice && startsNewAccessUnit(nalu))))
+    {
+        flush();
+    }
+    if (m_size + nalu.getSize() > m_buffer->size())
+    {
+        // Rather hand the decoder an incomplete picture in two buffers than drop anything
+        MLOGD << "Access unit too big, splitting it. size:" << m_size << " append:" << nalu.getSize();
+        flush();
+    }
+    if (m_size == 0)
+    {
+        m_creation_time = nalu.creationTime;
+        m_receive_time      = nalu.receiveTime;
+        m_rtp_timestamp     = nalu.rtpTimestamp;
+        m_has_rtp_timestamp = nalu.hasRtpTimestamp;
+        m_is_h265           = nalu.IS_H265_PACKET;
+    }
+    m_size += nalu.copyTo(m_buffer->data() + m_size);
+    m_has_slice |= nalu.isSlice();
+    nNALUs++;
+    if (nalu.endsAccessUnit)
+    {
+        flush();
+    }
+}
+
+void AccessUnitAssembler::flush()
+{
+    if (m_size == 0) return;
+    NALU accessUnit(m_buffer->data(), m_size, m_is_h265, m_creation_time);
+    accessUnit.endsAccessUnit  = true;
+    accessUnit.receiveTime     = m_receive_time;
+    accessUnit.rtpTimestamp    = m_rtp_timestamp;
+    accessUnit.hasRtpTimestamp = m_has_rtp_timestamp;
+    nAccessUnits++;
+    if (m_cb != nullptr)
+    {
+        m_cb(accessUnit);
+    }
+    reset();
+}
+
+void AccessUnitAssembler::reset()
+{
+    m_size      = 0;
+    m_has_slice = false;
+}
+
+bool AccessUnitAssembler::startsNewAccessUnit(const NALU& nalu) const
+{
+    const int nut = nalu.get_nal_unit_type();
+    if (nalu.isSlice())
+    {
+        return nalu.isFirstSliceInPicture();
+    }
+    if (nalu.IS_H265_PACKET)
+    {
+        // VPS, SPS, PPS, AUD, prefix SEI, reserved 41..44, unspecified 48..55
+        return (nut >= NALUnitType::H265::NAL_UNIT_VPS && nut <= NALUnitType::H265::NAL_UNIT_ACCESS_UNIT_DELIMITER) ||
+               nut == NALUnitType::H265::NAL_UNIT_PREFIX_SEI ||
+               (nut >= NALUnitType::H265::NAL_UNIT_RESERVED_NVCL41 &&
+                nut <= NALUnitType::H265::NAL_UNIT_RESERVED_NVCL44) ||
+               (nut >= NALUnitType::H265::NAL_UNIT_UNSPECIFIED_48 && nut <= NALUnitType::H265::NAL_UNIT_UNSPECIFIED_55);
+    }
+    // SEI, SPS, PPS, AUD, prefix NAL, subset SPS, DPS, reserved 17..18
+    return (nut >= NALUnitType::H264::NAL_UNIT_TYPE_SEI && nut <= NALUnitType::H264::NAL_UNIT_TYPE_AUD) ||
+           (nut >= NALUnitType::H264::NAL_UNIT_TYPE_PREFIX_NAL && nut <= 18);
+}
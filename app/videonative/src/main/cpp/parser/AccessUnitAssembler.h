@@ -0,0 +1,57 @@
+//
+// Groups the NALUs of one picture (parameter sets, SEI, all slices) into one buffer, so the decoder gets a single
+// input buffer per frame instead of one per NALU.
+//
+
+#ifndef PIXELPILOT_ACCESSUNITASSEMBLER_H
+#define PIXELPILOT_ACCESSUNITASSEMBLER_H
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+
+#include "../NALU/NALU.hpp"
+
+/**
+ * Access unit boundaries (H.264 7.4.1.2.3, H.265 7.4.2.4.4):
+ * - the NALU carrying the RTP marker bit ends the access unit, which is emitted right away
+ * - without marker bit, an AUD / parameter set / prefix SEI / first slice of a new picture following a slice starts
+ *   a new one, so the previous access unit is only emitted once the next one begins (one frame later)
+ *
+ * The access unit is handed out as one NALU: all NALUs back to back, each with its start code. Its type accessors
+ * describe the first NALU only.
+ */
+class AccessUnitAssembler
+{
+  public:
+    explicit AccessUnitAssembler(NALU_DATA_CALLBACK onNewAccessUnit);
+
+    void push(const NALU& nalu);
+
+    // Emit the access unit assembled so far, if any
+    void flush();
+
+    // Drop the access unit assembled so far
+    void reset();
+
+    bool empty() const { return m_size == 0; }
+
+  public:
+    long nAccessUnits = 0;
+    long nNALUs       = 0;
+
+  private:
+    bool startsNewAccessUnit(const NALU& nalu) const;
+
+    const NALU_DATA_CALLBACK              m_cb;
+    std::unique_ptr<NALU::NALU_BUFFER>    m_buffer;
+    size_t                                m_size              = 0;
+    bool                                  m_has_slice         = false;
+    bool                                  m_is_h265           = false;
+    uint32_t                              m_rtp_timestamp     = 0;
+    bool                                  m_has_rtp_timestamp = false;
+    std::chrono::steady_clock::time_point m_creation_time;
+    std::chrono::steady_clock::time_point m_receive_time;
+};
+
+#endif  // PIXELPILOT_ACCESSUNITASSEMBLER_H
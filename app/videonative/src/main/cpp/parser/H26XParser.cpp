@@ -8,36 +8,47 @@
 #include <cstring>
 #include <thread>
 
-H26XParser::H26XParser(NALU_DATA_CALLBACK onNewNALU)
+H26XParser::H26XParser(
+    NALU_DATA_CALLBACK onNewNALU, NALU_DATA_CALLBACK onNewAccessUnit, KEYFRAME_REQUEST_CALLBACK onKeyframeNeeded)
     : onNewNALU(std::move(onNewNALU)),
       mDecodeRTP(std::bind(
           &H26XParser::onNewNaluDataExtracted,
           this,
           std::placeholders::_1,
           std::placeholders::_2,
-          std::placeholders::_3))
+          std::placeholders::_3),
+      std::bind(&H26XParser::onNewNaluFragmentsExtracted, this, std::placeholders::_1, std::placeholders::_2)),
+      mAccessUnitAssembler(std::move(onNewAccessUnit)),
+      mLossTracker(std::move(onKeyframeNeeded))
 {
 }
 
 void H26XParser::reset()
 {
     mDecodeRTP.reset();
+    mAccessUnitAssembler.reset();
+    mLossTracker.reset();
+    mNLostPacketsSeen          = mDecodeRTP.m_n_lost_packets;
     nParsedNALUs               = 0;
     nParsedKonfigurationFrames = 0;
 }
 
-void H26XParser::parse_rtp_stream(const uint8_t* rtp_data, const size_t data_length)
+void H26XParser::parse_rtp_stream(
+    const uint8_t*                              rtp_data,
+    const size_t                                data_length,
+    const bool                                  packet_stays_valid,
+    const std::chrono::steady_clock::time_point rx_time)
 {
     const RTP::RTPPacket rtpPacket(rtp_data, data_length);
     if (rtpPacket.header.payload == RTP_PAYLOAD_TYPE_H264)
     {
         IS_H265 = false;
-        mDecodeRTP.parseRTPH264toNALU(rtp_data, data_length);
+        mDecodeRTP.parseRTPH264toNALU(rtp_data, data_length, packet_stays_valid, rx_time);
     }
     else if (rtpPacket.header.payload == RTP_PAYLOAD_TYPE_H265)
     {
         IS_H265 = true;
-        mDecodeRTP.parseRTPH265toNALU(rtp_data, data_length);
+        mDecodeRTP.parseRTPH265toNALU(rtp_data, data_length, packet_stays_valid, rx_time);
     }
 }
 
@@ -45,14 +56,45 @@ void H26XParser::onNewNaluDataExtracted(
     const std::chrono::steady_clock::time_point creation_time, const uint8_t* nalu_data, const int nalu_data_size)
 {
     NALU nalu(nalu_data, nalu_data_size, IS_H265, creation_time);
+    nalu.endsAccessUnit  = mDecodeRTP.m_nalu_ends_access_unit;
+    nalu.receiveTime     = mDecodeRTP.m_nalu_rx_time;
+    nalu.rtpTimestamp    = mDecodeRTP.m_nalu_rtp_timestamp;
+    nalu.hasRtpTimestamp = true;
+    newNaluExtracted(nalu);
+}
+
+void H26XParser::onNewNaluFragmentsExtracted(
+    const std::chrono::steady_clock::time_point creation_time, const NALUFragments& fragments)
+{
+    NALU nalu(fragments, IS_H265, creation_time);
+    nalu.endsAccessUnit  = mDecodeRTP.m_nalu_ends_access_unit;
+    nalu.receiveTime     = mDecodeRTP.m_nalu_rx_time;
+    nalu.rtpTimestamp    = mDecodeRTP.m_nalu_rtp_timestamp;
+    nalu.hasRtpTimestamp = true;
     newNaluExtracted(nalu);
 }
 
 void H26XParser::newNaluExtracted(const NALU& nalu)
 {
-    if (onNewNALU != nullptr)
+    if (mDecodeRTP.m_n_lost_packets != mNLostPacketsSeen)
+    {
+        mLossTracker.onPacketsLost(mDecodeRTP.m_n_lost_packets - mNLostPacketsSeen);
+        mNLostPacketsSeen = mDecodeRTP.m_n_lost_packets;
+    }
+    if (mLossTracker.admit(nalu))
     {
-        onNewNALU(nalu);
+        if (onNewNALU != nullptr)
+        {
+            onNewNALU(nalu);
+        }
+        if (mAccessUnitMode)
+        {
+            mAccessUnitAssembler.push(nalu);
+        }
+        else if (!mAccessUnitAssembler.empty())
+        {
+            mAccessUnitAssembler.reset();
+        }
     }
     nParsedNALUs++;
     const bool sps_or_pps = nalu.isSPS() || nalu.isPPS();
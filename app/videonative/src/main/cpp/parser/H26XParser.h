@@ -5,6 +5,7 @@
 #ifndef FPV_VR_PARSE2H264RAW_H
 #define FPV_VR_PARSE2H264RAW_H
 
+#include <atomic>
 #include <functional>
 #include <sstream>
 
@@ -14,11 +15,16 @@
  * 2) raw packets (h264/h265)
  * Output:
  * NAL units in the onNewNalu callback, one after another
+ * In access unit mode additionally whole pictures in the onNewAccessUnit callback, see AccessUnitAssembler
+ * Packet loss is followed by a LossTracker, which may hold back damaged pictures and asks for a keyframe via
+ * onKeyframeNeeded
  */
 //
 
 #include "../NALU/NALU.hpp"
 
+#include "AccessUnitAssembler.h"
+#include "LossTracker.h"
 #include "ParseRTP.h"
 
 //
@@ -28,9 +34,25 @@
 class H26XParser
 {
   public:
-    H26XParser(NALU_DATA_CALLBACK onNewNALU);
-
-    void parse_rtp_stream(const uint8_t* rtp_data, const size_t data_len);
+    H26XParser(
+        NALU_DATA_CALLBACK        onNewNALU,
+        NALU_DATA_CALLBACK        onNewAccessUnit  = nullptr,
+        KEYFRAME_REQUEST_CALLBACK onKeyframeNeeded = nullptr);
+
+    // packet_stays_valid: the caller keeps rtp_data alive and unmodified until holdsPacketReferences() returns false.
+    // Fragmented NALUs are then handed out as a list of references into the packets (zero-copy assembly) and only
+    // gathered once by the consumer, see NALU::copyTo().
+    // rx_time: when the packet was received by the socket / radio (NALU::receiveTime), now if unknown
+    void parse_rtp_stream(
+        const uint8_t*                        rtp_data,
+        const size_t                          data_len,
+        bool                                  packet_stays_valid = false,
+        std::chrono::steady_clock::time_point rx_time            = {});
+
+    bool holdsPacketReferences() const { return mDecodeRTP.holdsPacketReferences(); }
+
+    // Copy whatever is still referenced, e.g. before the caller has to recycle packet buffers
+    void releasePacketReferences() { mDecodeRTP.releasePacketReferences(); }
 
     void reset();
 
@@ -41,18 +63,39 @@ class H26XParser
     // For live video set to -1 (no fps limitation), else additional latency will be generated
     void setLimitFPS(int maxFPS);
 
+    // Assemble access units for onNewAccessUnit (after each NALU was passed to onNewNALU). May be called from any
+    // thread, takes effect with the next NALU.
+    void setAccessUnitMode(bool enable) { mAccessUnitMode = enable; }
+
+    const AccessUnitAssembler& getAccessUnitAssembler() const { return mAccessUnitAssembler; }
+
+    // What to do with pictures depending on lost data. May be called from any thread.
+    void setLossPolicy(LossTracker::Policy policy) { mLossTracker.setPolicy(policy); }
+
+    const LossTracker& getLossTracker() const { return mLossTracker; }
+
   private:
     void newNaluExtracted(const NALU& nalu);
 
     void onNewNaluDataExtracted(
         const std::chrono::steady_clock::time_point creation_time, const uint8_t* nalu_data, const int nalu_data_size);
 
+    void onNewNaluFragmentsExtracted(
+        const std::chrono::steady_clock::time_point creation_time, const NALUFragments& fragments);
+
     const NALU_DATA_CALLBACK              onNewNALU;
     std::chrono::steady_clock::time_point lastFrameLimitFPS       = std::chrono::steady_clock::now();
     std::chrono::steady_clock::time_point lastTimeOnNewNALUCalled = std::chrono::steady_clock::now();
 
     RTPDecoder mDecodeRTP;
 
+    std::atomic<bool>   mAccessUnitMode{false};
+    AccessUnitAssembler mAccessUnitAssembler;
+
+    LossTracker mLossTracker;
+    // RTPDecoder::m_n_lost_packets already reported to the loss tracker
+    int mNLostPacketsSeen = 0;
+
     int  maxFPS  = 0;
     bool IS_H265 = false;
     // First time a NALU was succesfully decoded
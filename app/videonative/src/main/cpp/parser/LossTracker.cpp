@@ -0,0 +1,93 @@
+//
+// Loss tracking and keyframe requests, see LossTracker.h
+//
+
+#include "LossTracker.h"
+
+#include "../helper/AndroidLogger.hpp"
+
+LossTracker::LossTracker(KEYFRAME_REQUEST_CALLBACK onKeyframeNeeded) : m_onKeyframeNeeded(std::move(onKeyframeNeeded))
+{
+}
+
+void LossTracker::onPacketsLost(const int n_lost_packets)
+{
+    nLostPackets += n_lost_packets;
+    m_loss_pending = true;
+}
+
+bool LossTracker::admit(const NALU& nalu)
+{
+    const bool slice          = nalu.isSlice();
+    const bool first_slice    = slice && nalu.isFirstSliceInPicture();
+    const bool keyframe_start = first_slice && nalu.isIRAPSlice();
+    if (first_slice) m_n_pictures++;
+
+    if (m_loss_pending)
+    {
+        m_loss_pending = false;
+        // Lost right in front of a keyframe: only pictures before it are affected, and it replaces them all
+        if (!keyframe_start)
+        {
+            nDamagedPictures++;
+            if (!m_damaged)
+            {
+                m_damaged               = true;
+                m_damaged_since         = nalu.creationTime;
+                m_damaged_since_picture = m_n_pictures;
+                MLOGD << "Loss in picture " << m_n_pictures << ", damaged until the next keyframe";
+                requestKeyframe(nalu.creationTime);
+            }
+        }
+    }
+
+    if (m_damaged)
+    {
+        if (keyframe_start)
+        {
+            m_damaged   = false;
+            m_skip_rasl = nalu.IS_H265_PACKET;
+            nRecoveries++;
+            MLOGD << "Recovered after " << (m_n_pictures - m_damaged_since_picture) << " pictures, "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(nalu.creationTime - m_damaged_since).count()
+                  << "ms";
+        }
+        else if (nalu.creationTime - m_last_request >= KEYFRAME_REQUEST_INTERVAL)
+        {
+            requestKeyframe(nalu.creationTime);
+        }
+    }
+
+    if (!slice || m_policy.load() != Policy::DROP_UNTIL_KEYFRAME)
+    {
+        return true;
+    }
+    if (m_skip_rasl && first_slice && !nalu.isIRAPSlice() && !nalu.isRASLSlice())
+    {
+        // First trailing picture, the leading pictures of the CRA are done
+        m_skip_rasl = false;
+    }
+    if (m_damaged || (m_skip_rasl && nalu.isRASLSlice()))
+    {
+        nDroppedNALUs++;
+        return false;
+    }
+    return true;
+}
+
+void LossTracker::reset()
+{
+    m_loss_pending = false;
+    m_damaged      = false;
+    m_skip_rasl    = false;
+}
+
+void LossTracker::requestKeyframe(const std::chrono::steady_clock::time_point now)
+{
+    m_last_request = now;
+    nKeyframeRequests++;
+    if (m_onKeyframeNeeded != nullptr)
+    {
+        m_onKeyframeNeeded();
+    }
+}
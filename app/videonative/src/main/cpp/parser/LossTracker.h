@@ -0,0 +1,79 @@
+//
+// Follows RTP packet loss through the NALU stream: which picture got damaged, whether the pictures after it can still
+// be trusted, and when a new keyframe is needed to recover.
+//
+
+#ifndef PIXELPILOT_LOSSTRACKER_H
+#define PIXELPILOT_LOSSTRACKER_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+
+#include "../NALU/NALU.hpp"
+
+typedef std::function<void()> KEYFRAME_REQUEST_CALLBACK;
+
+/**
+ * A lost packet damages the picture it belonged to, and every following picture up to the next random access point
+ * (h264 IDR, h265 IRAP) may reference it. Until that keyframe arrives the stream is "damaged".
+ *
+ * While damaged, slices are either
+ * - forwarded (FORWARD, default): the decoder conceals what it can, smearing until the keyframe,
+ * - dropped (DROP_UNTIL_KEYFRAME): the last good picture stays on screen until the keyframe. Parameter sets and SEI
+ *   are still forwarded. After recovering at a CRA, its RASL pictures are dropped as well.
+ *
+ * With both policies the keyframe request callback fires when the stream becomes damaged, and again every
+ * KEYFRAME_REQUEST_INTERVAL while it stays damaged (the request may get lost on the way to the air unit).
+ */
+class LossTracker
+{
+  public:
+    enum class Policy
+    {
+        FORWARD             = 0,
+        DROP_UNTIL_KEYFRAME = 1
+    };
+
+    static constexpr std::chrono::milliseconds KEYFRAME_REQUEST_INTERVAL{500};
+
+    explicit LossTracker(KEYFRAME_REQUEST_CALLBACK onKeyframeNeeded);
+
+    // May be called from any thread, takes effect with the next NALU
+    void setPolicy(Policy policy) { m_policy = policy; }
+
+    // n_lost_packets went missing right before the next NALU
+    void onPacketsLost(int n_lost_packets);
+
+    // Returns false if the NALU must not be forwarded to the decoder
+    bool admit(const NALU& nalu);
+
+    void reset();
+
+    bool isDamaged() const { return m_damaged; }
+
+  public:
+    long nLostPackets      = 0;
+    long nDamagedPictures  = 0;
+    long nDroppedNALUs     = 0;
+    long nKeyframeRequests = 0;
+    long nRecoveries       = 0;
+
+  private:
+    void requestKeyframe(std::chrono::steady_clock::time_point now);
+
+    const KEYFRAME_REQUEST_CALLBACK m_onKeyframeNeeded;
+    std::atomic<Policy>             m_policy{Policy::FORWARD};
+    // Loss reported, not yet attributed to a picture
+    bool m_loss_pending = false;
+    bool m_damaged      = false;
+    // Recovered at a CRA, its RASL pictures still reference the damaged ones
+    bool m_skip_rasl = false;
+    // Pictures seen so far (first slices), to tell which one was damaged
+    long                                  m_n_pictures            = 0;
+    long                                  m_damaged_since_picture = 0;
+    std::chrono::steady_clock::time_point m_damaged_since         = {};
+    std::chrono::steady_clock::time_point m_last_request          = {};
+};
+
+#endif  // PIXELPILOT_LOSSTRACKER_H
@@ -3,6 +3,7 @@
 //
 
 #include "ParseRTP.h"
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 #include "../helper/AndroidLogger.hpp"
@@ -29,14 +30,15 @@ static int diff_between_packets(int last_packet, int curr_packet)
     }
 }
 
-RTPDecoder::RTPDecoder(RTP_FRAME_DATA_CALLBACK cb, bool feed_incomplete_frames)
-    : m_cb(std::move(cb)), m_feed_incomplete_frames(feed_incomplete_frames)
+RTPDecoder::RTPDecoder(
+    RTP_FRAME_DATA_CALLBACK cb, RTP_FRAGMENTED_NALU_CALLBACK fragments_cb, bool feed_incomplete_frames)
+    : m_cb(std::move(cb)), m_fragments_cb(std::move(fragments_cb)), m_feed_incomplete_frames(feed_incomplete_frames)
 {
 }
 
 void RTPDecoder::reset()
 {
-    m_nalu_data_length       = 0;
+    clear_nalu();
     lastSequenceNumber       = -1;
     flagPacketHasGoneMissing = false;
     m_n_gaps                 = 0;
@@ -76,8 +78,7 @@ bool RTPDecoder::validateRTPPacket(const rtp_header_t& rtp_header)
             // Diff:"<<(seqNr-(int)lastSequenceNumber)<<" total:"<<m_n_gaps;
             flagPacketHasGoneMissing = true;
             m_n_gaps++;
-            const auto gap_size = seqNr - (int) lastSequenceNumber;
-            m_n_lost_packets += gap_size;
+            m_n_lost_packets += curr_packet_diff - 1;
             // Feed it anyways (buggy / hacky)
             if (m_feed_incomplete_frames)
             {
@@ -94,7 +95,7 @@ void RTPDecoder::h264_reconstruct_and_forward_one_nalu(const uint8_t* data, cons
 {
     assert(data_size > sizeof(nalu_header_t));
     const nalu_header_t& nalu_header = *(const nalu_header_t*) &data[0];
-    timePointStartOfReceivingNALU    = std::chrono::steady_clock::now();
+    mark_nalu_start();
     // Full NALU - we can remove the 'drop packet' flag
     if (flagPacketHasGoneMissing)
     {
@@ -106,15 +107,21 @@ void RTPDecoder::h264_reconstruct_and_forward_one_nalu(const uint8_t* data, cons
     // write the reconstructed NAL header (the h264 "type")
     append_nalu_data_byte(h264_nal_header);
     // write the rest of the data
-    append_nalu_data(&data[1], (size_t) data_size - 1);
+    append_nalu_payload(&data[1], (size_t) data_size - 1);
     // forward via callback
     forwardNALU();
     // reset length after forwarding
-    m_nalu_data_length = 0;
+    clear_nalu();
 }
 
-void RTPDecoder::parseRTPH264toNALU(const uint8_t* rtp_data, const size_t data_length)
+void RTPDecoder::parseRTPH264toNALU(
+    const uint8_t*                              rtp_data,
+    const size_t                                data_length,
+    const bool                                  packet_stays_valid,
+    const std::chrono::steady_clock::time_point rx_time)
 {
+    m_reference_current_packet = packet_stays_valid && m_fragments_cb != nullptr;
+    m_curr_packet_rx_time      = rx_time;
     // 12 rtp header bytes and 1 nalu_header_t type byte
     if (data_length <= sizeof(rtp_header_t) + sizeof(nalu_header_t))
     {
@@ -135,6 +142,8 @@ void RTPDecoder::parseRTPH264toNALU(const uint8_t* rtp_data, const size_t data_l
     {
         return;
     }
+    m_curr_packet_marker    = rtpPacket.header.marker;
+    m_curr_packet_timestamp = rtpPacket.header.getTimestamp();
     const auto& nalu_header = rtpPacket.getNALUHeaderH264();
     if (nalu_header.type == 28)
     { /* FU-A */
@@ -146,7 +155,7 @@ void RTPDecoder::parseRTPH264toNALU(const uint8_t* rtp_data, const size_t data_l
         {
             // MLOGD<<"End of fu-a";
             //  end of fu-a
-            append_nalu_data(fu_payload, fu_payload_size);
+            append_nalu_payload(fu_payload, fu_payload_size);
             if (!flagPacketHasGoneMissing)
             {
                 // To better measure latency we can actually use the timestamp from when the first bytes for this packet
@@ -156,12 +165,12 @@ void RTPDecoder::parseRTPH264toNALU(const uint8_t* rtp_data, const size_t data_l
             m_total_n_fragments_for_current_fu++;
             // MLOGD<<"N fragments for this fu:"<<m_total_n_fragments_for_current_fu;
             m_total_n_fragments_for_current_fu = 0;
-            m_nalu_data_length                 = 0;
+            clear_nalu();
         }
         else if (fu_header.s == 1)
         {
             // MLOGD<<"Start of fu-a";
-            timePointStartOfReceivingNALU      = std::chrono::steady_clock::now();
+            mark_nalu_start();
             m_total_n_fragments_for_current_fu = 0;
             // Beginning of new fu sequence - we can remove the 'drop packet' flag
             if (flagPacketHasGoneMissing)
@@ -174,7 +183,7 @@ void RTPDecoder::parseRTPH264toNALU(const uint8_t* rtp_data, const size_t data_l
             const uint8_t h264_nal_header =
                 (uint8_t) (fu_header.type & 0x1f) | (nalu_header.nri << 5) | (nalu_header.f << 7);
             append_nalu_data_byte(h264_nal_header);
-            append_nalu_data(fu_payload, fu_payload_size);
+            append_nalu_payload(fu_payload, fu_payload_size);
         }
         else
         {
@@ -186,7 +195,7 @@ void RTPDecoder::parseRTPH264toNALU(const uint8_t* rtp_data, const size_t data_l
                 //m_nalu_data_length+=(curr_packet_diff-1)*1024;
                 append_empty((curr_packet_diff-1)*1024);
             }*/
-            append_nalu_data(fu_payload, fu_payload_size);
+            append_nalu_payload(fu_payload, fu_payload_size);
             m_total_n_fragments_for_current_fu++;
         }
     }
@@ -212,6 +221,8 @@ void RTPDecoder::parseRTPH264toNALU(const uint8_t* rtp_data, const size_t data_l
             const uint8_t* actual_nalu_data_p = &rtp_payload[offset + 1 + 2];
             const auto     actual_nalu_size   = nalu_size;
             // MLOGD<<"XNALU of size:"<<(int)actual_nalu_size;
+            m_curr_packet_marker =
+                rtpPacket.header.marker && !(rtp_payload_size > offset + 2 + actual_nalu_size + 3);
             h264_reconstruct_and_forward_one_nalu(actual_nalu_data_p, actual_nalu_size);
             offset += 2 + actual_nalu_size;
             if (!(rtp_payload_size > offset + 3))
@@ -234,7 +245,7 @@ void RTPDecoder::parseRTPH264toNALU(const uint8_t* rtp_data, const size_t data_l
 
 void RTPDecoder::h265_forward_one_nalu(const uint8_t* data, int data_size, bool write_4_bytes_for_start_code)
 {
-    timePointStartOfReceivingNALU = std::chrono::steady_clock::now();
+    mark_nalu_start();
     if (flagPacketHasGoneMissing)
     {
         // MLOGD<<"Got full NALU - clearing missing packet flag";
@@ -243,13 +254,22 @@ void RTPDecoder::h265_forward_one_nalu(const uint8_t* data, int data_size, bool
     write_h264_h265_nalu_start(write_4_bytes_for_start_code);
     // I do not know what about the 'DONL' field but it seems to be never present
     // copy the NALU header and NALU data, other than h264 here nothing has to be 'reconstructed'
-    append_nalu_data(data, data_size);
+    // (the header always goes into our buffer, so the first fragment holds the whole start code + header)
+    const int header_size = std::min(data_size, (int) sizeof(nal_unit_header_h265_t));
+    append_nalu_data(data, header_size);
+    append_nalu_payload(data + header_size, data_size - header_size);
     forwardNALU(true);
-    m_nalu_data_length = 0;
+    clear_nalu();
 }
 
-void RTPDecoder::parseRTPH265toNALU(const uint8_t* rtp_data, const size_t data_length)
+void RTPDecoder::parseRTPH265toNALU(
+    const uint8_t*                              rtp_data,
+    const size_t                                data_length,
+    const bool                                  packet_stays_valid,
+    const std::chrono::steady_clock::time_point rx_time)
 {
+    m_reference_current_packet = packet_stays_valid && m_fragments_cb != nullptr;
+    m_curr_packet_rx_time      = rx_time;
     // 12 rtp header bytes and 1 nalu_header_t type byte
     if (data_length <= sizeof(rtp_header_t) + sizeof(nal_unit_header_h265_t))
     {
@@ -264,6 +284,8 @@ void RTPDecoder::parseRTPH265toNALU(const uint8_t* rtp_data, const size_t data_l
         MLOGD << "Invalid rtp packet";
         return;
     }
+    m_curr_packet_marker             = rtpPacket.header.marker;
+    m_curr_packet_timestamp          = rtpPacket.header.getTimestamp();
     const auto& nal_unit_header_h265 = rtpPacket.getNALUHeaderH265();
     if (nal_unit_header_h265.type > 50)
     {
@@ -289,6 +311,8 @@ void RTPDecoder::parseRTPH265toNALU(const uint8_t* rtp_data, const size_t data_l
             const uint8_t* actual_nalu_data_p = &rtp_payload[offset + don_offset + 1 + 2];
             const auto     actual_nalu_size   = nalu_size;
             // MLOGD<<"XNALU of size:"<<(int)actual_nalu_size;
+            m_curr_packet_marker =
+                rtpPacket.header.marker && !(rtp_payload_size > offset + 2 + actual_nalu_size + 3);
             h265_forward_one_nalu(actual_nalu_data_p, actual_nalu_size);
             offset += 2 + actual_nalu_size;
             if (!(rtp_payload_size > offset + 3))
@@ -308,15 +332,15 @@ void RTPDecoder::parseRTPH265toNALU(const uint8_t* rtp_data, const size_t data_l
         if (fu_header.e)
         {
             // MLOGD<<"end of fu packetization";
-            append_nalu_data(fu_payload, fu_payload_size);
+            append_nalu_payload(fu_payload, fu_payload_size);
             forwardNALU(true);
-            m_nalu_data_length = 0;
+            clear_nalu();
         }
         else if (fu_header.s)
         {
             // MLOGD<<"start of fu packetization";
             // MLOGD<<"Bytes "<<StringHelper::vectorAsString(std::vector<uint8_t>(rtp_data,rtp_data+data_length));
-            timePointStartOfReceivingNALU = std::chrono::steady_clock::now();
+            mark_nalu_start();
             if (flagPacketHasGoneMissing)
             {
                 //                MLOGD << "Got fu-a start - clearing missing packet flag";
@@ -331,12 +355,12 @@ void RTPDecoder::parseRTPH265toNALU(const uint8_t* rtp_data, const size_t data_l
             append_nalu_data_byte(tmp_unknown);
             append_nalu_data_byte(ptr[1]);
             // copy the rest of the data
-            append_nalu_data(fu_payload, fu_payload_size);
+            append_nalu_payload(fu_payload, fu_payload_size);
         }
         else
         {
             // MLOGD<<"middle of fu packetization";
-            append_nalu_data(fu_payload, fu_payload_size);
+            append_nalu_payload(fu_payload, fu_payload_size);
         }
     }
     else
@@ -365,6 +389,17 @@ void RTPDecoder::parse_rtp_mjpeg(const uint8_t* rtp_data, const size_t data_leng
 
 void RTPDecoder::forwardNALU(const bool isH265)
 {
+    m_nalu_ends_access_unit = m_curr_packet_marker;
+    if (!m_fragments.empty())
+    {
+        // Same sanity check as below, the first fragment holds the start code and header
+        if (check_has_valid_prefix(m_fragments[0].data, (int) m_fragments[0].size, true))
+        {
+            m_fragments_cb(timePointStartOfReceivingNALU, m_fragments);
+        }
+        clear_nalu();
+        return;
+    }
     if (m_cb != nullptr)
     {
         // if either the rtp encoder is buggy or the premise of increasing sequence numbers is not given, this
@@ -391,6 +426,57 @@ void RTPDecoder::append_nalu_data(const uint8_t* data, size_t data_len)
     m_nalu_data_length += data_len;
 }
 
+void RTPDecoder::append_nalu_payload(const uint8_t* data, size_t data_len)
+{
+    if (!m_reference_current_packet)
+    {
+        // Continue by copying, everything referenced so far has to be copied first
+        releasePacketReferences();
+        append_nalu_data(data, data_len);
+        return;
+    }
+    const size_t curr_size = m_fragments.empty() ? m_nalu_data_length : m_fragments.size();
+    if (curr_size + data_len > m_curr_nalu.size())
+    {
+        MLOGD << "Weird - not enough space to write NALU. curr_size:" << curr_size << " append:" << data_len;
+        return;
+    }
+    if (m_fragments.empty() && m_nalu_data_length > 0)
+    {
+        // Whatever was written into our buffer so far (start code, header) becomes the first fragment
+        m_fragments.append(m_curr_nalu.data(), m_nalu_data_length);
+    }
+    if (!m_fragments.append(data, data_len))
+    {
+        // Out of fragments - gather, then start a new list behind the gathered data
+        releasePacketReferences();
+        m_fragments.append(m_curr_nalu.data(), m_nalu_data_length);
+        m_fragments.append(data, data_len);
+    }
+}
+
+void RTPDecoder::releasePacketReferences()
+{
+    if (m_fragments.empty()) return;
+    m_nalu_data_length = m_fragments.copyTo(m_curr_nalu.data());
+    m_fragments.clear();
+}
+
+void RTPDecoder::clear_nalu()
+{
+    m_nalu_data_length = 0;
+    m_fragments.clear();
+}
+
+void RTPDecoder::mark_nalu_start()
+{
+    timePointStartOfReceivingNALU = std::chrono::steady_clock::now();
+    m_nalu_rx_time                = m_curr_packet_rx_time == std::chrono::steady_clock::time_point{}
+                                        ? timePointStartOfReceivingNALU
+                                        : m_curr_packet_rx_time;
+    m_nalu_rtp_timestamp          = m_curr_packet_timestamp;
+}
+
 void RTPDecoder::append_nalu_data_byte(uint8_t byte)
 {
     append_nalu_data(&byte, 1);
@@ -411,7 +497,7 @@ void RTPDecoder::append_empty(size_t data_len)
 void RTPDecoder::write_h264_h265_nalu_start(const bool use_4_bytes)
 {
     // m_curr_nalu=std::make_shared<std::array<uint8_t,NALU_MAXLEN>>();
-    m_nalu_data_length = 0;
+    clear_nalu();
     if (use_4_bytes)
     {
         append_nalu_data_byte(0);
@@ -9,6 +9,7 @@
 #include <chrono>
 #include <cstdio>
 #include <functional>
+#include "../NALU/NALUFragments.hpp"
 #include "RTP.hpp"
 
 /*********************************************
@@ -19,6 +20,8 @@
  ** No special dependencies other than std library.
  ** R.n Supports single, aggregated and fragmented rtp packets for both h264 and h265.
  ** Data is forwarded directly via a callback for no thread scheduling overhead
+ ** Packets the caller promises to keep alive (packet_stays_valid) are not copied: their payloads are referenced in a
+ ** NALUFragments list, which is forwarded via the second callback instead.
  **********************************************/
 
 // Enough for pretty much any resolution/framerate we handle in OpenHD
@@ -28,12 +31,19 @@ typedef std::function<void(
     const std::chrono::steady_clock::time_point creation_time, const uint8_t* nalu_data, const int nalu_data_size)>
     RTP_FRAME_DATA_CALLBACK;
 
+typedef std::function<void(const std::chrono::steady_clock::time_point creation_time, const NALUFragments& fragments)>
+    RTP_FRAGMENTED_NALU_CALLBACK;
+
 class RTPDecoder
 {
   public:
     // NALUs are passed on via the callback, one by one.
     // (Each time the callback is called, it contains exactly one NALU prefixed with the 0,0,0,1 start code)
-    RTPDecoder(RTP_FRAME_DATA_CALLBACK cb, bool feed_incomplete_frames = false);
+    // NALUs assembled from packets that stay valid go to fragments_cb instead, if set.
+    RTPDecoder(
+        RTP_FRAME_DATA_CALLBACK      cb,
+        RTP_FRAGMENTED_NALU_CALLBACK fragments_cb           = nullptr,
+        bool                         feed_incomplete_frames = false);
 
     // check if a packet is missing by using the rtp sequence number and
     // if the payload is dynamic (h264 or h265)
@@ -42,10 +52,27 @@ class RTPDecoder
     bool validateRTPPacket(const rtp_header_t& rtpHeader);
 
     // parse rtp h264 packet to NALU
-    void parseRTPH264toNALU(const uint8_t* rtp_data, const size_t data_length);
+    // packet_stays_valid: rtp_data is kept alive and unmodified by the caller until holdsPacketReferences() is false
+    // rx_time: when the packet hit the socket / radio, now if unknown
+    void parseRTPH264toNALU(
+        const uint8_t*                        rtp_data,
+        const size_t                          data_length,
+        bool                                  packet_stays_valid = false,
+        std::chrono::steady_clock::time_point rx_time            = {});
 
     // parse rtp h265 packet to NALU
-    void parseRTPH265toNALU(const uint8_t* rtp_data, const size_t data_length);
+    void parseRTPH265toNALU(
+        const uint8_t*                        rtp_data,
+        const size_t                          data_length,
+        bool                                  packet_stays_valid = false,
+        std::chrono::steady_clock::time_point rx_time            = {});
+
+    // true while the NALU being assembled references packets passed with packet_stays_valid
+    bool holdsPacketReferences() const { return !m_fragments.empty(); }
+
+    // copy the referenced packet data of the NALU being assembled into our own buffer, so the caller can recycle
+    // the packets
+    void releasePacketReferences();
 
     // exp
     void parse_rtp_mjpeg(const uint8_t* rtp_data, const size_t data_length);
@@ -66,14 +93,30 @@ class RTPDecoder
 
     void append_empty(size_t data_len);
 
+    // append NALU payload (as opposed to the start code / reconstructed header): referenced if the current packet
+    // stays valid, copied otherwise
+    void append_nalu_payload(const uint8_t* data, size_t data_len);
+
+    // drop the NALU being assembled
+    void clear_nalu();
+
+    // A new NALU starts in the current packet
+    void mark_nalu_start();
+
     // Properly calls the cb function (if not null)
     // Resets the m_nalu_data_length to 0
     void forwardNALU(const bool isH265 = false);
 
-    const RTP_FRAME_DATA_CALLBACK m_cb;
+    const RTP_FRAME_DATA_CALLBACK      m_cb;
+    const RTP_FRAGMENTED_NALU_CALLBACK m_fragments_cb;
     // std::shared_ptr<std::array<uint8_t,NALU_MAXLEN>> m_curr_nalu{};
     std::array<uint8_t, NALU_MAXLEN> m_curr_nalu;
     size_t                           m_nalu_data_length = 0;
+    // Zero-copy assembly: the start code / header in m_curr_nalu followed by references into the packets.
+    // Empty while assembling by copy.
+    NALUFragments m_fragments{m_curr_nalu.data()};
+    bool          m_reference_current_packet = false;
+    std::chrono::steady_clock::time_point m_curr_packet_rx_time;
     bool                             m_feed_incomplete_frames;
     int                              m_total_n_fragments_for_current_fu = 0;
 
@@ -89,6 +132,13 @@ class RTPDecoder
     // This time point is as 'early as possible' to debug the parsing time as accurately as possible.
     // E.g for a fu-a NALU the time point when the start fu-a was received, not when its end is received
     std::chrono::steady_clock::time_point timePointStartOfReceivingNALU;
+    // When the first packet of the NALU was received by the socket / radio (before any queueing on our side)
+    std::chrono::steady_clock::time_point m_nalu_rx_time;
+    // Valid during the callback: the NALU is the last one of its access unit (it ended in a packet with the RTP
+    // marker bit set, RFC 6184 5.1 / RFC 7798 4.1)
+    bool m_nalu_ends_access_unit = false;
+    // RTP timestamp (90 kHz) of the packet the NALU started in, the same for all NALUs of one access unit
+    uint32_t m_nalu_rtp_timestamp = 0;
 
   private:
     // reconstruct and forward a single nalu, either from a "single" or "aggregated" rtp packet (not from a fragmented
@@ -110,6 +160,10 @@ class RTPDecoder
     // a non-fragmented rtp packet
     // void clear_missing_packet_flag();
     int curr_packet_diff = 0;
+    // marker bit of the packet being parsed, cleared for all but the last NALU of an aggregation packet
+    bool m_curr_packet_marker = false;
+    // RTP timestamp of the packet being parsed
+    uint32_t m_curr_packet_timestamp = 0;
 
   private:
     std::chrono::steady_clock::time_point m_last_log_wrong_rtp_payload_time = std::chrono::steady_clock::now();
@@ -1,6 +1,7 @@
 #include "BufferedPacketQueue.h"  // the class under test
 #include <gtest/gtest.h>
 #include <cstdint>
+#include <cstring>
 #include <vector>
 
 // ---------- Test fixture ----------------------------------------------------
@@ -25,6 +26,22 @@ class BufferedPacketQueueTest : public ::testing::Test
 
         q.processPacket(seq, (uint8_t*) &dummy, 2, cb);
     }
+
+    /* Helper: feed one packet of the frame with RTP timestamp ts, arriving at nowMs. */
+    void feed(uint16_t seq, uint32_t ts, bool marker, uint64_t nowMs, std::size_t size = 2)
+    {
+        feedTo(q, seq, ts, marker, nowMs, size);
+    }
+
+    void feedTo(BufferedPacketQueue& queue, uint16_t seq, uint32_t ts, bool marker, uint64_t nowMs, std::size_t size = 2)
+    {
+        std::vector<uint8_t> packet(size);
+        std::memcpy(packet.data(), &seq, sizeof(seq));
+
+        auto cb = [this](const uint8_t* data, std::size_t) { delivered.push_back(*(const uint16_t*) data); };
+
+        queue.processPacket(seq, ts, marker, packet.data(), packet.size(), cb, nowMs);
+    }
 };
 
 // ---------- The reproduction test ------------------------------------------
@@ -57,6 +74,150 @@ TEST_F(BufferedPacketQueueTest, ReorderedDeliversInOrder)
     ASSERT_EQ(delivered, expected) << "Overflow flush should deliver the entire block in one shot";
 }
 
+TEST_F(BufferedPacketQueueTest, RingSlotsWrapAround)
+{
+    feed(65533, 1, false, 0);
+    feed(0, 1, false, 0);
+    feed(65535, 1, false, 0);
+    feed(1, 1, false, 0);
+    feed(65534, 1, false, 0);
+    ASSERT_EQ(delivered, (std::vector<uint16_t>{65533, 65534, 65535, 0, 1}));
+    ASSERT_EQ(q.size(), 0u);
+    ASSERT_EQ(q.getStats().reordered, 3u);
+    ASSERT_EQ(q.getStats().lost, 0u);
+}
+
+TEST_F(BufferedPacketQueueTest, GapReleasedAtLatencyDeadline)
+{
+    feed(10, 1, false, 100);
+    feed(12, 1, false, 100);
+    feed(13, 1, false, 110);
+    ASSERT_EQ(delivered, (std::vector<uint16_t>{10})) << "Should wait for 11 before the deadline";
+
+    feed(14, 1, false, 100 + BufferedPacketQueue::DEFAULT_MAX_LATENCY_MS);
+    ASSERT_EQ(delivered, (std::vector<uint16_t>{10, 12, 13, 14}));
+    ASSERT_EQ(q.getStats().deadlineReleases, 1u);
+    ASSERT_EQ(q.getStats().lost, 1u);
+
+    feed(11, 1, false, 130);
+    ASSERT_EQ(delivered, (std::vector<uint16_t>{10, 12, 13, 14})) << "Packets of a released gap come too late";
+    ASSERT_EQ(q.getStats().late, 1u);
+}
+
+TEST_F(BufferedPacketQueueTest, PollReleasesGapWithoutNewPackets)
+{
+    feed(10, 1, false, 100);
+    feed(12, 1, true, 105);
+    ASSERT_EQ(q.nextDeadlineMs(), 105 + BufferedPacketQueue::DEFAULT_MAX_LATENCY_MS);
+
+    auto cb = [this](const uint8_t* data, std::size_t) { delivered.push_back(*(const uint16_t*) data); };
+    q.poll(cb, q.nextDeadlineMs() - 1);
+    ASSERT_EQ(delivered, (std::vector<uint16_t>{10}));
+
+    q.poll(cb, q.nextDeadlineMs());
+    ASSERT_EQ(delivered, (std::vector<uint16_t>{10, 12}));
+    ASSERT_EQ(q.getStats().deadlineReleases, 1u);
+    ASSERT_EQ(q.nextDeadlineMs(), BufferedPacketQueue::NO_DEADLINE);
+}
+
+TEST_F(BufferedPacketQueueTest, CompleteFrameReleasesOlderGap)
+{
+    // Frame 100 lost packet 21, frame 200 (22..24) arrives complete right after
+    feed(20, 100, false, 0);
+    feed(22, 100, true, 0);
+    feed(23, 200, false, 1);
+    ASSERT_EQ(delivered, (std::vector<uint16_t>{20}));
+
+    feed(24, 200, true, 2);
+    ASSERT_EQ(delivered, (std::vector<uint16_t>{20, 22, 23, 24}));
+    ASSERT_EQ(q.getStats().frameReleases, 1u);
+    ASSERT_EQ(q.getStats().deadlineReleases, 0u);
+}
+
+TEST_F(BufferedPacketQueueTest, IncompleteFrameWaitsForDeadline)
+{
+    // The missing packet 31 may belong to frame 200, so its marker alone is no reason to release
+    feed(30, 100, true, 0);
+    feed(32, 200, false, 0);
+    feed(33, 200, true, 1);
+    ASSERT_EQ(delivered, (std::vector<uint16_t>{30}));
+
+    feed(31, 200, false, 2);
+    ASSERT_EQ(delivered, (std::vector<uint16_t>{30, 31, 32, 33}));
+    ASSERT_EQ(q.getStats().lost, 0u);
+}
+
+TEST_F(BufferedPacketQueueTest, GapWiderThanRingIsReleased)
+{
+    BufferedPacketQueue small(1000, 8);
+    feedTo(small, 0, 1, false, 0);
+    feedTo(small, 2, 1, false, 0);
+    feedTo(small, 3, 1, false, 0);
+    feedTo(small, 10, 1, false, 0);
+    ASSERT_EQ(delivered, (std::vector<uint16_t>{0, 2, 3})) << "10 only fits the ring once 1..2 are given up on";
+    ASSERT_EQ(small.size(), 1u);
+
+    feedTo(small, 4, 1, false, 0);
+    feedTo(small, 20, 1, false, 0);
+    ASSERT_EQ(delivered, (std::vector<uint16_t>{0, 2, 3, 4, 10}));
+    ASSERT_EQ(small.getStats().overflowReleases, 2u);
+}
+
+TEST_F(BufferedPacketQueueTest, DuplicatesAreDropped)
+{
+    feed(40, 1, false, 0);
+    feed(42, 1, false, 0);
+    feed(42, 1, false, 0);
+    feed(41, 1, false, 0);
+    feed(41, 1, false, 0);
+    ASSERT_EQ(delivered, (std::vector<uint16_t>{40, 41, 42}));
+    ASSERT_EQ(q.getStats().duplicates, 1u);
+    ASSERT_EQ(q.getStats().late, 1u);
+}
+
+TEST_F(BufferedPacketQueueTest, OversizedPacketIsNotHeldBack)
+{
+    feed(50, 1, false, 0);
+    feed(52, 1, false, 0);
+    feed(53, 1, false, 0, BufferedPacketQueue::SLOT_SIZE + 1);
+    ASSERT_EQ(delivered, (std::vector<uint16_t>{50, 52, 53}));
+    ASSERT_EQ(q.size(), 0u);
+}
+
+TEST_F(BufferedPacketQueueTest, SequenceRestartFlushes)
+{
+    feed(5000, 1, false, 0);
+    feed(5002, 1, false, 0);
+    feed(7, 1, false, 0);
+    feed(8, 1, false, 0);
+    ASSERT_EQ(delivered, (std::vector<uint16_t>{5000, 5002, 7, 8}));
+}
+
+TEST_F(BufferedPacketQueueTest, ReorderedPacketsKeepTheirReceiveTime)
+{
+    using TimePoint = BufferedPacketQueue::TimePoint;
+    std::vector<TimePoint> rxTimes;
+    auto                   cb = [&](const uint8_t* data, std::size_t, TimePoint rxTime)
+    {
+        delivered.push_back(*(const uint16_t*) data);
+        rxTimes.push_back(rxTime);
+    };
+    const auto feedAt = [&](uint16_t seq, bool marker, int rxMs)
+    {
+        const TimePoint rxTime{std::chrono::milliseconds(rxMs)};
+        q.processPacket(seq, 1, marker, (const uint8_t*) &seq, sizeof(seq), cb, 0, rxTime);
+    };
+    feedAt(10, false, 1);
+    feedAt(12, true, 3);
+    feedAt(11, false, 2);
+    ASSERT_EQ(delivered, (std::vector<uint16_t>{10, 11, 12}));
+    const std::vector<TimePoint> expected{
+        TimePoint(std::chrono::milliseconds(1)),
+        TimePoint(std::chrono::milliseconds(2)),
+        TimePoint(std::chrono::milliseconds(3))};
+    ASSERT_EQ(rxTimes, expected);
+}
+
 // ---------- gtest boilerplate main -----------------------------------------
 int main(int argc, char** argv)
 {
@@ -0,0 +1,259 @@
+#include "DvrArena.h"  // the class under test
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <thread>
+#include <vector>
+
+// ---------- Allocation counter -----------------------------------------------
+static std::atomic<long> gAllocations{0};
+
+void* operator new(std::size_t size)
+{
+    gAllocations++;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+/* Helper: every field set, the arena doesn't care about the receive time. */
+static DvrArena::Info makeInfo(bool keyFrame, int64_t timestamp, bool isAudio = false)
+{
+    return DvrArena::Info{keyFrame, false, isAudio, timestamp, std::chrono::steady_clock::time_point{}};
+}
+
+// ---------- Test fixture ----------------------------------------------------
+class DvrArenaTest : public ::testing::Test
+{
+  protected:
+    DvrArena arena{1000, 64};
+
+    /* Helper: push an item of size bytes, all set to id, with id as its timestamp. */
+    bool push(uint8_t id, std::size_t size, bool keyFrame, bool isAudio = false)
+    {
+        return arena.push(size, makeInfo(keyFrame, id, isAudio), [&](uint8_t* dst) { std::memset(dst, id, size); });
+    }
+
+    /* Helper: take everything buffered, returns the ids (checking every byte of each item). */
+    std::vector<int> drain()
+    {
+        std::vector<int> ids;
+        DvrArena::Item   item;
+        while (arena.acquire(item, std::chrono::milliseconds(0)))
+        {
+            for (std::size_t i = 0; i < item.size; ++i) EXPECT_EQ(item.data[i], item.data[0]);
+            EXPECT_EQ(item.info.timestamp, item.data[0]);
+            ids.push_back(item.data[0]);
+            arena.release();
+        }
+        return ids;
+    }
+};
+
+TEST_F(DvrArenaTest, ItemsComeOutInOrder)
+{
+    for (uint8_t id = 0; id < 20; ++id) ASSERT_TRUE(push(id, 30 + id, id % 5 == 0));
+    std::vector<int> expected;
+    for (int id = 0; id < 20; ++id) expected.push_back(id);
+    ASSERT_EQ(drain(), expected);
+    ASSERT_EQ(arena.getStats().bytesBuffered, 0u);
+    ASSERT_EQ(arena.getStats().nDropped, 0u);
+}
+
+TEST_F(DvrArenaTest, FullArenaDropsOldestNonKeyFrames)
+{
+    ASSERT_TRUE(push(0, 100, true));
+    for (uint8_t id = 1; id <= 8; ++id) ASSERT_TRUE(push(id, 100, false));
+    ASSERT_EQ(arena.getStats().bytesBuffered, 900u);
+
+    ASSERT_TRUE(push(9, 200, true));
+    ASSERT_TRUE(push(10, 100, false));
+    ASSERT_EQ(arena.getStats().nDropped, 8u);
+    ASSERT_EQ(arena.getStats().bytesDropped, 800u);
+    ASSERT_EQ(drain(), (std::vector<int>{0, 9, 10}));
+}
+
+TEST_F(DvrArenaTest, DroppedRunIsSkippedUntilNextKeyFrame)
+{
+    ASSERT_TRUE(push(0, 500, true));
+    ASSERT_TRUE(push(1, 400, false));
+    // Makes room by dropping 1, but continues it
+    ASSERT_FALSE(push(2, 200, false));
+    ASSERT_FALSE(push(3, 50, false));
+    ASSERT_TRUE(push(4, 100, true));
+    ASSERT_TRUE(push(5, 100, false));
+    ASSERT_EQ(arena.getStats().nDropped, 3u);
+    ASSERT_EQ(drain(), (std::vector<int>{0, 4, 5}));
+}
+
+TEST_F(DvrArenaTest, AudioIsNotSkippedWithVideo)
+{
+    ASSERT_TRUE(push(0, 500, true));
+    ASSERT_TRUE(push(1, 400, false));
+    ASSERT_FALSE(push(2, 200, false));
+    // Waiting for a key frame, but audio still goes in
+    ASSERT_TRUE(push(3, 50, false, true));
+    ASSERT_FALSE(push(4, 50, false));
+    ASSERT_TRUE(push(5, 100, true));
+    ASSERT_EQ(arena.getStats().nDropped, 3u);
+    ASSERT_EQ(drain(), (std::vector<int>{0, 3, 5}));
+}
+
+TEST_F(DvrArenaTest, NewKeyFrameReplacesOldOnes)
+{
+    ASSERT_TRUE(push(0, 600, true));
+    ASSERT_TRUE(push(1, 600, true));
+    ASSERT_EQ(drain(), (std::vector<int>{1}));
+}
+
+TEST_F(DvrArenaTest, AcquiredItemIsNeverDropped)
+{
+    ASSERT_TRUE(push(0, 300, true));
+    ASSERT_TRUE(push(1, 300, false));
+    ASSERT_TRUE(push(2, 300, false));
+    DvrArena::Item item;
+    ASSERT_TRUE(arena.acquire(item, std::chrono::milliseconds(0)));
+    arena.release();
+    ASSERT_TRUE(arena.acquire(item, std::chrono::milliseconds(0)));
+    ASSERT_EQ(item.data[0], 1);
+
+    // Only 2 can go, that is not enough
+    ASSERT_FALSE(push(3, 500, true));
+    ASSERT_EQ(item.data[0], 1);
+    ASSERT_EQ(item.data[299], 1);
+    arena.release();
+
+    ASSERT_TRUE(push(4, 500, true));
+    ASSERT_EQ(drain(), (std::vector<int>{4}));
+}
+
+TEST_F(DvrArenaTest, CloseDrainsWhatIsLeft)
+{
+    ASSERT_TRUE(push(0, 10, true));
+    ASSERT_TRUE(push(1, 10, false));
+    arena.close();
+    ASSERT_FALSE(push(2, 10, false));
+    DvrArena::Item item;
+    // Doesn't wait once closed
+    ASSERT_TRUE(arena.acquire(item, std::chrono::hours(1)));
+    arena.release();
+    ASSERT_TRUE(arena.acquire(item, std::chrono::hours(1)));
+    arena.release();
+    ASSERT_FALSE(arena.acquire(item, std::chrono::hours(1)));
+
+    arena.reset();
+    ASSERT_TRUE(push(3, 10, true));
+    ASSERT_EQ(drain(), (std::vector<int>{3}));
+}
+
+TEST_F(DvrArenaTest, ResetDuringPushDiscardsIt)
+{
+    ASSERT_TRUE(push(0, 10, true));
+    // The producer is still filling its item when the arena is reset for the next recording
+    ASSERT_FALSE(arena.push(
+        10,
+        makeInfo(false, 1),
+        [&](uint8_t* dst)
+        {
+            std::memset(dst, 1, 10);
+            arena.reset();
+        }));
+    ASSERT_EQ(arena.getStats().nBuffered, 0u);
+    ASSERT_EQ(arena.getStats().bytesBuffered, 0u);
+    ASSERT_TRUE(push(2, 10, true));
+    ASSERT_EQ(drain(), (std::vector<int>{2}));
+    arena.close();
+    DvrArena::Item item;
+    ASSERT_FALSE(arena.acquire(item, std::chrono::hours(1)));
+    ASSERT_TRUE(arena.drained());
+}
+
+TEST_F(DvrArenaTest, ProducerAndConsumerThreads)
+{
+    DvrArena    shared(64 * 1024, 256);
+    const int   N = 20000;
+    std::thread producer(
+        [&]
+        {
+            std::mt19937 random(42);
+            for (int i = 0; i < N; ++i)
+            {
+                const std::size_t size = 8 + random() % 4000;
+                shared.push(
+                    size,
+                    makeInfo(i % 30 == 0, DvrArena::NO_TIMESTAMP),
+                    [&](uint8_t* dst) { std::memset(dst, i & 0xff, size); });
+                if (i % 64 == 0) std::this_thread::yield();
+            }
+            shared.close();
+        });
+    DvrArena::Item item;
+    long           nReceived = 0;
+    while (shared.acquire(item, std::chrono::seconds(10)))
+    {
+        ASSERT_EQ(item.data[item.size - 1], item.data[0]);
+        nReceived++;
+        shared.release();
+    }
+    producer.join();
+    ASSERT_EQ(nReceived + (long) shared.getStats().nDropped, N);
+}
+
+// 30 MBit/s for an hour, with the writer stalling now and then
+TEST(DvrArenaSteadyState, AllocatesNothing)
+{
+    DvrArena       arena(16 * 1024 * 1024, 8192);
+    std::mt19937   random(7);
+    DvrArena::Item item;
+    long           nWritten = 0, nOutOfOrder = 0;
+    uint32_t       lastFrame = 0;
+
+    const long allocationsBefore = gAllocations;
+    for (uint32_t frame = 1; frame <= 30 * 3600; ++frame)
+    {
+        const bool           keyFrame = frame % 60 == 1;
+        const std::size_t    size     = keyFrame ? 400 * 1024 : 100 * 1024 + random() % (50 * 1024);
+        const DvrArena::Info info     = makeInfo(keyFrame, frame * 3000);
+        arena.push(size, info, [&](uint8_t* dst) { std::memcpy(dst, &frame, sizeof(frame)); });
+        // Stalls for 10 s every 100 s, more than the arena holds
+        if (frame % 3000 >= 300)
+        {
+            while (arena.acquire(item, std::chrono::milliseconds(0)))
+            {
+                uint32_t written;
+                std::memcpy(&written, item.data, sizeof(written));
+                if (written <= lastFrame) nOutOfOrder++;
+                lastFrame = written;
+                nWritten++;
+                arena.release();
+            }
+        }
+    }
+    const long allocations = gAllocations - allocationsBefore;
+
+    const DvrArena::Stats stats = arena.getStats();
+    EXPECT_EQ(allocations, 0);
+    EXPECT_EQ(nOutOfOrder, 0);
+    EXPECT_GT(stats.nDropped, 0u);
+    EXPECT_EQ(nWritten + (long) stats.nBuffered + (long) stats.nDropped, 30 * 3600);
+}
+
+// ---------- gtest boilerplate main -----------------------------------------
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
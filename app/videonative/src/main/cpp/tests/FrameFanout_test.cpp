@@ -0,0 +1,169 @@
+#include "FrameFanout.h"  // the class under test
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+// ---------- Fakes ------------------------------------------------------------
+/* Stands in for the decoder and its buffer queue (AImageReader): frames come from a fixed number of buffers. */
+class FakeCodec
+{
+  public:
+    class Frame : public FanoutFrame
+    {
+      public:
+        Frame(FakeCodec& codec, int number) : codec(codec), number(number) {}
+        ~Frame() override { codec.nFreeBuffers++; }
+
+        FakeCodec& codec;
+        const int  number;
+    };
+
+    explicit FakeCodec(int nBuffers) : nFreeBuffers(nBuffers) {}
+
+    /* Decode the next frame into a free buffer, nullptr if the decoder would have to wait for one. */
+    std::shared_ptr<Frame> decode()
+    {
+        if (nFreeBuffers == 0) return nullptr;
+        nFreeBuffers--;
+        return std::make_shared<Frame>(*this, nDecoded++);
+    }
+
+    int nFreeBuffers;
+    int nDecoded = 0;
+};
+
+/* Like a SurfaceControl: keeps the frame on screen until the next one replaced it. */
+class FakeSink : public FanoutSink
+{
+  public:
+    FakeSink(FrameFanout& fanout, bool immediate) : fanout(fanout), immediate(immediate) {}
+
+    void present(std::shared_ptr<FanoutFrame> frame) override
+    {
+        presented.push_back(static_cast<FakeCodec::Frame&>(*frame).number);
+        inFlight = std::move(frame);
+        if (immediate) complete();
+    }
+
+    /* The frame in flight made it on screen */
+    void complete()
+    {
+        if (!inFlight) return;
+        onScreen = std::move(inFlight);
+        fanout.onSinkReady(id);
+    }
+
+    FrameFanout&                 fanout;
+    const bool                   immediate;
+    int                          id = -1;
+    std::vector<int>             presented;
+    std::shared_ptr<FanoutFrame> inFlight, onScreen;
+};
+
+// ---------- Test fixture ----------------------------------------------------
+class FrameFanoutTest : public ::testing::Test
+{
+  protected:
+    // Outlives the fan-out, which releases the frames it still holds when destroyed
+    std::unique_ptr<FakeCodec> codec;
+    FrameFanout                fanout;
+
+    std::shared_ptr<FakeSink> addSink(bool immediate)
+    {
+        auto sink = std::make_shared<FakeSink>(fanout, immediate);
+        sink->id  = fanout.addSink(sink);
+        return sink;
+    }
+
+    /* Helper: decode n frames and hand them to the fan-out. */
+    void decode(int n)
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            auto frame = codec->decode();
+            ASSERT_NE(frame, nullptr) << "Decoder ran out of buffers at frame " << codec->nDecoded;
+            fanout.onFrame(std::move(frame));
+        }
+    }
+};
+
+TEST_F(FrameFanoutTest, FastSinksGetEveryFrame)
+{
+    codec  = std::make_unique<FakeCodec>(FrameFanout::framesNeeded(2));
+    auto a = addSink(true);
+    auto b = addSink(true);
+    decode(100);
+    ASSERT_EQ(a->presented.size(), 100u);
+    ASSERT_EQ(b->presented, a->presented);
+    ASSERT_EQ(fanout.getStats(a->id).nDropped, 0);
+    // Only the frame on screen is still referenced
+    ASSERT_EQ(codec->nFreeBuffers, (int) FrameFanout::framesNeeded(2) - 1);
+}
+
+TEST_F(FrameFanoutTest, SlowSinkGetsNewestFrameAndDoesNotHoldBackOthers)
+{
+    codec     = std::make_unique<FakeCodec>(FrameFanout::framesNeeded(2));
+    auto fast = addSink(true);
+    auto slow = addSink(false);
+    decode(10);
+    ASSERT_EQ(fast->presented.size(), 10u);
+    ASSERT_EQ(slow->presented, (std::vector<int>{0}));
+    ASSERT_EQ(fanout.getStats(slow->id).nDropped, 8);
+
+    slow->complete();
+    ASSERT_EQ(slow->presented, (std::vector<int>{0, 9}));
+    slow->complete();
+    decode(1);
+    ASSERT_EQ(slow->presented, (std::vector<int>{0, 9, 10}));
+}
+
+TEST_F(FrameFanoutTest, DecoderNeverWaitsForABuffer)
+{
+    codec = std::make_unique<FakeCodec>(FrameFanout::framesNeeded(3));
+    const std::vector<std::shared_ptr<FakeSink>> sinks{addSink(false), addSink(false), addSink(false)};
+    std::mt19937                                 random(1234);
+    for (int i = 0; i < 10000; ++i)
+    {
+        decode(1);
+        for (const auto& sink : sinks)
+        {
+            // Sinks at different, varying speeds (the last one mostly stuck)
+            if (random() % (sink == sinks.back() ? 50 : 3) == 0) sink->complete();
+        }
+    }
+    for (const auto& sink : sinks)
+    {
+        ASSERT_EQ(fanout.getStats(sink->id).nPresented, (long) sink->presented.size());
+        ASSERT_TRUE(std::is_sorted(sink->presented.begin(), sink->presented.end()));
+    }
+}
+
+TEST_F(FrameFanoutTest, RemovedSinkReleasesWaitingFrame)
+{
+    codec     = std::make_unique<FakeCodec>(FrameFanout::framesNeeded(1));
+    auto sink = addSink(false);
+    decode(2);
+    ASSERT_EQ(codec->nFreeBuffers, (int) FrameFanout::framesNeeded(1) - 2);
+    fanout.removeSink(sink->id);
+    ASSERT_EQ(fanout.nSinks(), 0u);
+    ASSERT_EQ(codec->nFreeBuffers, (int) FrameFanout::framesNeeded(1) - 1) << "only the one presented is left";
+
+    sink->complete();  // ignored
+    decode(1);
+    ASSERT_EQ(sink->presented, (std::vector<int>{0}));
+}
+
+TEST_F(FrameFanoutTest, SinkLimit)
+{
+    for (std::size_t i = 0; i < FrameFanout::MAX_SINKS; ++i) ASSERT_NE(addSink(true)->id, -1);
+    ASSERT_EQ(addSink(true)->id, -1);
+}
+
+// ---------- gtest boilerplate main -----------------------------------------
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,247 @@
+#include "NALU/SpsParser.hpp"  // the code under test
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <vector>
+
+// ---------- SPS writer -------------------------------------------------------
+class BitWriter
+{
+  public:
+    void bits(uint32_t value, int n)
+    {
+        for (int i = n - 1; i >= 0; --i) mBits.push_back((value >> i) & 1);
+    }
+
+    void ue(uint32_t value)
+    {
+        const uint64_t v = uint64_t{value} + 1;
+        int            n = 0;
+        while ((v >> (n + 1)) != 0) ++n;
+        bits(0, n);
+        bits(static_cast<uint32_t>(v), n + 1);
+    }
+
+    void se(int32_t value) { ue(value > 0 ? 2 * value - 1 : -2 * value); }
+
+    /* Helper: rbsp trailing bits, then emulation prevention like an encoder does. */
+    std::vector<uint8_t> finish()
+    {
+        bits(1, 1);
+        while (mBits.size() % 8 != 0) bits(0, 1);
+        std::vector<uint8_t> escaped;
+        int                  zeros = 0;
+        for (size_t i = 0; i < mBits.size(); i += 8)
+        {
+            uint8_t byte = 0;
+            for (int b = 0; b < 8; ++b) byte = (byte << 1) | mBits[i + b];
+            if (zeros == 2 && byte <= 3)
+            {
+                escaped.push_back(3);
+                zeros = 0;
+            }
+            escaped.push_back(byte);
+            zeros = byte == 0 ? zeros + 1 : 0;
+        }
+        return escaped;
+    }
+
+  private:
+    std::vector<uint8_t> mBits;
+};
+
+static bool hasEmulationPrevention(const std::vector<uint8_t>& data)
+{
+    for (size_t i = 2; i < data.size(); ++i)
+    {
+        if (data[i - 2] == 0 && data[i - 1] == 0 && data[i] == 3) return true;
+    }
+    return false;
+}
+
+// ---------- H264 -------------------------------------------------------------
+TEST(SpsParserTest, H264Baseline720p)
+{
+    BitWriter w;
+    w.bits(66, 8);  // profile_idc
+    w.bits(0, 8);   // constraint flags
+    w.bits(31, 8);  // level_idc
+    w.ue(0);        // seq_parameter_set_id
+    w.ue(0);        // log2_max_frame_num_minus4
+    w.ue(2);        // pic_order_cnt_type
+    w.ue(1);        // max_num_ref_frames
+    w.bits(0, 1);   // gaps_in_frame_num_value_allowed_flag
+    w.ue(79);       // pic_width_in_mbs_minus1
+    w.ue(44);       // pic_height_in_map_units_minus1
+    w.bits(1, 1);   // frame_mbs_only_flag
+    w.bits(1, 1);   // direct_8x8_inference_flag
+    w.bits(0, 1);   // frame_cropping_flag
+    w.bits(0, 1);   // vui_parameters_present_flag
+    const auto sps  = w.finish();
+    const auto size = SpsParser::h264PictureSize(sps.data(), sps.size());
+    ASSERT_TRUE(size.has_value());
+    ASSERT_EQ(*size, (std::array<int, 2>{1280, 720}));
+}
+
+TEST(SpsParserTest, H264HighWithScalingListsAndCropping)
+{
+    BitWriter w;
+    w.bits(100, 8);
+    w.bits(0, 8);
+    w.bits(40, 8);
+    w.ue(0);
+    w.ue(1);       // chroma_format_idc 4:2:0
+    w.ue(0);       // bit_depth_luma_minus8
+    w.ue(0);       // bit_depth_chroma_minus8
+    w.bits(0, 1);  // qpprime_y_zero_transform_bypass_flag
+    w.bits(1, 1);  // seq_scaling_matrix_present_flag
+    for (int i = 0; i < 8; ++i)
+    {
+        const bool present = i == 0 || i == 6;
+        w.bits(present, 1);
+        if (!present) continue;
+        // A few deltas, then a delta to 0 which ends the list early
+        w.se(4);
+        w.se(-2);
+        w.se(-10);
+    }
+    w.ue(0);
+    w.ue(1);  // pic_order_cnt_type 1
+    w.bits(0, 1);
+    w.se(-3);
+    w.se(2);
+    w.ue(3);  // num_ref_frames_in_pic_order_cnt_cycle
+    w.se(1);
+    w.se(-1);
+    w.se(5);
+    w.ue(4);
+    w.bits(0, 1);
+    w.ue(119);
+    w.ue(67);
+    w.bits(1, 1);
+    w.bits(1, 1);
+    w.bits(1, 1);  // frame_cropping_flag
+    w.ue(0);
+    w.ue(0);
+    w.ue(0);
+    w.ue(4);  // 8 rows at 4:2:0
+    w.bits(0, 1);
+    const auto sps  = w.finish();
+    const auto size = SpsParser::h264PictureSize(sps.data(), sps.size());
+    ASSERT_TRUE(size.has_value());
+    ASSERT_EQ(*size, (std::array<int, 2>{1920, 1080}));
+}
+
+TEST(SpsParserTest, H264InterlacedFieldPairs)
+{
+    BitWriter w;
+    w.bits(77, 8);
+    w.bits(0, 8);
+    w.bits(30, 8);
+    w.ue(0);
+    w.ue(0);
+    w.ue(0);  // pic_order_cnt_type 0
+    w.ue(2);  // log2_max_pic_order_cnt_lsb_minus4
+    w.ue(2);
+    w.bits(0, 1);
+    w.ue(44);
+    w.ue(17);      // 18 map units of 32 lines
+    w.bits(0, 1);  // frame_mbs_only_flag
+    w.bits(1, 1);  // mb_adaptive_frame_field_flag
+    w.bits(1, 1);
+    w.bits(0, 1);
+    const auto sps  = w.finish();
+    const auto size = SpsParser::h264PictureSize(sps.data(), sps.size());
+    ASSERT_TRUE(size.has_value());
+    ASSERT_EQ(*size, (std::array<int, 2>{720, 576}));
+}
+
+TEST(SpsParserTest, H264TruncatedIsRejected)
+{
+    BitWriter w;
+    w.bits(66, 8);
+    w.bits(0, 8);
+    w.bits(31, 8);
+    w.ue(0);
+    w.ue(0);
+    auto sps = w.finish();
+    ASSERT_FALSE(SpsParser::h264PictureSize(sps.data(), sps.size()).has_value());
+    ASSERT_FALSE(SpsParser::h264PictureSize(sps.data(), 0).has_value());
+}
+
+// ---------- H265 -------------------------------------------------------------
+static void writeProfileTierLevel(BitWriter& w, int maxSubLayersMinus1)
+{
+    w.bits(0, 2);            // general_profile_space
+    w.bits(0, 1);            // general_tier_flag
+    w.bits(1, 5);            // general_profile_idc (Main)
+    w.bits(0x60000000, 32);  // general_profile_compatibility_flags
+    w.bits(0x9, 4);          // progressive, interlaced, non packed, frame only
+    w.bits(0, 32);           // 43 reserved bits + general_inbld_flag
+    w.bits(0, 12);
+    w.bits(120, 8);  // general_level_idc
+    for (int i = 0; i < maxSubLayersMinus1; ++i)
+    {
+        w.bits(1, 1);  // sub_layer_profile_present_flag
+        w.bits(1, 1);  // sub_layer_level_present_flag
+    }
+    if (maxSubLayersMinus1 > 0) w.bits(0, 2 * (8 - maxSubLayersMinus1));
+    for (int i = 0; i < maxSubLayersMinus1; ++i)
+    {
+        w.bits(0x1, 8);
+        w.bits(0, 32);
+        w.bits(0, 32);
+        w.bits(0, 16);
+        w.bits(90, 8);
+    }
+}
+
+TEST(SpsParserTest, H265ConformanceWindow)
+{
+    BitWriter w;
+    w.bits(0, 4);  // sps_video_parameter_set_id
+    w.bits(1, 3);  // sps_max_sub_layers_minus1
+    w.bits(1, 1);
+    writeProfileTierLevel(w, 1);
+    w.ue(0);       // sps_seq_parameter_set_id
+    w.ue(1);       // chroma_format_idc
+    w.ue(1920);    // pic_width_in_luma_samples
+    w.ue(1088);    // pic_height_in_luma_samples
+    w.bits(1, 1);  // conformance_window_flag
+    w.ue(0);
+    w.ue(0);
+    w.ue(0);
+    w.ue(4);  // 8 rows at 4:2:0
+    w.ue(0);  // bit_depth_luma_minus8
+    const auto sps = w.finish();
+    ASSERT_TRUE(hasEmulationPrevention(sps)) << "The zero runs of the profile need escaping";
+    const auto size = SpsParser::h265PictureSize(sps.data(), sps.size());
+    ASSERT_TRUE(size.has_value());
+    ASSERT_EQ(*size, (std::array<int, 2>{1920, 1080}));
+}
+
+TEST(SpsParserTest, H265WithoutConformanceWindow)
+{
+    BitWriter w;
+    w.bits(0, 4);
+    w.bits(0, 3);
+    w.bits(1, 1);
+    writeProfileTierLevel(w, 0);
+    w.ue(0);
+    w.ue(1);
+    w.ue(1280);
+    w.ue(720);
+    w.bits(0, 1);
+    w.ue(0);
+    const auto sps  = w.finish();
+    const auto size = SpsParser::h265PictureSize(sps.data(), sps.size());
+    ASSERT_TRUE(size.has_value());
+    ASSERT_EQ(*size, (std::array<int, 2>{1280, 720}));
+    ASSERT_FALSE(SpsParser::h265PictureSize(sps.data(), 10).has_value());
+}
+
+// ---------- main ------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
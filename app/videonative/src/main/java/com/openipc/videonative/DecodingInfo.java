@@ -13,10 +13,13 @@ public class DecodingInfo {
     public final float avgWaitForInputBTime_ms;
     public final float avgHWDecodingTime_ms; //time the hw decoder was holding on to frames. Not the full decoding time !
     public final float avgTotalDecodingTime_ms;
+    public final float avgReceiveTime_ms; //socket / radio receive until the NALU was parsed (ring, reactor, jitter buffer)
+    public final float avgTotalLatency_ms; //socket / radio receive until decoded
     public final int nNALU;
     public final int nNALUSFeeded;
     public final int nDecodedFrames;
     public final int nCodec;
+    public final float codecCallsPerFrame; //MediaCodec input buffers queued per decoded frame
 
     public DecodingInfo() {
         currentFPS = 0;
@@ -29,11 +32,15 @@ public class DecodingInfo {
         avgTotalDecodingTime_ms = 0;
         nDecodedFrames = 0;
         nCodec = 0;
+        codecCallsPerFrame = 0;
+        avgReceiveTime_ms = 0;
+        avgTotalLatency_ms = 0;
     }
 
     public DecodingInfo(float currentFPS, float currentKiloBitsPerSecond, float avgParsingTime_ms,
                         float avgWaitForInputBTime_ms, float avgHWDecodingTime_ms,
-                        int nNALU, int nNALUSFeeded, int nDecodedFrames, int nCodec) {
+                        int nNALU, int nNALUSFeeded, int nDecodedFrames, int nCodec,
+                        float codecCallsPerFrame, float avgReceiveTime_ms) {
         this.currentFPS = currentFPS;
         this.currentKiloBitsPerSecond = currentKiloBitsPerSecond;
         this.avgParsingTime_ms = avgParsingTime_ms;
@@ -44,10 +51,15 @@ public class DecodingInfo {
         this.nNALUSFeeded = nNALUSFeeded;
         this.nDecodedFrames = nDecodedFrames;
         this.nCodec = nCodec;
+        this.codecCallsPerFrame = codecCallsPerFrame;
+        this.avgReceiveTime_ms = avgReceiveTime_ms;
+        this.avgTotalLatency_ms = avgReceiveTime_ms + avgTotalDecodingTime_ms;
     }
 
     public LinkedHashMap<String, Object> toMap() {
         LinkedHashMap<String, Object> decodingInfo = new LinkedHashMap<>();
+        decodingInfo.put("avgTotalLatency_ms", avgTotalLatency_ms);
+        decodingInfo.put("avgReceiveTime_ms", avgReceiveTime_ms);
         decodingInfo.put("avgTotalDecodingTime_ms", avgTotalDecodingTime_ms);
         decodingInfo.put("avgParsingTime_ms", avgParsingTime_ms);
         decodingInfo.put("avgWaitForInputBTime_ms", avgWaitForInputBTime_ms);
@@ -58,6 +70,7 @@ public class DecodingInfo {
         decodingInfo.put("nNALUSFeeded", nNALUSFeeded);
         decodingInfo.put("nDecodedFrames", nDecodedFrames);
         decodingInfo.put("nCodec", nCodec);
+        decodingInfo.put("codecCallsPerFrame", codecCallsPerFrame);
         return decodingInfo;
     }
 
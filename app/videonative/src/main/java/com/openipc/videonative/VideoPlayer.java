@@ -22,6 +22,10 @@ import java.util.TimerTask;
  */
 public class VideoPlayer implements IVideoParamsChanged {
     private static final String TAG = "pixelpilot";
+    // After packet loss, keep feeding the decoder (it conceals, smearing until the next keyframe) ...
+    public static final int LOSS_POLICY_FORWARD = 0;
+    // ... or hold the last good picture until the next keyframe. Both ask the air unit for a keyframe.
+    public static final int LOSS_POLICY_DROP_UNTIL_KEYFRAME = 1;
 
     //All the native binding(s)
     static {
@@ -57,6 +61,12 @@ public class VideoPlayer implements IVideoParamsChanged {
     public static native boolean nativeIsRecording(long nativeInstance);
     public static native void nativeStartAudio(long nativeInstance);
     public static native void nativeStopAudio(long nativeInstance);
+    public static native void nativeSetSliceStreaming(long nativeInstance, boolean enable);
+    public static native void nativeSetAccessUnitMode(long nativeInstance, boolean enable);
+    public static native void nativeSetLossPolicy(long nativeInstance, int policy);
+
+    // Returns a native pointer to the in-process RTP sink (see WfbNgLink.setVideoSink)
+    public static native long nativeGetInProcessSink(long nativeInstance);
 
     //get members or other information. Some might be only usable in between (nativeStart <-> nativeStop)
     public static native String getVideoInfoString(long nativeInstance);
@@ -120,6 +130,21 @@ public class VideoPlayer implements IVideoParamsChanged {
         nativeStopAudio(nativeVideoPlayer);
     }
 
+    // Let the decoder start on a picture as soon as its last slice arrived (needs RTP marker bits)
+    public void setSliceStreaming(boolean enable) {
+        nativeSetSliceStreaming(nativeVideoPlayer, enable);
+    }
+
+    // Feed the decoder one buffer per picture instead of one per NALU
+    public void setAccessUnitMode(boolean enable) {
+        nativeSetAccessUnitMode(nativeVideoPlayer, enable);
+    }
+
+    // One of the LOSS_POLICY_ constants
+    public void setLossPolicy(int policy) {
+        nativeSetLossPolicy(nativeVideoPlayer, policy);
+    }
+
     public boolean isRunning() {
         return timer != null;
     }
@@ -204,6 +229,10 @@ public class VideoPlayer implements IVideoParamsChanged {
         return nativeVideoPlayer;
     }
 
+    public long getInProcessSink() {
+        return nativeGetInProcessSink(nativeVideoPlayer);
+    }
+
     // called by native code via NDK
     @Override
     @SuppressWarnings({"UnusedDeclaration"})
@@ -0,0 +1,16 @@
+#include "AggregatorInProcess.h"
+
+AggregatorInProcess::AggregatorInProcess(const InProcessRtpSink *sink,
+                                         const std::string &keypair,
+                                         uint64_t epoch,
+                                         uint32_t channel_id)
+        : Aggregator(keypair, epoch, channel_id), sink(sink) {}
+
+void AggregatorInProcess::send_to_socket(const uint8_t *payload, uint16_t packet_size) {
+    // Copies into the VideoPlayer ring, never blocks the RX thread
+    if (sink->push_timed != nullptr && rx_time_ns != 0) {
+        sink->push_timed(sink->opaque, payload, packet_size, rx_time_ns);
+    } else {
+        sink->push(sink->opaque, payload, packet_size);
+    }
+}
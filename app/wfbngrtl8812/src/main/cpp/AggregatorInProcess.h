@@ -0,0 +1,30 @@
+#pragma once
+
+#include "InProcessRtpSink.h"
+#include "wfb-ng/src/rx.hpp"
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @class AggregatorInProcess
+ * @brief wfb-ng aggregator that hands decrypted, FEC-recovered packets to an in-process sink
+ *        (the VideoPlayer) instead of sending them to a UDP socket like AggregatorUDPv4.
+ */
+class AggregatorInProcess : public Aggregator {
+  public:
+    AggregatorInProcess(const InProcessRtpSink *sink,
+                        const std::string &keypair,
+                        uint64_t epoch,
+                        uint32_t channel_id);
+
+    // Radio arrival time of the frame passed to the next process_packet(), forwarded with the packets it yields
+    void set_rx_time(int64_t rx_time_ns) { this->rx_time_ns = rx_time_ns; }
+
+  protected:
+    void send_to_socket(const uint8_t *payload, uint16_t packet_size) override;
+
+  private:
+    const InProcessRtpSink *sink;
+    int64_t rx_time_ns{0};
+};
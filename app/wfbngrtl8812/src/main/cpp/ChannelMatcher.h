@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+/**
+ * Classifies received 802.11 frames by wfb channel in a single pass.
+ *
+ * A wfb frame carries its channel id twice in the address fields, bytes 10..21 are
+ *     0x57 0x42 <channel_id_be> 0x57 0x42 <channel_id_be>
+ * For every registered channel those 12 bytes are precomputed as one 64-bit word (bytes 10..17) and one 32-bit
+ * word (bytes 18..21), so matching a frame is two loads and two compares per channel instead of the twelve byte
+ * compares of RxFrame::MatchesChannelID. A match also implies what IsValidWfbFrame checks on the addresses
+ * (same air/gnd id and radio port in both), so only the length and frame control remain to be checked.
+ */
+template <size_t N> class ChannelMatcher {
+  public:
+    static constexpr int NO_MATCH = -1;
+
+    // QoS data frame control, 802.11 header and FCS, see RxFrame
+    static constexpr uint8_t FRAME_CONTROL[2] = {0x08, 0x01};
+    static constexpr size_t HEADER_SIZE = 24;
+    static constexpr size_t FCS_SIZE = 4;
+
+    // channel_ids in host byte order, (link_id << 8) + radio_port. The index in this array is what classify returns.
+    explicit ChannelMatcher(const std::array<uint32_t, N> &channel_ids) {
+        for (size_t i = 0; i < N; ++i) {
+            const uint32_t id = channel_ids[i];
+            const uint8_t expected[12] = {0x57,
+                                          0x42,
+                                          uint8_t(id >> 24),
+                                          uint8_t(id >> 16),
+                                          uint8_t(id >> 8),
+                                          uint8_t(id),
+                                          0x57,
+                                          0x42,
+                                          uint8_t(id >> 24),
+                                          uint8_t(id >> 16),
+                                          uint8_t(id >> 8),
+                                          uint8_t(id)};
+            std::memcpy(&words[i].lo, expected, sizeof(uint64_t));
+            std::memcpy(&words[i].hi, expected + sizeof(uint64_t), sizeof(uint32_t));
+        }
+    }
+
+    // Index of the channel the frame belongs to, or NO_MATCH if it is not a valid wfb frame of a registered channel
+    int classify(std::span<const uint8_t> frame) const {
+        // IsValidWfbFrame also rejects an empty payload
+        if (frame.size() <= HEADER_SIZE + FCS_SIZE) return NO_MATCH;
+        if (frame[0] != FRAME_CONTROL[0] || frame[1] != FRAME_CONTROL[1]) return NO_MATCH;
+        uint64_t lo;
+        uint32_t hi;
+        std::memcpy(&lo, frame.data() + 10, sizeof(lo));
+        std::memcpy(&hi, frame.data() + 18, sizeof(hi));
+        for (size_t i = 0; i < N; ++i) {
+            if (((lo ^ words[i].lo) | (hi ^ words[i].hi)) == 0) return static_cast<int>(i);
+        }
+        return NO_MATCH;
+    }
+
+    static constexpr size_t size() { return N; }
+
+  private:
+    struct alignas(16) Words {
+        uint64_t lo;
+        uint32_t hi;
+    };
+    std::array<Words, N> words{};
+};
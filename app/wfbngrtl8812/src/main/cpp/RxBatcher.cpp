@@ -0,0 +1,128 @@
+#include "RxBatcher.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+RxBatcher::RxBatcher(BatchHandler handler, size_t pool_size) : handler(std::move(handler)) {
+    free_batches.reserve(pool_size);
+    for (size_t i = 0; i < pool_size; ++i) {
+        auto batch = std::make_unique<Batch>();
+        batch->arena.resize(BATCH_ARENA_SIZE);
+        batch->frames.reserve(MAX_FRAMES_PER_BATCH);
+        free_batches.push_back(std::move(batch));
+    }
+}
+
+RxBatcher::~RxBatcher() { stop(); }
+
+void RxBatcher::start() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (running) return;
+    // Frames flushed while stopped belong to a previous session
+    for (auto &batch : ready_batches) {
+        batch->frames.clear();
+        batch->used = 0;
+        free_batches.push_back(std::move(batch));
+    }
+    ready_batches.clear();
+    running = true;
+    dispatcher = std::thread([this] { dispatchLoop(); });
+}
+
+void RxBatcher::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    cv.notify_one();
+    if (dispatcher.joinable()) dispatcher.join();
+}
+
+std::unique_ptr<RxBatcher::Batch> RxBatcher::takeFreeBatch() {
+    if (free_batches.empty()) return nullptr;
+    auto batch = std::move(free_batches.back());
+    free_batches.pop_back();
+    return batch;
+}
+
+bool RxBatcher::publishLocked() {
+    const bool queued = filling && !filling->frames.empty();
+    if (queued) ready_batches.push_back(std::move(filling));
+    if (!filling) filling = takeFreeBatch();
+    return queued;
+}
+
+void RxBatcher::push(std::span<const uint8_t> frame, int channel, const int8_t rssi[2], const int8_t snr[2]) {
+    if (frame.size() > BATCH_ARENA_SIZE) {
+        count_oversized.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    const int64_t rx_time_ns = rx_time_now_ns();
+    if (!filling || filling->frames.size() == MAX_FRAMES_PER_BATCH ||
+        filling->used + frame.size() > BATCH_ARENA_SIZE) {
+        // The transfer overflows the batch, or the pool was exhausted at the last flush
+        bool wake;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            wake = publishLocked();
+        }
+        if (wake) cv.notify_one();
+        if (!filling) {
+            count_pool_exhausted.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+    uint8_t *dst = filling->arena.data() + filling->used;
+    std::memcpy(dst, frame.data(), frame.size());
+    filling->used += frame.size();
+    filling->frames.push_back({{dst, frame.size()}, channel, {rssi[0], rssi[1]}, {snr[0], snr[1]}, rx_time_ns});
+}
+
+void RxBatcher::flush() {
+    if (!filling || filling->frames.empty()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        counters.transfers++;
+        publishLocked();
+    }
+    cv.notify_one();
+}
+
+void RxBatcher::dispatchLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        cv.wait(lock, [this] { return !running || !ready_batches.empty(); });
+
+        if (ready_batches.empty()) break; // stopped and drained
+        std::unique_ptr<Batch> batch = std::move(ready_batches.front());
+        ready_batches.pop_front();
+
+        lock.unlock();
+        handler(batch->frames);
+        lock.lock();
+
+        counters.batches++;
+        counters.frames += batch->frames.size();
+        counters.max_frames_per_batch =
+            std::max(counters.max_frames_per_batch, static_cast<uint32_t>(batch->frames.size()));
+        batch->frames.clear();
+        batch->used = 0;
+        free_batches.push_back(std::move(batch));
+    }
+}
+
+RxBatchStats RxBatcher::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    RxBatchStats stats = counters;
+    stats.pool_exhausted = count_pool_exhausted.load(std::memory_order_relaxed);
+    stats.oversized = count_oversized.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void RxBatcher::clear_stats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    counters = {};
+    count_pool_exhausted.store(0, std::memory_order_relaxed);
+    count_oversized.store(0, std::memory_order_relaxed);
+}
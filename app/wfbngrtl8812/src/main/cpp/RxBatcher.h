@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+// One received 802.11 frame, backed by the arena of the batch it belongs to.
+struct RxBatchFrame {
+    std::span<uint8_t> data;
+    // Tag chosen by the producer, the wfb channel index for WfbngLink
+    int channel;
+    int8_t rssi[2];
+    int8_t snr[2];
+    // steady_clock (CLOCK_MONOTONIC) nanoseconds when the USB RX callback handed the frame over
+    int64_t rx_time_ns;
+};
+
+inline int64_t rx_time_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+struct RxBatchStats {
+    // flush() calls that published frames, i.e. completed bulk-in transfers
+    uint64_t transfers;
+    // Batches handed to the dispatcher, more than transfers when a transfer overflows a batch
+    uint64_t batches;
+    uint64_t frames;
+    uint32_t max_frames_per_batch;
+    // Frames dropped because every batch of the pool was in flight
+    uint64_t pool_exhausted;
+    // Frames dropped because they don't fit in an empty batch arena
+    uint64_t oversized;
+
+    double frames_per_transfer() const { return transfers ? static_cast<double>(frames) / transfers : 0.0; }
+};
+
+/**
+ * Collects frames delivered one by one by the USB RX callback into batches taken from a fixed pool, and hands
+ * every batch to the dispatcher thread as a single span.
+ *
+ * The batch being filled belongs to the USB thread: push() appends to it without a lock, flush() publishes it with
+ * one lock / notify once the callbacks of a bulk-in transfer are done. A lock is only taken per frame when a batch
+ * overflows mid-transfer. push() never allocates and never blocks on the dispatcher; when the pool is exhausted the
+ * frame is dropped and counted so the pool can be sized.
+ */
+class RxBatcher {
+  public:
+    using BatchHandler = std::function<void(std::span<const RxBatchFrame>)>;
+
+    static constexpr size_t DEFAULT_POOL_SIZE = 32;
+    static constexpr size_t MAX_FRAMES_PER_BATCH = 64;
+    // One RTL8812AU bulk-in transfer is at most 32 KiB
+    static constexpr size_t BATCH_ARENA_SIZE = 32 * 1024;
+
+    RxBatcher(BatchHandler handler, size_t pool_size = DEFAULT_POOL_SIZE);
+    ~RxBatcher();
+
+    RxBatcher(const RxBatcher &) = delete;
+    RxBatcher &operator=(const RxBatcher &) = delete;
+
+    void start();
+    // Dispatches whatever is still pending, then joins the dispatcher thread
+    void stop();
+
+    // Producer side, push() and flush() are called from the USB RX thread only
+    void push(std::span<const uint8_t> frame, int channel, const int8_t rssi[2], const int8_t snr[2]);
+    // Hands the frames pushed since the last call to the dispatcher, after every libusb event loop iteration
+    void flush();
+
+    RxBatchStats stats() const;
+    void clear_stats();
+
+  private:
+    struct Batch {
+        std::vector<uint8_t> arena;
+        size_t used{0};
+        std::vector<RxBatchFrame> frames;
+    };
+
+    void dispatchLoop();
+    std::unique_ptr<Batch> takeFreeBatch();
+    // Queues filling (if any) and takes the next free batch, with mutex held. true if the dispatcher has to wake up
+    bool publishLocked();
+
+    const BatchHandler handler;
+
+    mutable std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<std::unique_ptr<Batch>> free_batches;
+    std::deque<std::unique_ptr<Batch>> ready_batches;
+    bool running{false};
+    std::thread dispatcher;
+
+    // USB thread only
+    std::unique_ptr<Batch> filling;
+
+    RxBatchStats counters{};
+    std::atomic<uint64_t> count_pool_exhausted{0};
+    std::atomic<uint64_t> count_oversized{0};
+};
@@ -0,0 +1,106 @@
+#include "RxChannelWorker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <utility>
+
+RxChannelWorker::RxChannelWorker(BatchHandler handler, size_t capacity)
+        : handler(std::move(handler)), capacity(capacity), arena(capacity * SLOT_SIZE), frames(capacity) {
+    for (size_t i = 0; i < capacity; ++i) {
+        frames[i].data = std::span<uint8_t>(arena.data() + i * SLOT_SIZE, 0);
+    }
+}
+
+RxChannelWorker::~RxChannelWorker() { stop(); }
+
+void RxChannelWorker::start() {
+    if (running.load()) return;
+    tail.store(head.load());
+    running.store(true);
+    worker = std::thread([this] { workLoop(); });
+}
+
+void RxChannelWorker::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running.store(false);
+    }
+    cv.notify_one();
+    if (worker.joinable()) worker.join();
+}
+
+bool RxChannelWorker::push(std::span<const uint8_t> frame, int channel, const int8_t rssi[2], const int8_t snr[2]) {
+    if (frame.size() > SLOT_SIZE) {
+        count_oversized.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    const uint64_t h = head.load(std::memory_order_relaxed);
+    const uint64_t depth = h - tail.load(std::memory_order_acquire);
+    if (depth >= capacity) {
+        count_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    RxBatchFrame &slot = frames[h % capacity];
+    std::memcpy(slot.data.data(), frame.data(), frame.size());
+    slot.data = std::span<uint8_t>(slot.data.data(), frame.size());
+    slot.channel = channel;
+    slot.rssi[0] = rssi[0];
+    slot.rssi[1] = rssi[1];
+    slot.snr[0] = snr[0];
+    slot.snr[1] = snr[1];
+    slot.rx_time_ns = rx_time_now_ns();
+    // seq_cst pairs with the one in workLoop: either the worker sees the new head or we see it sleeping
+    head.store(h + 1, std::memory_order_seq_cst);
+
+    count_frames.fetch_add(1, std::memory_order_relaxed);
+    if (depth + 1 > count_max_depth.load(std::memory_order_relaxed)) {
+        count_max_depth.store(static_cast<uint32_t>(depth + 1), std::memory_order_relaxed);
+    }
+    if (sleeping.load(std::memory_order_seq_cst)) {
+        std::lock_guard<std::mutex> lock(mutex);
+        cv.notify_one();
+    }
+    return true;
+}
+
+void RxChannelWorker::workLoop() {
+    while (true) {
+        const uint64_t t = tail.load(std::memory_order_relaxed);
+        const uint64_t h = head.load(std::memory_order_acquire);
+        if (h == t) {
+            if (!running.load()) break; // stopped and drained
+            std::unique_lock<std::mutex> lock(mutex);
+            sleeping.store(true, std::memory_order_seq_cst);
+            // The timeout only bounds the damage of a missed notification, it's not needed for correctness
+            cv.wait_for(lock, std::chrono::milliseconds(100), [&] {
+                return head.load(std::memory_order_seq_cst) != t || !running.load();
+            });
+            sleeping.store(false, std::memory_order_relaxed);
+            continue;
+        }
+        // Contiguous run up to the end of the ring, the rest comes with the next iteration
+        const size_t first = t % capacity;
+        const size_t n = std::min<uint64_t>(h - t, capacity - first);
+        handler(std::span<const RxBatchFrame>(frames.data() + first, n));
+        tail.store(t + n, std::memory_order_release);
+    }
+}
+
+RxChannelStats RxChannelWorker::stats() const {
+    const uint64_t h = head.load(std::memory_order_acquire);
+    const uint64_t t = tail.load(std::memory_order_acquire);
+    return {count_frames.load(std::memory_order_relaxed),
+            count_dropped.load(std::memory_order_relaxed),
+            count_oversized.load(std::memory_order_relaxed),
+            static_cast<uint32_t>(h >= t ? h - t : 0),
+            count_max_depth.load(std::memory_order_relaxed)};
+}
+
+void RxChannelWorker::clear_stats() {
+    count_frames.store(0, std::memory_order_relaxed);
+    count_dropped.store(0, std::memory_order_relaxed);
+    count_oversized.store(0, std::memory_order_relaxed);
+    count_max_depth.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "RxBatcher.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+struct RxChannelStats {
+    uint64_t frames;
+    // Frames dropped because the queue was full, i.e. the aggregator can't keep up
+    uint64_t dropped;
+    // Frames dropped because they don't fit in a queue slot
+    uint64_t oversized;
+    // Frames waiting for the aggregator right now, and the highest value seen since clear_stats()
+    uint32_t depth;
+    uint32_t max_depth;
+};
+
+/**
+ * Runs the aggregator of one wfb channel (decrypt + FEC) on its own thread, fed from the USB RX callback through a
+ * bounded single producer / single consumer ring of fixed size slots.
+ *
+ * push() copies the frame into the next free slot and returns, it never allocates, never takes a lock while the
+ * worker is busy and never waits: a full queue drops the frame and counts it. The worker hands every contiguous run
+ * of queued frames to the handler as one span, so the handler signature is the one of RxBatcher.
+ */
+class RxChannelWorker {
+  public:
+    using BatchHandler = RxBatcher::BatchHandler;
+
+    // Largest 802.11 frame the RTL8812AU hands us for a wfb packet, FCS included
+    static constexpr size_t SLOT_SIZE = 4096;
+
+    RxChannelWorker(BatchHandler handler, size_t capacity);
+    ~RxChannelWorker();
+
+    RxChannelWorker(const RxChannelWorker &) = delete;
+    RxChannelWorker &operator=(const RxChannelWorker &) = delete;
+
+    // start() discards frames left over from a previous session
+    void start();
+    // Processes whatever is still queued, then joins the worker thread
+    void stop();
+
+    // Producer side, called from the USB RX thread only
+    bool push(std::span<const uint8_t> frame, int channel, const int8_t rssi[2], const int8_t snr[2]);
+
+    RxChannelStats stats() const;
+    void clear_stats();
+
+  private:
+    void workLoop();
+
+    const BatchHandler handler;
+    const size_t capacity;
+
+    std::vector<uint8_t> arena;
+    // frames[i].data always points at slot i of the arena, only its size changes
+    std::vector<RxBatchFrame> frames;
+
+    // Monotonic positions, slot = position % capacity. head is written by the producer, tail by the worker.
+    alignas(64) std::atomic<uint64_t> head{0};
+    alignas(64) std::atomic<uint64_t> tail{0};
+
+    // The worker only sleeps on the condition variable when the queue is empty; the producer takes the mutex only
+    // when the worker announced it is going to sleep
+    std::atomic<bool> sleeping{false};
+    std::atomic<bool> running{false};
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::thread worker;
+
+    std::atomic<uint64_t> count_frames{0};
+    std::atomic<uint64_t> count_dropped{0};
+    std::atomic<uint64_t> count_oversized{0};
+    std::atomic<uint32_t> count_max_depth{0};
+};
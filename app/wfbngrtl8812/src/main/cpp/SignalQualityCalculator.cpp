@@ -21,62 +21,19 @@ std::string generate_random_string(size_t length) {
 
 } // namespace
 
-// Remove RSSI samples older than 1 second
-void SignalQualityCalculator::cleanup_old_rssi_data() {
-    auto now = std::chrono::steady_clock::now();
-    auto cutoff = now - kAveragingWindow;
-
-    // Erase-remove idiom for data older than cutoff
-    m_rssis.erase(std::remove_if(
-                      m_rssis.begin(), m_rssis.end(), [&](const RssiEntry &entry) { return entry.timestamp < cutoff; }),
-                  m_rssis.end());
-}
-
-void SignalQualityCalculator::cleanup_old_snr_data() {
-    auto now = std::chrono::steady_clock::now();
-    auto cutoff = now - kAveragingWindow;
-
-    // Erase-remove idiom for data older than cutoff
-    m_snrs.erase(
-        std::remove_if(m_snrs.begin(), m_snrs.end(), [&](const SnrEntry &entry) { return entry.timestamp < cutoff; }),
-        m_snrs.end());
-}
-
-void SignalQualityCalculator::cleanup_old_fec_data() {
-    auto now = std::chrono::steady_clock::now();
-    auto cutoff = now - kAveragingWindow;
-
-    m_fec_data.erase(std::remove_if(m_fec_data.begin(),
-                                    m_fec_data.end(),
-                                    [&](const FecEntry &entry) { return entry.timestamp < cutoff; }),
-                     m_fec_data.end());
-}
-
-// Add a new RSSI entry with current timestamp
 void SignalQualityCalculator::add_rssi(uint8_t ant1, uint8_t ant2) {
     //__android_log_print(ANDROID_LOG_WARN, TAG, "rssi1 %d, rssi2 %d", (int)ant1, (int)ant2);
-    std::lock_guard<std::recursive_mutex> lock(m_mutex);
-    RssiEntry entry;
-    entry.timestamp = std::chrono::steady_clock::now();
-    entry.ant1 = ant1;
-    entry.ant2 = ant2;
-    m_rssis.push_back(entry);
+    m_rssis.add({ant1, ant2});
 }
 
 void SignalQualityCalculator::add_snr(int8_t ant1, int8_t ant2) {
     //__android_log_print(ANDROID_LOG_WARN, TAG, "rssi1 %d, rssi2 %d", (int)ant1, (int)ant2);
-    std::lock_guard<std::recursive_mutex> lock(m_mutex);
-    SnrEntry entry;
-    entry.timestamp = std::chrono::steady_clock::now();
-    entry.ant1 = ant1;
-    entry.ant2 = ant2;
-    m_snrs.push_back(entry);
+    m_snrs.add({ant1, ant2});
 }
 
 // Calculate signal quality based on last-second RSSI and FEC data
 SignalQualityCalculator::SignalQuality SignalQualityCalculator::calculate_signal_quality() {
     SignalQuality ret;
-    std::lock_guard<std::recursive_mutex> lock(m_mutex);
 
     // Get fresh averages over the last second
     float avg_rssi = get_avg(m_rssis);
@@ -104,11 +61,10 @@ SignalQualityCalculator::SignalQuality SignalQualityCalculator::calculate_signal
     ret.recovered_last_second = p_recovered;
 
     ret.snr = avg_snr;
-    ret.idr_code = m_idr_code;
-
-    cleanup_old_rssi_data();
-    cleanup_old_snr_data();
-    cleanup_old_fec_data();
+    {
+        std::lock_guard<std::mutex> lock(m_idr_mutex);
+        ret.idr_code = m_idr_code;
+    }
 
     /* __android_log_print(ANDROID_LOG_DEBUG,
                          TAG,
@@ -123,37 +79,25 @@ SignalQualityCalculator::SignalQuality SignalQualityCalculator::calculate_signal
 
 // Sum up FEC data over the last 1 second
 std::pair<uint32_t, uint32_t> SignalQualityCalculator::get_accumulated_fec_data() {
-    // Make sure we clean up old FEC data first
-    cleanup_old_fec_data();
+    auto fec = m_fec_data.aggregate();
+    if (fec.count == 0) return {300, 300};
 
-    if (m_fec_data.empty()) return {300, 300};
+    //    __android_log_print(ANDROID_LOG_ERROR, "LOST size", "%u", fec.count);
 
-    //    __android_log_print(ANDROID_LOG_ERROR, "LOST size", "%zu", m_fec_data.size());
-
-    uint32_t p_recovered = 0;
-    uint32_t p_all = 0;
-    uint32_t p_lost = 0;
-    for (const auto &data : m_fec_data) {
-        p_all += data.all;
-        p_recovered += data.recovered;
-        p_lost += data.lost;
-    }
-    return {p_recovered, p_lost};
+    return {static_cast<uint32_t>(fec.sum[1]), static_cast<uint32_t>(fec.sum[2])};
 }
 
 // Add new FEC data entry with current timestamp
 void SignalQualityCalculator::add_fec_data(uint32_t p_all, uint32_t p_recovered, uint32_t p_lost) {
     //    __android_log_print(ANDROID_LOG_ERROR, "RECOVERED + LOST", "%u + %u", p_recovered, p_lost);
-    std::lock_guard<std::recursive_mutex> lock(m_mutex);
-    FecEntry entry;
-    entry.timestamp = std::chrono::steady_clock::now();
-    entry.all = p_all;
-    entry.recovered = p_recovered;
-    entry.lost = p_lost;
-
     if (p_lost > 0) {
-        m_idr_code = generate_random_string(4);
+        request_idr();
     }
 
-    m_fec_data.push_back(entry);
+    m_fec_data.add({static_cast<int32_t>(p_all), static_cast<int32_t>(p_recovered), static_cast<int32_t>(p_lost)});
+}
+
+void SignalQualityCalculator::request_idr() {
+    std::lock_guard<std::mutex> lock(m_idr_mutex);
+    m_idr_code = generate_random_string(4);
 }
@@ -4,8 +4,10 @@
 #include <chrono>
 #include <cstdint>
 #include <mutex>
+#include <string>
 #include <utility>
-#include <vector>
+
+#include "TimeBucketedWindow.h"
 
 // Adjust as needed
 static const char *TAG = "SignalQualityCalculator";
@@ -23,34 +25,21 @@ class SignalQualityCalculator {
     SignalQualityCalculator() = default;
     ~SignalQualityCalculator() = default;
 
+    // Called for every video packet from the RX thread, lock-free
     void add_rssi(uint8_t ant1, uint8_t ant2);
 
     void add_snr(int8_t ant1, int8_t ant2);
 
     void add_fec_data(uint32_t p_all, uint32_t p_recovered, uint32_t p_lost);
 
-    template <class T> float get_avg(const T &array) {
-        std::lock_guard<std::recursive_mutex> lock(m_mutex);
-
-        // Remove old entries
-        cleanup_old_rssi_data();
-
-        float sum1 = 0.f;
-        float sum2 = 0.f;
-        int count = static_cast<int>(array.size());
-
-        if (count > 0) {
-            for (auto &entry : array) {
-                sum1 += entry.ant1;
-                sum2 += entry.ant2;
-            }
-            sum1 /= count;
-            sum2 /= count;
-        }
+    // New idr_code, the air unit sends one keyframe per code it hasn't seen yet
+    void request_idr();
 
-        // We'll take the maximum of the two average RSSI values
-        float avg = std::max(sum1, sum2);
-        return avg;
+    // Average of the best antenna over the last second
+    template <size_t N> static float get_avg(const TimeBucketedWindow<N> &window) {
+        auto agg = window.aggregate();
+        // We'll take the maximum of the two average values
+        return std::max(agg.avg(0), agg.avg(1));
     }
 
     SignalQuality calculate_signal_quality();
@@ -63,46 +52,19 @@ class SignalQualityCalculator {
   private:
     std::pair<uint32_t, uint32_t> get_accumulated_fec_data();
 
-    // Helper methods to remove old entries
-    void cleanup_old_rssi_data();
-    void cleanup_old_snr_data();
-    void cleanup_old_fec_data();
-
-    // We store a timestamp for each RSSI entry
-    struct RssiEntry {
-        std::chrono::steady_clock::time_point timestamp;
-        uint8_t ant1;
-        uint8_t ant2;
-    };
-
-    // We store a timestamp for each RSSI entry
-    struct SnrEntry {
-        std::chrono::steady_clock::time_point timestamp;
-        int8_t ant1;
-        int8_t ant2;
-    };
-
-    // We store a timestamp for each FEC entry
-    struct FecEntry {
-        std::chrono::steady_clock::time_point timestamp;
-        uint32_t all;
-        uint32_t recovered;
-        uint32_t lost;
-    };
-
     double map_range(double value, double inputMin, double inputMax, double outputMin, double outputMax) {
         return outputMin + ((value - inputMin) * (outputMax - outputMin) / (inputMax - inputMin));
     }
 
   private:
-    const std::chrono::seconds kAveragingWindow{std::chrono::seconds(1)};
-    mutable std::recursive_mutex m_mutex;
-
-    std::vector<RssiEntry> m_rssis;
-
-    std::vector<SnrEntry> m_snrs;
-
-    std::vector<FecEntry> m_fec_data;
-
+    // 100 ms buckets over a 1 second window. Each window has a single writer:
+    // RSSI/SNR the RX thread, FEC the stats callback.
+    TimeBucketedWindow<2> m_rssis;
+    TimeBucketedWindow<2> m_snrs;
+    // all, recovered, lost
+    TimeBucketedWindow<3> m_fec_data;
+
+    // Only touched by the stats callback, keyframe requests and the adaptive link thread, never on the RX path
+    std::mutex m_idr_mutex;
     std::string m_idr_code{"aaaa"};
 };
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+/**
+ * Sliding window of N integer series (e.g. one per antenna), kept as running count/sum/min/max in fixed time
+ * buckets on a ring. Insertion is O(1), never allocates and never locks; reading the window touches
+ * WINDOW_BUCKETS buckets regardless of the sample rate.
+ *
+ * There must be a single writer thread per window. Readers may run on any thread: each bucket is guarded by a
+ * sequence counter, a reader that races with the writer simply retries that bucket.
+ */
+template <size_t N, int64_t BUCKET_MS = 100, size_t WINDOW_BUCKETS = 10> class TimeBucketedWindow {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Aggregate {
+        uint32_t count{0};
+        std::array<int64_t, N> sum{};
+        std::array<int32_t, N> min{};
+        std::array<int32_t, N> max{};
+
+        float avg(size_t i) const { return count ? static_cast<float>(sum[i]) / count : 0.f; }
+    };
+
+    static constexpr std::chrono::milliseconds window() { return std::chrono::milliseconds(BUCKET_MS * WINDOW_BUCKETS); }
+
+    // Writer side
+    void add(const std::array<int32_t, N> &values, Clock::time_point now = Clock::now()) {
+        const int64_t index = bucketIndex(now);
+        Bucket &b = buckets[index & RING_MASK];
+
+        const uint32_t seq = b.seq.load(std::memory_order_relaxed);
+        b.seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        if (b.index.load(std::memory_order_relaxed) != index) {
+            // Bucket is recycled from a previous lap of the ring
+            b.count.store(0, std::memory_order_relaxed);
+            for (size_t i = 0; i < N; ++i) {
+                b.sum[i].store(0, std::memory_order_relaxed);
+                b.min[i].store(std::numeric_limits<int32_t>::max(), std::memory_order_relaxed);
+                b.max[i].store(std::numeric_limits<int32_t>::min(), std::memory_order_relaxed);
+            }
+            b.index.store(index, std::memory_order_relaxed);
+        }
+        b.count.store(b.count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        for (size_t i = 0; i < N; ++i) {
+            const int32_t v = values[i];
+            b.sum[i].store(b.sum[i].load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+            if (v < b.min[i].load(std::memory_order_relaxed)) b.min[i].store(v, std::memory_order_relaxed);
+            if (v > b.max[i].load(std::memory_order_relaxed)) b.max[i].store(v, std::memory_order_relaxed);
+        }
+
+        b.seq.store(seq + 2, std::memory_order_release);
+    }
+
+    // Reader side, aggregate over the last window() (the current bucket included)
+    Aggregate aggregate(Clock::time_point now = Clock::now()) const {
+        Aggregate result;
+        result.min.fill(std::numeric_limits<int32_t>::max());
+        result.max.fill(std::numeric_limits<int32_t>::min());
+        const int64_t newest = bucketIndex(now);
+
+        for (const Bucket &b : buckets) {
+            Aggregate snapshot;
+            int64_t index;
+            uint32_t seq1, seq2;
+            do {
+                seq1 = b.seq.load(std::memory_order_acquire);
+                index = b.index.load(std::memory_order_relaxed);
+                snapshot.count = b.count.load(std::memory_order_relaxed);
+                for (size_t i = 0; i < N; ++i) {
+                    snapshot.sum[i] = b.sum[i].load(std::memory_order_relaxed);
+                    snapshot.min[i] = b.min[i].load(std::memory_order_relaxed);
+                    snapshot.max[i] = b.max[i].load(std::memory_order_relaxed);
+                }
+                std::atomic_thread_fence(std::memory_order_acquire);
+                seq2 = b.seq.load(std::memory_order_relaxed);
+            } while ((seq1 & 1) || seq1 != seq2);
+
+            if (index > newest - static_cast<int64_t>(WINDOW_BUCKETS) && index <= newest && snapshot.count > 0) {
+                result.count += snapshot.count;
+                for (size_t i = 0; i < N; ++i) {
+                    result.sum[i] += snapshot.sum[i];
+                    if (snapshot.min[i] < result.min[i]) result.min[i] = snapshot.min[i];
+                    if (snapshot.max[i] > result.max[i]) result.max[i] = snapshot.max[i];
+                }
+            }
+        }
+        if (result.count == 0) {
+            result.min.fill(0);
+            result.max.fill(0);
+        }
+        return result;
+    }
+
+  private:
+    // Power of two larger than the window, so the writer never recycles a bucket a reader still wants
+    static constexpr size_t RING_SIZE = [] {
+        size_t n = 1;
+        while (n <= WINDOW_BUCKETS) n <<= 1;
+        return n;
+    }();
+    static constexpr int64_t RING_MASK = RING_SIZE - 1;
+
+    static int64_t bucketIndex(Clock::time_point t) {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(t.time_since_epoch()).count() / BUCKET_MS;
+    }
+
+    struct alignas(64) Bucket {
+        std::atomic<uint32_t> seq{0};
+        std::atomic<int64_t> index{-1};
+        std::atomic<uint32_t> count{0};
+        std::array<std::atomic<int64_t>, N> sum{};
+        std::array<std::atomic<int32_t>, N> min{};
+        std::array<std::atomic<int32_t>, N> max{};
+    };
+
+    std::array<Bucket, RING_SIZE> buckets{};
+};
@@ -46,7 +46,8 @@ constexpr char *TAG = "TXFrame";
 
 Transmitter::Transmitter(int k, int n, const std::string &keypair, uint64_t epoch, uint32_t channelId)
         : fecPtr_(nullptr, FecDeleter{}), fecK_(k), fecN_(n), blockIndex_(0), fragmentIndex_(0),
-          block_(static_cast<size_t>(n)), maxPacketSize_(0), epoch_(epoch), channelId_(channelId) {
+          blockArena_(new FecFragment[n]), block_(static_cast<size_t>(n)), fragmentSize_(static_cast<size_t>(k), 0),
+          maxPacketSize_(0), epoch_(epoch), channelId_(channelId) {
     // Create new fec object
     fec_t *rawFec;
     fec_new(fecK_, fecN_, &rawFec);
@@ -55,10 +56,9 @@ Transmitter::Transmitter(int k, int n, const std::string &keypair, uint64_t epoc
     }
     fecPtr_.reset(rawFec);
 
-    // Allocate block buffers
+    // Fragments are only zero padded (up to the largest packet of the block) when parity is computed
     for (int i = 0; i < fecN_; ++i) {
-        block_[i] = std::unique_ptr<uint8_t[]>(new uint8_t[MAX_FEC_PAYLOAD]);
-        std::memset(block_[i].get(), 0, MAX_FEC_PAYLOAD);
+        block_[i] = blockArena_[i].data;
     }
 
     // Read keypair from file
@@ -82,7 +82,7 @@ Transmitter::Transmitter(int k, int n, const std::string &keypair, uint64_t epoc
 }
 
 Transmitter::~Transmitter() {
-    // block_, fecPtr_ automatically cleaned up via unique_ptr
+    // blockArena_, fecPtr_ automatically cleaned up via unique_ptr
 }
 
 bool Transmitter::sendPacket(const uint8_t *buf, size_t size, uint8_t flags) {
@@ -97,23 +97,19 @@ bool Transmitter::sendPacket(const uint8_t *buf, size_t size, uint8_t flags) {
     }
 
     // Write header
-    auto *packetHdr = reinterpret_cast<wpacket_hdr_t *>(block_[fragmentIndex_].get());
+    auto *packetHdr = reinterpret_cast<wpacket_hdr_t *>(block_[fragmentIndex_]);
     packetHdr->flags = flags;
     packetHdr->packet_size = htons(static_cast<uint16_t>(size));
 
     // Copy payload
-    std::memcpy(block_[fragmentIndex_].get() + sizeof(wpacket_hdr_t), buf, size);
-
-    // Zero out the remainder
-    size_t totalHdrSize = sizeof(wpacket_hdr_t);
-    if ((totalHdrSize + size) < MAX_FEC_PAYLOAD) {
-        std::memset(block_[fragmentIndex_].get() + totalHdrSize + size, 0, MAX_FEC_PAYLOAD - (totalHdrSize + size));
-    }
+    std::memcpy(block_[fragmentIndex_] + sizeof(wpacket_hdr_t), buf, size);
 
     // Send this fragment
+    size_t totalHdrSize = sizeof(wpacket_hdr_t);
     sendBlockFragment(totalHdrSize + size);
 
     // Track largest data size in block
+    fragmentSize_[fragmentIndex_] = totalHdrSize + size;
     maxPacketSize_ = std::max(maxPacketSize_, totalHdrSize + size);
     fragmentIndex_++;
 
@@ -123,10 +119,8 @@ bool Transmitter::sendPacket(const uint8_t *buf, size_t size, uint8_t flags) {
     }
 
     // If we have k fragments, encode the parity
-    fec_encode_simd(fecPtr_.get(),
-                    const_cast<const uint8_t **>(reinterpret_cast<uint8_t **>(block_.data())),
-                    reinterpret_cast<uint8_t **>(block_.data()) + fecK_,
-                    maxPacketSize_);
+    padFragments();
+    fec_encode_simd(fecPtr_.get(), const_cast<const uint8_t **>(block_.data()), block_.data() + fecK_, maxPacketSize_);
 
     // Send all FEC fragments
     while (fragmentIndex_ < static_cast<uint8_t>(fecN_)) {
@@ -148,12 +142,20 @@ bool Transmitter::sendPacket(const uint8_t *buf, size_t size, uint8_t flags) {
     return true;
 }
 
+void Transmitter::padFragments() {
+    // Parity covers maxPacketSize_ bytes of every data fragment, only the tail past each packet needs zeroing
+    for (int i = 0; i < fecK_; ++i) {
+        if (fragmentSize_[i] < maxPacketSize_) {
+            std::memset(block_[i] + fragmentSize_[i], 0, maxPacketSize_ - fragmentSize_[i]);
+        }
+    }
+}
+
 void Transmitter::sendSessionKey() { injectPacket(sessionKeyPacket_, sizeof(sessionKeyPacket_)); }
 
 void Transmitter::sendBlockFragment(size_t packetSize) {
-    // Prepare local buffer for encryption
-    uint8_t cipherBuf[MAX_FORWARDER_PACKET_SIZE];
-    std::memset(cipherBuf, 0, sizeof(cipherBuf));
+    // The header is written completely and the ciphertext follows it, no need to clear the buffer
+    uint8_t *cipherBuf = fragmentBuffer();
 
     auto *blockHdr = reinterpret_cast<wblock_hdr_t *>(cipherBuf);
     blockHdr->packet_type = WFB_PACKET_DATA;
@@ -164,7 +166,7 @@ void Transmitter::sendBlockFragment(size_t packetSize) {
     // AEAD encrypt
     int rc = crypto_aead_chacha20poly1305_encrypt(cipherBuf + sizeof(wblock_hdr_t),
                                                   &cipherLen,
-                                                  block_[fragmentIndex_].get(),
+                                                  block_[fragmentIndex_],
                                                   packetSize,
                                                   reinterpret_cast<const uint8_t *>(blockHdr),
                                                   sizeof(wblock_hdr_t),
@@ -220,7 +222,14 @@ RawSocketTransmitter::RawSocketTransmitter(int k,
                                            size_t radiotapHeaderLen,
                                            uint8_t frameType)
         : Transmitter(k, n, keypair, epoch, channelId), channelId_(channelId), currentOutput_(0), ieee80211Sequence_(0),
-          radiotapHeader_(std::move(radiotapHeader)), radiotapHeaderLen_(radiotapHeaderLen), frameType_(frameType) {
+          antennaStat_(wlans.size()), radiotapHeader_(std::move(radiotapHeader)), radiotapHeaderLen_(radiotapHeaderLen),
+          frameType_(frameType) {
+    std::memcpy(ieeeHdr_, ieee80211_header, sizeof(ieee80211_header));
+    ieeeHdr_[0] = frameType_;
+    uint32_t channelIdBE = htonl(channelId_);
+    std::memcpy(ieeeHdr_ + SRC_MAC_THIRD_BYTE, &channelIdBE, sizeof(uint32_t));
+    std::memcpy(ieeeHdr_ + DST_MAC_THIRD_BYTE, &channelIdBE, sizeof(uint32_t));
+
     // Create raw sockets and bind to specified interfaces
     for (const auto &iface : wlans) {
         int fd = ::socket(PF_PACKET, SOCK_RAW, 0);
@@ -272,18 +281,9 @@ void RawSocketTransmitter::injectPacket(const uint8_t *buf, size_t size) {
         throw std::runtime_error("RawSocketTransmitter::injectPacket - packet too large");
     }
 
-    // Build 802.11 header
-    uint8_t ieeeHdr[sizeof(ieee80211_header)];
-    std::memcpy(ieeeHdr, ieee80211_header, sizeof(ieee80211_header));
-
-    // Patch the Frame Control field, channel ID, and seq number
-    ieeeHdr[0] = frameType_;
-    uint32_t channelIdBE = htonl(channelId_);
-    std::memcpy(ieeeHdr + SRC_MAC_THIRD_BYTE, &channelIdBE, sizeof(uint32_t));
-    std::memcpy(ieeeHdr + DST_MAC_THIRD_BYTE, &channelIdBE, sizeof(uint32_t));
-
-    ieeeHdr[FRAME_SEQ_LB] = static_cast<uint8_t>(ieee80211Sequence_ & 0xff);
-    ieeeHdr[FRAME_SEQ_HB] = static_cast<uint8_t>((ieee80211Sequence_ >> 8) & 0xff);
+    // Patch the seq number into the header template
+    ieeeHdr_[FRAME_SEQ_LB] = static_cast<uint8_t>(ieee80211Sequence_ & 0xff);
+    ieeeHdr_[FRAME_SEQ_HB] = static_cast<uint8_t>((ieee80211Sequence_ >> 8) & 0xff);
     ieee80211Sequence_ += 16;
 
     // iovec for sendmsg
@@ -292,8 +292,8 @@ void RawSocketTransmitter::injectPacket(const uint8_t *buf, size_t size) {
 
     iov[0].iov_base = radiotapHeader_.get();
     iov[0].iov_len = radiotapHeaderLen_;
-    iov[1].iov_base = const_cast<uint8_t *>(ieeeHdr);
-    iov[1].iov_len = sizeof(ieeeHdr);
+    iov[1].iov_base = ieeeHdr_;
+    iov[1].iov_len = sizeof(ieeeHdr_);
     iov[2].iov_base = const_cast<uint8_t *>(buf);
     iov[2].iov_len = size;
 
@@ -312,8 +312,7 @@ void RawSocketTransmitter::injectPacket(const uint8_t *buf, size_t size) {
             throw std::runtime_error(string_format("Unable to inject packet: %s", std::strerror(errno)));
         }
 
-        uint64_t key = (static_cast<uint64_t>(currentOutput_) << 8) | 0xff;
-        antennaStat_[key].logLatency(get_time_us() - startUs, success, static_cast<uint32_t>(size));
+        antennaStat_.at(currentOutput_).logLatency(get_time_us() - startUs, success, static_cast<uint32_t>(size));
     } else {
         // Mirror mode: send on all interfaces
         for (size_t i = 0; i < sockFds_.size(); i++) {
@@ -324,23 +323,25 @@ void RawSocketTransmitter::injectPacket(const uint8_t *buf, size_t size) {
             if (rc < 0 && errno != ENOBUFS) {
                 throw std::runtime_error(string_format("Unable to inject packet: %s", std::strerror(errno)));
             }
-            uint64_t key = (static_cast<uint64_t>(i) << 8) | 0xff;
-            antennaStat_[key].logLatency(get_time_us() - startUs, success, static_cast<uint32_t>(size));
+            antennaStat_.at(static_cast<int>(i))
+                .logLatency(get_time_us() - startUs, success, static_cast<uint32_t>(size));
         }
     }
 }
 
 void RawSocketTransmitter::dumpStats(
     FILE *fp, uint64_t ts, uint32_t &injectedPackets, uint32_t &droppedPackets, uint32_t &injectedBytes) {
-    for (auto &kv : antennaStat_) {
-        const auto &stats = kv.second;
+    auto &items = antennaStat_.items();
+    for (size_t idx = 0; idx < items.size(); ++idx) {
+        const auto &stats = items[idx];
         uint64_t countAll = stats.countPacketsInjected + stats.countPacketsDropped;
-        uint64_t avgLatency = (countAll == 0) ? 0 : (stats.latencySum / countAll);
+        if (countAll == 0) continue;
+        uint64_t avgLatency = stats.latencySum / countAll;
 
         fprintf(fp,
                 "%" PRIu64 "\tTX_ANT\t%" PRIx64 "\t%u:%u:%" PRIu64 ":%" PRIu64 ":%" PRIu64 "\n",
                 ts,
-                kv.first,
+                TxAntennaStat::key(idx),
                 stats.countPacketsInjected,
                 stats.countPacketsDropped,
                 stats.latencyMin,
@@ -351,7 +352,7 @@ void RawSocketTransmitter::dumpStats(
         droppedPackets += stats.countPacketsDropped;
         injectedBytes += stats.countBytesInjected;
     }
-    antennaStat_.clear();
+    antennaStat_.reset();
 }
 
 //-------------------------------------------------------------
@@ -424,24 +425,35 @@ UsbTransmitter::UsbTransmitter(int k,
                                uint8_t frameType,
                                Rtl8812aDevice *device)
         : Transmitter(k, n, keypair, epoch, channelId), channelId_(channelId), currentOutput_(0), ieee80211Sequence_(0),
-          radiotapHeader_(radiotapHeader), radiotapHeaderLen_(radiotapHeaderLen), frameType_(frameType),
-          rtlDevice_(device) {
+          antennaStat_(1), frameType_(frameType), rtlDevice_(device),
+          headersLen_(radiotapHeaderLen + sizeof(ieee80211_header)),
+          frame_(new uint8_t[headersLen_ + MAX_FORWARDER_PACKET_SIZE]) {
     (void)wlans; // Not used directly here
+
+    std::memcpy(frame_.get(), radiotapHeader, radiotapHeaderLen);
+    uint8_t *ieeeHdr = frame_.get() + radiotapHeaderLen;
+    std::memcpy(ieeeHdr, ieee80211_header, sizeof(ieee80211_header));
+    ieeeHdr[0] = frameType_;
+    uint32_t channelIdBE = htonl(channelId_);
+    std::memcpy(ieeeHdr + SRC_MAC_THIRD_BYTE, &channelIdBE, sizeof(uint32_t));
+    std::memcpy(ieeeHdr + DST_MAC_THIRD_BYTE, &channelIdBE, sizeof(uint32_t));
 }
 
 void UsbTransmitter::dumpStats(
     FILE *fp, uint64_t ts, uint32_t &injectedPackets, uint32_t &droppedPackets, uint32_t &injectedBytes) {
-    for (auto &kv : antennaStat_) {
-        const auto &stats = kv.second;
+    auto &items = antennaStat_.items();
+    for (size_t idx = 0; idx < items.size(); ++idx) {
+        const auto &stats = items[idx];
         uint64_t countAll = stats.countPacketsInjected + stats.countPacketsDropped;
-        uint64_t avgLatency = (countAll == 0) ? 0 : (stats.latencySum / countAll);
+        if (countAll == 0) continue;
+        uint64_t avgLatency = stats.latencySum / countAll;
 
 #ifdef __ANDROID__
         __android_log_print(ANDROID_LOG_INFO,
                             TAG,
                             "%" PRIu64 "\tTX_ANT\t%" PRIx64 "\t%u:%u:%" PRIu64 ":%" PRIu64 ":%" PRIu64 "\n",
                             ts,
-                            kv.first,
+                            TxAntennaStat::key(idx),
                             stats.countPacketsInjected,
                             stats.countPacketsDropped,
                             stats.latencyMin,
@@ -451,7 +463,7 @@ void UsbTransmitter::dumpStats(
         fprintf(fp,
                 "%" PRIu64 "\tTX_ANT\t%" PRIx64 "\t%u:%u:%" PRIu64 ":%" PRIu64 ":%" PRIu64 "\n",
                 ts,
-                kv.first,
+                TxAntennaStat::key(idx),
                 stats.countPacketsInjected,
                 stats.countPacketsDropped,
                 stats.latencyMin,
@@ -463,7 +475,7 @@ void UsbTransmitter::dumpStats(
         droppedPackets += stats.countPacketsDropped;
         injectedBytes += stats.countBytesInjected;
     }
-    antennaStat_.clear();
+    antennaStat_.reset();
 }
 
 void UsbTransmitter::injectPacket(const uint8_t *buf, size_t size) {
@@ -478,37 +490,27 @@ void UsbTransmitter::injectPacket(const uint8_t *buf, size_t size) {
         throw std::runtime_error("UsbTransmitter::injectPacket - packet too large");
     }
 
-    uint8_t ieeeHdr[sizeof(ieee80211_header)];
-    std::memcpy(ieeeHdr, ieee80211_header, sizeof(ieee80211_header));
-
-    // Patch frame type
-    ieeeHdr[0] = frameType_;
-    uint32_t channelIdBE = htonl(channelId_);
-    std::memcpy(ieeeHdr + SRC_MAC_THIRD_BYTE, &channelIdBE, sizeof(uint32_t));
-    std::memcpy(ieeeHdr + DST_MAC_THIRD_BYTE, &channelIdBE, sizeof(uint32_t));
+    // Data fragments are already encrypted into the payload area (see fragmentBuffer()), only the session key
+    // packet has to be copied
+    uint8_t *payload = frame_.get() + headersLen_;
+    if (buf != payload) {
+        std::memcpy(payload, buf, size);
+    }
 
+    uint8_t *ieeeHdr = payload - sizeof(ieee80211_header);
     ieeeHdr[FRAME_SEQ_LB] = static_cast<uint8_t>(ieee80211Sequence_ & 0xff);
     ieeeHdr[FRAME_SEQ_HB] = static_cast<uint8_t>((ieee80211Sequence_ >> 8) & 0xff);
     ieee80211Sequence_ += 16;
 
     uint64_t startUs = get_time_us();
 
-    // Merge into one contiguous buffer
-    size_t totalSize = radiotapHeaderLen_ + sizeof(ieeeHdr) + size;
-    std::unique_ptr<uint8_t[]> buffer(new uint8_t[totalSize]);
-
-    std::memcpy(buffer.get(), radiotapHeader_, radiotapHeaderLen_);
-    std::memcpy(buffer.get() + radiotapHeaderLen_, ieeeHdr, sizeof(ieeeHdr));
-    std::memcpy(buffer.get() + radiotapHeaderLen_ + sizeof(ieeeHdr), buf, size);
-
-    bool result = static_cast<bool>(rtlDevice_->send_packet(buffer.get(), totalSize));
+    bool result = static_cast<bool>(rtlDevice_->send_packet(frame_.get(), headersLen_ + size));
 
 #ifdef __ANDROID__
 //    __android_log_print(ANDROID_LOG_DEBUG, TAG, "send_packet res:%d", result);
 #endif
 
-    uint64_t key = (static_cast<uint64_t>(currentOutput_) << 8) | 0xff;
-    antennaStat_[key].logLatency(get_time_us() - startUs, result, static_cast<uint32_t>(size));
+    antennaStat_.at(currentOutput_).logLatency(get_time_us() - startUs, result, static_cast<uint32_t>(size));
 }
 
 //-------------------------------------------------------------
@@ -31,7 +31,7 @@ extern "C" {
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
-#include <unordered_map>
+#include <vector>
 
 //// For Android logging
 // #ifdef __ANDROID__
@@ -125,8 +125,18 @@ class Transmitter {
      */
     virtual void injectPacket(const uint8_t *buf, size_t size) = 0;
 
+    /**
+     * @brief Buffer of at least MAX_FORWARDER_PACKET_SIZE bytes in which each encrypted fragment is assembled
+     *        before it is passed to injectPacket().
+     *
+     * Derived classes may return the payload area of their own preassembled frame, so the fragment is built right
+     * behind the radio headers and injectPacket() doesn't have to copy it.
+     */
+    virtual uint8_t *fragmentBuffer() { return fragmentBuf_; }
+
   private:
     void sendBlockFragment(size_t packetSize);
+    void padFragments();
     void makeSessionKey();
 
   private:
@@ -135,10 +145,20 @@ class Transmitter {
     const unsigned short int fecK_;
     const unsigned short int fecN_;
 
+    // One FEC fragment (wpacket_hdr_t + payload, zero padded when parity is computed). Cache line aligned for the
+    // SIMD FEC encoder.
+    struct alignas(64) FecFragment {
+        uint8_t data[(MAX_FEC_PAYLOAD + 63) / 64 * 64];
+    };
+
     // Per-block counters
     uint64_t blockIndex_;
     uint8_t fragmentIndex_;
-    std::vector<std::unique_ptr<uint8_t[]>> block_;
+    // All n fragments of the block live in one arena, block_[i] points at fragment i
+    std::unique_ptr<FecFragment[]> blockArena_;
+    std::vector<uint8_t *> block_;
+    // Bytes written to each data fragment, the rest of the fragment is stale until padFragments()
+    std::vector<size_t> fragmentSize_;
     size_t maxPacketSize_;
 
     // Session properties
@@ -152,6 +172,9 @@ class Transmitter {
 
     // Session key packet buffer: header + data + Mac
     uint8_t sessionKeyPacket_[sizeof(wsession_hdr_t) + sizeof(wsession_data_t) + crypto_box_MACBYTES];
+
+    // Default fragmentBuffer()
+    alignas(16) uint8_t fragmentBuf_[MAX_FORWARDER_PACKET_SIZE];
 };
 
 //-------------------------------------------------------------
@@ -198,8 +221,30 @@ class TxAntennaItem {
     uint64_t latencyMax;
 };
 
-/// Map: key = (antennaIndex << 8) | 0xff, value = TxAntennaItem
-using TxAntennaStat = std::unordered_map<uint64_t, TxAntennaItem>;
+/**
+ * @class TxAntennaStat
+ * @brief Per-output statistics indexed by antenna index.
+ *
+ * One slot per output is allocated up front and dumpStats() resets the slots instead of erasing them, so logging a
+ * packet never allocates.
+ */
+class TxAntennaStat {
+  public:
+    explicit TxAntennaStat(size_t outputs) : items_(std::max<size_t>(outputs, 1)) {}
+
+    /// Slot of an output, out of range indices (e.g. -1 for mirror mode) fall back to the first output
+    TxAntennaItem &at(int idx) { return items_[idx >= 0 && static_cast<size_t>(idx) < items_.size() ? idx : 0]; }
+
+    /// Key of an output in the TX_ANT stats line: (antennaIndex << 8) | 0xff
+    static uint64_t key(size_t idx) { return (static_cast<uint64_t>(idx) << 8) | 0xff; }
+
+    std::vector<TxAntennaItem> &items() { return items_; }
+
+    void reset() { std::fill(items_.begin(), items_.end(), TxAntennaItem()); }
+
+  private:
+    std::vector<TxAntennaItem> items_;
+};
 
 //-------------------------------------------------------------
 /**
@@ -240,6 +285,8 @@ class RawSocketTransmitter : public Transmitter {
     std::shared_ptr<uint8_t[]> radiotapHeader_;
     size_t radiotapHeaderLen_;
     uint8_t frameType_;
+    // 802.11 header with frame type and channel id filled in, only the sequence number changes per packet
+    uint8_t ieeeHdr_[sizeof(ieee80211_header)];
 };
 
 //-------------------------------------------------------------
@@ -306,15 +353,21 @@ class UsbTransmitter : public Transmitter {
   private:
     void injectPacket(const uint8_t *buf, size_t size) override;
 
+    uint8_t *fragmentBuffer() override { return frame_.get() + headersLen_; }
+
   private:
     const uint32_t channelId_;
     int currentOutput_;
     uint16_t ieee80211Sequence_;
     TxAntennaStat antennaStat_;
-    uint8_t *radiotapHeader_;
-    size_t radiotapHeaderLen_;
     uint8_t frameType_;
     Rtl8812aDevice *rtlDevice_;
+
+    // Preassembled frame: radiotap header, 802.11 header template, then room for MAX_FORWARDER_PACKET_SIZE bytes of
+    // payload. Fragments are encrypted straight into the payload area, per packet only the 802.11 sequence number is
+    // patched.
+    size_t headersLen_;
+    std::unique_ptr<uint8_t[]> frame_;
 };
 
 //-------------------------------------------------------------
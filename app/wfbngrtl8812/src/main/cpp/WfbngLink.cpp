@@ -1,17 +1,15 @@
 #include "WfbngLink.hpp"
 
-#include <android/asset_manager.h>
-#include <android/asset_manager_jni.h>
 #include <android/log.h>
 #include <jni.h>
 
-#include "RxFrame.h"
 #include "SignalQualityCalculator.h"
 #include "TxFrame.h"
 #include "libusb.h"
 #include "wfb-ng/src/wifibroadcast.hpp"
 
 #include <arpa/inet.h>
+#include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <cstring>
@@ -54,38 +52,117 @@ std::string generate_random_string(size_t length) {
 }
 
 WfbngLink::WfbngLink(JNIEnv *env, jobject context)
-        : current_fd(-1), adaptive_link_enabled(true), adaptive_tx_power(30) {
+        : current_fd(-1), adaptive_link_enabled(true), adaptive_tx_power(30),
+          channel_matcher({channel_id(wfb_video_port), channel_id(wfb_mavlink_port), channel_id(wfb_rx_port)}) {
     initAgg();
     Logger_t log;
     wifi_driver = std::make_unique<WiFiDriver>(log);
 }
 
 void WfbngLink::initAgg() {
+    std::lock_guard<std::mutex> lock(agg_init_mutex);
+    publishAggregators();
+}
+
+std::shared_ptr<const WfbngLink::AggregatorTable> WfbngLink::publishAggregators() {
     std::string client_addr = "127.0.0.1";
     uint64_t epoch = 0;
+    auto table = std::make_shared<AggregatorTable>();
 
-    uint8_t video_radio_port = 0;
-    uint32_t video_channel_id_f = (link_id << 8) + video_radio_port;
-    video_channel_id_be = htobe32(video_channel_id_f);
-    auto udsName = std::string("my_socket");
-
-    video_aggregator = std::make_unique<AggregatorUDPv4>(client_addr, 5600, keyPath, epoch, video_channel_id_f, 0);
+    uint32_t video_channel_id_f = channel_id(wfb_video_port);
+    if (video_sink != nullptr) {
+        auto video = std::make_unique<AggregatorInProcess>(video_sink, keyPath, epoch, video_channel_id_f);
+        table->video_in_process = video.get();
+        table->by_channel[RX_CHANNEL_VIDEO] = std::move(video);
+    } else {
+        table->by_channel[RX_CHANNEL_VIDEO] =
+            std::make_unique<AggregatorUDPv4>(client_addr, 5600, keyPath, epoch, video_channel_id_f, 0);
+    }
 
     int mavlink_client_port = 14550;
-    uint8_t mavlink_radio_port = 0x10;
-    uint32_t mavlink_channel_id_f = (link_id << 8) + mavlink_radio_port;
-    mavlink_channel_id_be = htobe32(mavlink_channel_id_f);
-
-    mavlink_aggregator =
+    uint32_t mavlink_channel_id_f = channel_id(wfb_mavlink_port);
+    table->by_channel[RX_CHANNEL_MAVLINK] =
         std::make_unique<AggregatorUDPv4>(client_addr, mavlink_client_port, keyPath, epoch, mavlink_channel_id_f, 0);
 
     int udp_client_port = 8000;
-    uint8_t udp_radio_port = wfb_rx_port;
-    uint32_t udp_channel_id_f = (link_id << 8) + udp_radio_port;
-    udp_channel_id_be = htobe32(udp_channel_id_f);
-
-    udp_aggregator =
+    uint32_t udp_channel_id_f = channel_id(wfb_rx_port);
+    table->by_channel[RX_CHANNEL_UDP] =
         std::make_unique<AggregatorUDPv4>(client_addr, udp_client_port, keyPath, epoch, udp_channel_id_f, 0);
+
+    // Unless the caller keeps it, the previous table is released by whoever drops the last reference, possibly the
+    // RX dispatcher
+    return std::atomic_exchange(&agg_table, std::shared_ptr<const AggregatorTable>(std::move(table)));
+}
+
+void WfbngLink::setVideoSink(const InProcessRtpSink *sink) {
+    std::shared_ptr<const AggregatorTable> previous;
+    {
+        std::lock_guard<std::mutex> lock(agg_init_mutex);
+        video_sink = sink;
+        previous = publishAggregators();
+    }
+    // The RX threads pin a table for one batch at most. Once they all let go of the previous one, nothing can reach
+    // the previous sink anymore and its owner may free it.
+    while (previous.use_count() > 1) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+}
+
+uint32_t WfbngLink::video_keyframe_requests() {
+    std::lock_guard<std::mutex> lock(agg_init_mutex);
+    if (video_sink == nullptr || video_sink->keyframe_requests == nullptr) return 0;
+    return video_sink->keyframe_requests(video_sink->opaque);
+}
+
+void WfbngLink::dispatchBatch(std::span<const RxBatchFrame> frames) {
+    // Pin the current table for the whole batch, a concurrent initAgg() only affects the next one
+    const std::shared_ptr<const AggregatorTable> table = aggregators();
+    if (!table) return;
+    uint32_t freq = 0;
+    int8_t noise[4] = {1, 1, 1, 1};
+    uint8_t antenna[4] = {1, 1, 1, 1};
+
+    for (const RxBatchFrame &f : frames) {
+        int8_t rssi[4] = {f.rssi[0], f.rssi[1], 1, 1};
+        const uint8_t *payload = f.data.data() + sizeof(ieee80211_header);
+        const size_t payload_size = f.data.size() - sizeof(ieee80211_header) - 4;
+        Aggregator *aggregator = table->by_channel[f.channel].get();
+
+        if (f.channel == RX_CHANNEL_VIDEO) {
+            SignalQualityCalculator::get_instance().add_rssi(f.rssi[0], f.rssi[1]);
+            SignalQualityCalculator::get_instance().add_snr(f.snr[0], f.snr[1]);
+            if (table->video_in_process != nullptr) table->video_in_process->set_rx_time(f.rx_time_ns);
+        }
+        aggregator->process_packet(payload, payload_size, 0, antenna, rssi, noise, freq, 0, 0, NULL);
+        if (f.channel == RX_CHANNEL_VIDEO && should_clear_stats) {
+            aggregator->clear_stats();
+            should_clear_stats = false;
+        }
+    }
+}
+
+void WfbngLink::startRxPipeline(bool channel_workers) {
+    const auto handler = [this](std::span<const RxBatchFrame> frames) { dispatchBatch(frames); };
+    // Created even with channel workers, the USB event thread flushes it without checking the mode
+    if (!rx_batcher) rx_batcher = std::make_unique<RxBatcher>(handler);
+    if (!channel_workers) {
+        rx_batcher->start();
+        return;
+    }
+    // Video bursts a whole FEC block at once, the other channels are a few packets per second
+    static constexpr std::array<size_t, RX_CHANNEL_COUNT> capacity = {512, 64, 64};
+    for (int channel = 0; channel < RX_CHANNEL_COUNT; ++channel) {
+        if (!rx_workers[channel]) rx_workers[channel] = std::make_unique<RxChannelWorker>(handler, capacity[channel]);
+        rx_workers[channel]->start();
+    }
+}
+
+void WfbngLink::stopRxPipeline() {
+    if (rx_batcher) rx_batcher->stop();
+    for (auto &worker : rx_workers) {
+        if (worker) worker->stop();
+    }
 }
 
 int WfbngLink::run(JNIEnv *env, jobject context, jint wifiChannel, jint bw, jint fd) {
@@ -122,65 +199,23 @@ int WfbngLink::run(JNIEnv *env, jobject context, jint wifiChannel, jint bw, jint
         return -1;
     }
 
-    uint8_t *video_channel_id_be8 = reinterpret_cast<uint8_t *>(&video_channel_id_be);
-    uint8_t *udp_channel_id_be8 = reinterpret_cast<uint8_t *>(&udp_channel_id_be);
-    uint8_t *mavlink_channel_id_be8 = reinterpret_cast<uint8_t *>(&mavlink_channel_id_be);
-
     try {
-        auto packetProcessor =
-            [this, video_channel_id_be8, mavlink_channel_id_be8, udp_channel_id_be8](const Packet &packet) {
-                RxFrame frame(packet.Data);
-                if (!frame.IsValidWfbFrame()) {
-                    return;
-                }
-                int8_t rssi[4] = {(int8_t)packet.RxAtrib.rssi[0], (int8_t)packet.RxAtrib.rssi[1], 1, 1};
-                uint32_t freq = 0;
-                int8_t noise[4] = {1, 1, 1, 1};
-                uint8_t antenna[4] = {1, 1, 1, 1};
-
-                std::lock_guard<std::mutex> lock(agg_mutex);
-                if (frame.MatchesChannelID(video_channel_id_be8)) {
-                    SignalQualityCalculator::get_instance().add_rssi(packet.RxAtrib.rssi[0], packet.RxAtrib.rssi[1]);
-                    SignalQualityCalculator::get_instance().add_snr(packet.RxAtrib.snr[0], packet.RxAtrib.snr[1]);
-
-                    video_aggregator->process_packet(packet.Data.data() + sizeof(ieee80211_header),
-                                                     packet.Data.size() - sizeof(ieee80211_header) - 4,
-                                                     0,
-                                                     antenna,
-                                                     rssi,
-                                                     noise,
-                                                     freq,
-                                                     0,
-                                                     0,
-                                                     NULL);
-                    if (should_clear_stats) {
-                        video_aggregator->clear_stats();
-                        should_clear_stats = false;
-                    }
-                } else if (frame.MatchesChannelID(mavlink_channel_id_be8)) {
-                    mavlink_aggregator->process_packet(packet.Data.data() + sizeof(ieee80211_header),
-                                                       packet.Data.size() - sizeof(ieee80211_header) - 4,
-                                                       0,
-                                                       antenna,
-                                                       rssi,
-                                                       noise,
-                                                       freq,
-                                                       0,
-                                                       0,
-                                                       NULL);
-                } else if (frame.MatchesChannelID(udp_channel_id_be8)) {
-                    udp_aggregator->process_packet(packet.Data.data() + sizeof(ieee80211_header),
-                                                   packet.Data.size() - sizeof(ieee80211_header) - 4,
-                                                   0,
-                                                   antenna,
-                                                   rssi,
-                                                   noise,
-                                                   freq,
-                                                   0,
-                                                   0,
-                                                   NULL);
-                }
-            };
+        // The USB callback only filters and copies, aggregators run on the worker / dispatcher threads
+        const bool channel_workers = rx_channel_workers;
+        startRxPipeline(channel_workers);
+        auto packetProcessor = [this, channel_workers](const Packet &packet) {
+            const int channel = channel_matcher.classify(packet.Data);
+            if (channel == ChannelMatcher<RX_CHANNEL_COUNT>::NO_MATCH) {
+                return;
+            }
+            const int8_t rssi[2] = {(int8_t)packet.RxAtrib.rssi[0], (int8_t)packet.RxAtrib.rssi[1]};
+            const int8_t snr[2] = {(int8_t)packet.RxAtrib.snr[0], (int8_t)packet.RxAtrib.snr[1]};
+            if (channel_workers) {
+                rx_workers[channel]->push(packet.Data, channel, rssi, snr);
+            } else {
+                rx_batcher->push(packet.Data, channel, rssi, snr);
+            }
+        };
 
         // Store the current fd for later TX power updates.
         current_fd = fd;
@@ -196,6 +231,8 @@ int WfbngLink::run(JNIEnv *env, jobject context, jint wifiChannel, jint bw, jint
                         this->log->error("Error handling events: {}", r);
                         // break;
                     }
+                    // The frames of the bulk-in transfer(s) just completed go to the dispatcher in one batch
+                    this->rx_batcher->flush();
                 }
             };
 
@@ -248,6 +285,7 @@ int WfbngLink::run(JNIEnv *env, jobject context, jint wifiChannel, jint bw, jint
             dev->should_stop = true;
         }
         txFrame->stop();
+        stopRxPipeline();
 
         destroy_thread(usb_tx_thread);
         destroy_thread(usb_event_thread);
@@ -261,6 +299,7 @@ int WfbngLink::run(JNIEnv *env, jobject context, jint wifiChannel, jint bw, jint
         dev->should_stop = true;
     }
     txFrame->stop();
+    stopRxPipeline();
 
     destroy_thread(usb_tx_thread);
     destroy_thread(usb_event_thread);
@@ -287,7 +326,124 @@ void WfbngLink::stop(JNIEnv *env, jobject context, jint fd) {
     stop_adaptive_link();
 }
 
+// Modified start_link_quality_thread: use adaptive_link_enabled and adaptive_tx_power
+void WfbngLink::start_link_quality_thread(int fd) {
+    auto thread_func = [this, fd]() {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        const char *ip = "10.5.0.10";
+        int port = 9999;
+        int sockfd;
+        struct sockaddr_in server_addr;
+        // Create UDP socket
+        if ((sockfd = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
+            __android_log_print(ANDROID_LOG_ERROR, TAG, "Socket creation failed");
+            return;
+        }
+        int opt = 1;
+        setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+        memset(&server_addr, 0, sizeof(server_addr));
+        server_addr.sin_family = AF_INET;
+        server_addr.sin_port = htons(port);
+        if (inet_pton(AF_INET, ip, &server_addr.sin_addr) <= 0) {
+            __android_log_print(ANDROID_LOG_ERROR, TAG, "Invalid IP address");
+            close(sockfd);
+            return;
+        }
+
+        uint32_t keyframe_requests = video_keyframe_requests();
+        while (!this->adaptive_link_should_stop) {
+            // The video player lost data it cannot conceal, a new idr_request_code makes the air unit send a keyframe
+            const uint32_t requests = video_keyframe_requests();
+            if (requests != keyframe_requests) {
+                keyframe_requests = requests;
+                SignalQualityCalculator::get_instance().request_idr();
+            }
+            auto quality = SignalQualityCalculator::get_instance().calculate_signal_quality();
+#if defined(ANDROID_DEBUG_RSSI) || true
+            __android_log_print(ANDROID_LOG_WARN, TAG, "quality %d", quality.quality);
+#endif
+            time_t currentEpoch = time(nullptr);
+            const auto map_range =
+                [](double value, double inputMin, double inputMax, double outputMin, double outputMax) {
+                    return outputMin + ((value - inputMin) * (outputMax - outputMin) / (inputMax - inputMin));
+                };
+            // map to 1000..2000
+            quality.quality = map_range(quality.quality, -1024, 1024, 1000, 2000);
+            {
+                uint32_t len;
+                char message[100];
+
+                /**
+                     1741491090:1602:1602:1:0:-70:24:num_ants:pnlt:fec_change:code
+
+                     <gs_time>:<link_score>:<link_score>:<fec>:<lost>:<rssi_dB>:<snr_dB>:<num_ants>:<noise_penalty>:<fec_change>:<idr_request_code>
+
+                    gs_time: gs clock
+                    link_score: 1000 - 2000 sent twice (already including any penalty)
+                    link_score: 1000 - 2000 sent twice (already including any penalty)
+                    fec: instantaneus fec_rec (only used by old fec_rec_pntly now disabled by default)
+                    lost: instantaneus lost (not used)
+                    rssi_dB:  best antenna rssi (for osd)
+                    snr_dB: best antenna snr_dB (for osd)
+                    num_ants: number of gs antennas (for osd)
+                    noise_penalty: penalty deducted from score due to noise (for osd)
+                    fec_change: int from 0 to 5 : how much to alter fec based on noise
+                    optional idr_request_code:  4 char unique code to request 1 keyframe (no need to send special extra
+                   packets)
+                 */
+
+                // Use the new public FEC threshold values
+                if (quality.lost_last_second > fec_lost_to_5) {
+                    fec.bump(5); // Bump to FEC 5
+                } else if (quality.recovered_last_second > fec_recovered_to_4) {
+                    fec.bump(4); // Bump to FEC 4
+                } else if (quality.recovered_last_second > fec_recovered_to_3) {
+                    fec.bump(3); // Bump to FEC 3
+                } else if (quality.recovered_last_second > fec_recovered_to_2) {
+                    fec.bump(2); // Bump to FEC 2
+                } else if (quality.recovered_last_second > fec_recovered_to_1) {
+                    fec.bump(1); // Bump to FEC 1
+                }
+
+                snprintf(message + sizeof(len),
+                         sizeof(message) - sizeof(len),
+                         "%ld:%d:%d:%d:%d:%d:%f:0:-1:%d:%s\n",
+                         static_cast<long>(currentEpoch),
+                         quality.quality,
+                         quality.quality,
+                         quality.recovered_last_second,
+                         quality.lost_last_second,
+                         quality.quality,
+                         quality.snr,
+                         fec.value(),
+                         quality.idr_code.c_str());
+                len = strlen(message + sizeof(len));
+                len = htonl(len);
+                memcpy(message, &len, sizeof(len));
+                __android_log_print(ANDROID_LOG_ERROR, TAG, " message %s", message + 4);
+                ssize_t sent = sendto(sockfd,
+                                      message,
+                                      strlen(message + sizeof(len)) + sizeof(len),
+                                      0,
+                                      (struct sockaddr *)&server_addr,
+                                      sizeof(server_addr));
+                if (sent < 0) {
+                    __android_log_print(ANDROID_LOG_ERROR, TAG, "Failed to send message");
+                    break;
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        close(sockfd);
+        this->adaptive_link_should_stop = false;
+    };
+
+    init_thread(link_quality_thread, [=]() { return std::make_unique<std::thread>(thread_func); });
+    rtl_devices.at(fd)->SetTxPower(adaptive_tx_power);
+}
+
 //--------------------------------------JAVA bindings--------------------------------------
+#ifdef __ANDROID__
 inline jlong jptr(WfbngLink *wfbngLinkN) { return reinterpret_cast<intptr_t>(wfbngLinkN); }
 
 inline WfbngLink *native(jlong ptr) { return reinterpret_cast<WfbngLink *>(ptr); }
@@ -334,10 +490,11 @@ extern "C" JNIEXPORT void JNICALL Java_com_openipc_wfbngrtl8812_WfbNgLink_native
 extern "C" JNIEXPORT void JNICALL Java_com_openipc_wfbngrtl8812_WfbNgLink_nativeStartAdaptivelink(JNIEnv *env,
                                                                                                   jclass clazz,
                                                                                                   jlong wfbngLinkN) {
-    if (native(wfbngLinkN)->video_aggregator == nullptr) {
+    auto table = native(wfbngLinkN)->aggregators();
+    if (table == nullptr) {
         return;
     }
-    auto aggregator = native(wfbngLinkN)->video_aggregator.get();
+    auto aggregator = table->by_channel[RX_CHANNEL_VIDEO].get();
 }
 
 extern "C" JNIEXPORT jint JNICALL Java_com_openipc_pixelpilot_UsbSerialService_nativeGetSignalQuality(JNIEnv *env,
@@ -358,10 +515,11 @@ extern "C" JNIEXPORT void JNICALL Java_com_openipc_wfbngrtl8812_WfbNgLink_native
                                                                                          jclass clazz,
                                                                                          jobject wfbStatChangedI,
                                                                                          jlong wfbngLinkN) {
-    if (native(wfbngLinkN)->video_aggregator == nullptr) {
+    auto table = native(wfbngLinkN)->aggregators();
+    if (table == nullptr) {
         return;
     }
-    auto aggregator = native(wfbngLinkN)->video_aggregator.get();
+    auto aggregator = table->by_channel[RX_CHANNEL_VIDEO].get();
     jclass jClassExtendsIWfbStatChangedI = env->GetObjectClass(wfbStatChangedI);
     jclass jcStats = env->FindClass("com/openipc/wfbngrtl8812/WfbNGStats");
     if (jcStats == nullptr) {
@@ -398,6 +556,37 @@ extern "C" JNIEXPORT void JNICALL Java_com_openipc_wfbngrtl8812_WfbNgLink_native
     }
     env->CallVoidMethod(wfbStatChangedI, onStatsChanged, stats);
     native(wfbngLinkN)->should_clear_stats = true;
+
+    if (auto &batcher = native(wfbngLinkN)->rx_batcher; batcher && !native(wfbngLinkN)->rx_channel_workers) {
+        RxBatchStats rx = batcher->stats();
+        __android_log_print(ANDROID_LOG_DEBUG,
+                            TAG,
+                            "rx transfers %llu, frames/transfer avg %.1f, batches %llu, frames/batch max %u, "
+                            "pool exhausted %llu, oversized %llu",
+                            (unsigned long long)rx.transfers,
+                            rx.frames_per_transfer(),
+                            (unsigned long long)rx.batches,
+                            rx.max_frames_per_batch,
+                            (unsigned long long)rx.pool_exhausted,
+                            (unsigned long long)rx.oversized);
+        batcher->clear_stats();
+    }
+    static constexpr const char *channel_names[RX_CHANNEL_COUNT] = {"video", "mavlink", "udp"};
+    for (int channel = 0; channel < RX_CHANNEL_COUNT; ++channel) {
+        auto &worker = native(wfbngLinkN)->rx_workers[channel];
+        if (!worker) continue;
+        RxChannelStats rx = worker->stats();
+        __android_log_print(rx.dropped > 0 ? ANDROID_LOG_WARN : ANDROID_LOG_DEBUG,
+                            TAG,
+                            "rx %s worker: frames %llu, dropped %llu, oversized %llu, queue depth %u max %u",
+                            channel_names[channel],
+                            (unsigned long long)rx.frames,
+                            (unsigned long long)rx.dropped,
+                            (unsigned long long)rx.oversized,
+                            rx.depth,
+                            rx.max_depth);
+        worker->clear_stats();
+    }
 }
 
 extern "C" JNIEXPORT void JNICALL Java_com_openipc_wfbngrtl8812_WfbNgLink_nativeRefreshKey(JNIEnv *env,
@@ -406,115 +595,6 @@ extern "C" JNIEXPORT void JNICALL Java_com_openipc_wfbngrtl8812_WfbNgLink_native
     native(wfbngLinkN)->initAgg();
 }
 
-// Modified start_link_quality_thread: use adaptive_link_enabled and adaptive_tx_power
-void WfbngLink::start_link_quality_thread(int fd) {
-    auto thread_func = [this, fd]() {
-        std::this_thread::sleep_for(std::chrono::seconds(1));
-        const char *ip = "10.5.0.10";
-        int port = 9999;
-        int sockfd;
-        struct sockaddr_in server_addr;
-        // Create UDP socket
-        if ((sockfd = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
-            __android_log_print(ANDROID_LOG_ERROR, TAG, "Socket creation failed");
-            return;
-        }
-        int opt = 1;
-        setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
-        memset(&server_addr, 0, sizeof(server_addr));
-        server_addr.sin_family = AF_INET;
-        server_addr.sin_port = htons(port);
-        if (inet_pton(AF_INET, ip, &server_addr.sin_addr) <= 0) {
-            __android_log_print(ANDROID_LOG_ERROR, TAG, "Invalid IP address");
-            close(sockfd);
-            return;
-        }
-
-        while (!this->adaptive_link_should_stop) {
-            auto quality = SignalQualityCalculator::get_instance().calculate_signal_quality();
-#if defined(ANDROID_DEBUG_RSSI) || true
-            __android_log_print(ANDROID_LOG_WARN, TAG, "quality %d", quality.quality);
-#endif
-            time_t currentEpoch = time(nullptr);
-            const auto map_range =
-                [](double value, double inputMin, double inputMax, double outputMin, double outputMax) {
-                    return outputMin + ((value - inputMin) * (outputMax - outputMin) / (inputMax - inputMin));
-                };
-            // map to 1000..2000
-            quality.quality = map_range(quality.quality, -1024, 1024, 1000, 2000);
-            {
-                uint32_t len;
-                char message[100];
-
-                /**
-                     1741491090:1602:1602:1:0:-70:24:num_ants:pnlt:fec_change:code
-
-                     <gs_time>:<link_score>:<link_score>:<fec>:<lost>:<rssi_dB>:<snr_dB>:<num_ants>:<noise_penalty>:<fec_change>:<idr_request_code>
-
-                    gs_time: gs clock
-                    link_score: 1000 - 2000 sent twice (already including any penalty)
-                    link_score: 1000 - 2000 sent twice (already including any penalty)
-                    fec: instantaneus fec_rec (only used by old fec_rec_pntly now disabled by default)
-                    lost: instantaneus lost (not used)
-                    rssi_dB:  best antenna rssi (for osd)
-                    snr_dB: best antenna snr_dB (for osd)
-                    num_ants: number of gs antennas (for osd)
-                    noise_penalty: penalty deducted from score due to noise (for osd)
-                    fec_change: int from 0 to 5 : how much to alter fec based on noise
-                    optional idr_request_code:  4 char unique code to request 1 keyframe (no need to send special extra
-                   packets)
-                 */
-
-                // Use the new public FEC threshold values
-                if (quality.lost_last_second > fec_lost_to_5) {
-                    fec.bump(5); // Bump to FEC 5
-                } else if (quality.recovered_last_second > fec_recovered_to_4) {
-                    fec.bump(4); // Bump to FEC 4
-                } else if (quality.recovered_last_second > fec_recovered_to_3) {
-                    fec.bump(3); // Bump to FEC 3
-                } else if (quality.recovered_last_second > fec_recovered_to_2) {
-                    fec.bump(2); // Bump to FEC 2
-                } else if (quality.recovered_last_second > fec_recovered_to_1) {
-                    fec.bump(1); // Bump to FEC 1
-                }
-
-                snprintf(message + sizeof(len),
-                         sizeof(message) - sizeof(len),
-                         "%ld:%d:%d:%d:%d:%d:%f:0:-1:%d:%s\n",
-                         static_cast<long>(currentEpoch),
-                         quality.quality,
-                         quality.quality,
-                         quality.recovered_last_second,
-                         quality.lost_last_second,
-                         quality.quality,
-                         quality.snr,
-                         fec.value(),
-                         quality.idr_code.c_str());
-                len = strlen(message + sizeof(len));
-                len = htonl(len);
-                memcpy(message, &len, sizeof(len));
-                __android_log_print(ANDROID_LOG_ERROR, TAG, " message %s", message + 4);
-                ssize_t sent = sendto(sockfd,
-                                      message,
-                                      strlen(message + sizeof(len)) + sizeof(len),
-                                      0,
-                                      (struct sockaddr *)&server_addr,
-                                      sizeof(server_addr));
-                if (sent < 0) {
-                    __android_log_print(ANDROID_LOG_ERROR, TAG, "Failed to send message");
-                    break;
-                }
-            }
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        }
-        close(sockfd);
-        this->adaptive_link_should_stop = false;
-    };
-
-    init_thread(link_quality_thread, [=]() { return std::make_unique<std::thread>(thread_func); });
-    rtl_devices.at(fd)->SetTxPower(adaptive_tx_power);
-}
-
 extern "C" JNIEXPORT void JNICALL Java_com_openipc_wfbngrtl8812_WfbNgLink_nativeSetAdaptiveLinkEnabled(
     JNIEnv *env, jclass clazz, jlong wfbngLinkN, jboolean enabled) {
     WfbngLink *link = native(wfbngLinkN);
@@ -579,6 +659,19 @@ extern "C" JNIEXPORT void JNICALL Java_com_openipc_wfbngrtl8812_WfbNgLink_native
     link->stbc_enabled = (use != 0);
 }
 
+extern "C" JNIEXPORT void JNICALL Java_com_openipc_wfbngrtl8812_WfbNgLink_nativeSetRxChannelWorkers(
+    JNIEnv *env, jclass clazz, jlong wfbngLinkN, jboolean enabled) {
+    // Takes effect with the next nativeRun
+    native(wfbngLinkN)->rx_channel_workers = enabled;
+}
+
+extern "C" JNIEXPORT void JNICALL Java_com_openipc_wfbngrtl8812_WfbNgLink_nativeSetVideoSink(JNIEnv *env,
+                                                                                            jclass clazz,
+                                                                                            jlong wfbngLinkN,
+                                                                                            jlong sink) {
+    native(wfbngLinkN)->setVideoSink(reinterpret_cast<const InProcessRtpSink *>(sink));
+}
+
 extern "C" JNIEXPORT void JNICALL Java_com_openipc_wfbngrtl8812_WfbNgLink_nativeSetFecThresholds(
     JNIEnv *env, jclass clazz, jlong nativeInstance, jint lostTo5, jint recTo4, jint recTo3, jint recTo2, jint recTo1) {
     WfbngLink *link = reinterpret_cast<WfbngLink *>(nativeInstance);
@@ -588,4 +681,5 @@ extern "C" JNIEXPORT void JNICALL Java_com_openipc_wfbngrtl8812_WfbNgLink_native
     link->fec_recovered_to_3 = recTo3;
     link->fec_recovered_to_2 = recTo2;
     link->fec_recovered_to_1 = recTo1;
-}
\ No newline at end of file
+}
+#endif // __ANDROID__
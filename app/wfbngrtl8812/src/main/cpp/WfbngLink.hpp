@@ -1,7 +1,11 @@
 #ifndef FPV_VR_WFBNG_LINK_H
 #define FPV_VR_WFBNG_LINK_H
 
+#include "AggregatorInProcess.h"
+#include "ChannelMatcher.h"
 #include "FecChangeController.h"
+#include "RxBatcher.h"
+#include "RxChannelWorker.h"
 #include "SignalQualityCalculator.h"
 #include "TxFrame.h"
 
@@ -12,13 +16,20 @@ extern "C" {
 #include "devourer/src/WiFiDriver.h"
 #include "wfb-ng/src/rx.hpp"
 #include <jni.h>
+#include <array>
 #include <list>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <vector> // Added for std::vector
 
 const u8 wfb_tx_port = 160;
 const u8 wfb_rx_port = 32;
+const u8 wfb_video_port = 0;
+const u8 wfb_mavlink_port = 0x10;
+
+// wfb channels we receive, in the order they are registered with the ChannelMatcher
+enum RxChannel : int { RX_CHANNEL_VIDEO = 0, RX_CHANNEL_MAVLINK, RX_CHANNEL_UDP, RX_CHANNEL_COUNT };
 
 class WfbngLink {
   public:
@@ -34,12 +45,30 @@ class WfbngLink {
 
     void initAgg();
 
+    // Deliver video to an in-process sink instead of UDP 127.0.0.1:5600. nullptr restores the UDP path.
+    // Synchronous: when it returns, no RX thread uses the previous sink anymore (its owner may release it).
+    void setVideoSink(const InProcessRtpSink *sink);
+
     void stop(JNIEnv *env, jobject androidContext, jint fd);
 
-    std::mutex agg_mutex;
-    std::unique_ptr<AggregatorUDPv4> video_aggregator;
-    std::unique_ptr<AggregatorUDPv4> mavlink_aggregator;
-    std::unique_ptr<AggregatorUDPv4> udp_aggregator;
+    // One aggregator per wfb channel, indexed by RxChannel. A table is never modified once published, initAgg()
+    // builds a new one and swaps it in, so the RX path only ever does an atomic load and never waits for a key
+    // refresh.
+    struct AggregatorTable {
+        std::array<std::unique_ptr<Aggregator>, RX_CHANNEL_COUNT> by_channel;
+        // by_channel[RX_CHANNEL_VIDEO] when the video goes to the in-process sink, gets the radio arrival times
+        AggregatorInProcess *video_in_process{nullptr};
+    };
+
+    std::shared_ptr<const AggregatorTable> aggregators() const { return std::atomic_load(&agg_table); }
+
+    // RX pipeline, chosen when run() starts:
+    //  - per channel workers (default): the USB callback queues every frame to the worker of its channel, so decrypt
+    //    and FEC never run on the libusb event thread and a slow video FEC block doesn't delay mavlink
+    //  - batched: a single dispatcher thread runs all aggregators one batch at a time
+    bool rx_channel_workers{true};
+    std::unique_ptr<RxBatcher> rx_batcher;
+    std::array<std::unique_ptr<RxChannelWorker>, RX_CHANNEL_COUNT> rx_workers;
 
     void start_link_quality_thread(int fd);
 
@@ -83,6 +112,18 @@ class WfbngLink {
     }
 
   private:
+    // Builds a new aggregator table and swaps it in, returns the previous one. Caller holds agg_init_mutex.
+    std::shared_ptr<const AggregatorTable> publishAggregators();
+
+    // Keyframe requests of the in-process video sink so far (see InProcessRtpSink), 0 without one
+    uint32_t video_keyframe_requests();
+
+    // Runs the aggregators over one batch of valid wfb frames against a single snapshot of the aggregator table
+    void dispatchBatch(std::span<const RxBatchFrame> frames);
+
+    void startRxPipeline(bool channel_workers);
+    void stopRxPipeline();
+
     void stopDevice() {
         if (rtl_devices.find(current_fd) == rtl_devices.end()) return;
         auto dev = rtl_devices.at(current_fd).get();
@@ -95,14 +136,20 @@ class WfbngLink {
     std::recursive_mutex thread_mutex;
     std::unique_ptr<WiFiDriver> wifi_driver;
     std::shared_ptr<TxFrame> txFrame;
-    uint32_t video_channel_id_be;
-    uint32_t mavlink_channel_id_be;
-    uint32_t udp_channel_id_be;
+    // Published with std::atomic_store, read with std::atomic_load
+    std::shared_ptr<const AggregatorTable> agg_table;
+    // Serializes writers of agg_table (initAgg callers), never taken on the RX path
+    std::mutex agg_init_mutex;
+    const InProcessRtpSink *video_sink{nullptr};
 
     Logger_t log;
     std::unique_ptr<std::thread> usb_event_thread{nullptr};
     std::unique_ptr<std::thread> usb_tx_thread{nullptr};
     uint32_t link_id{7669206};
+    // Built from link_id, which never changes after construction
+    const ChannelMatcher<RX_CHANNEL_COUNT> channel_matcher;
+
+    uint32_t channel_id(uint8_t radio_port) const { return (link_id << 8) + radio_port; }
     SignalQualityCalculator rssi_calculator;
 };
 
@@ -0,0 +1,104 @@
+// Host benchmark: classifying received frames by wfb channel.
+//   bytewise  - RxFrame::IsValidWfbFrame + up to three RxFrame::MatchesChannelID, the previous WfbngLink path
+//   matcher   - ChannelMatcher<3>::classify
+//
+// The frame mix mimics a typical link: mostly video, some mavlink/udp and foreign traffic.
+//
+// Usage: channel_matcher_bench [iterations=20000000]
+
+#include "ChannelMatcher.h"
+#include "RxFrame.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+constexpr uint32_t LINK_ID = 7669206;
+const std::array<uint32_t, 3> CHANNEL_IDS = {(LINK_ID << 8) + 0, (LINK_ID << 8) + 0x10, (LINK_ID << 8) + 32};
+
+std::vector<uint8_t> makeFrame(uint32_t channel_id, size_t size) {
+    std::vector<uint8_t> frame(size, 0xab);
+    frame[0] = 0x08;
+    frame[1] = 0x01;
+    const uint8_t id[4] = {uint8_t(channel_id >> 24), uint8_t(channel_id >> 16), uint8_t(channel_id >> 8),
+                           uint8_t(channel_id)};
+    frame[10] = frame[16] = 0x57;
+    frame[11] = frame[17] = 0x42;
+    for (int i = 0; i < 4; ++i) {
+        frame[12 + i] = frame[18 + i] = id[i];
+    }
+    return frame;
+}
+
+int classifyBytewise(const std::vector<uint8_t> &data, const uint8_t *const ids_be[3]) {
+    RxFrame frame(std::span<uint8_t>(const_cast<uint8_t *>(data.data()), data.size()));
+    if (!frame.IsValidWfbFrame()) return -1;
+    for (int i = 0; i < 3; ++i) {
+        if (frame.MatchesChannelID(ids_be[i])) return i;
+    }
+    return -1;
+}
+
+template <typename F> double run(const char *name, long iterations, const std::vector<std::vector<uint8_t>> &frames,
+                                 F &&classify) {
+    long checksum = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; ++i) {
+        checksum += classify(frames[i & (frames.size() - 1)]);
+    }
+    const double ns =
+        std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / iterations;
+    printf("%-9s %.2f ns/frame (checksum %ld)\n", name, ns, checksum);
+    return ns;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+    const long iterations = argc > 1 ? atol(argv[1]) : 20000000;
+
+    // Power of two so the benchmark loop can mask instead of modulo
+    std::vector<std::vector<uint8_t>> frames(4096);
+    std::mt19937 rng(42);
+    for (auto &frame : frames) {
+        const int kind = rng() % 100;
+        const size_t size = 200 + rng() % 1300;
+        if (kind < 85) {
+            frame = makeFrame(CHANNEL_IDS[0], size);
+        } else if (kind < 90) {
+            frame = makeFrame(CHANNEL_IDS[1], size);
+        } else if (kind < 95) {
+            frame = makeFrame(CHANNEL_IDS[2], size);
+        } else {
+            frame = makeFrame((12345u << 8) + 0, size);
+        }
+    }
+
+    uint32_t ids_be[3];
+    const uint8_t *ids_be8[3];
+    for (int i = 0; i < 3; ++i) {
+        const uint32_t id = CHANNEL_IDS[i];
+        const uint8_t bytes[4] = {uint8_t(id >> 24), uint8_t(id >> 16), uint8_t(id >> 8), uint8_t(id)};
+        memcpy(&ids_be[i], bytes, sizeof(bytes));
+        ids_be8[i] = reinterpret_cast<const uint8_t *>(&ids_be[i]);
+    }
+    const ChannelMatcher<3> matcher(CHANNEL_IDS);
+
+    for (const auto &frame : frames) {
+        if (classifyBytewise(frame, ids_be8) != matcher.classify(frame)) {
+            printf("mismatch between bytewise and matcher classification\n");
+            return 1;
+        }
+    }
+
+    const double bytewise =
+        run("bytewise", iterations, frames, [&](const std::vector<uint8_t> &f) { return classifyBytewise(f, ids_be8); });
+    const double word =
+        run("matcher", iterations, frames, [&](const std::vector<uint8_t> &f) { return matcher.classify(f); });
+    printf("speedup   %.2fx\n", bytewise / word);
+    return 0;
+}
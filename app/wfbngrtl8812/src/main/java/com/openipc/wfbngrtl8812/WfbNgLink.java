@@ -49,6 +49,8 @@ public class WfbNgLink implements WfbNGStatsChanged {
     public static native void nativeSetUseFec(long nativeInstance, int use);
     public static native void nativeSetUseLdpc(long nativeInstance, int use);
     public static native void nativeSetUseStbc(long nativeInstance, int use);
+    public static native void nativeSetVideoSink(long nativeInstance, long sink);
+    public static native void nativeSetRxChannelWorkers(long nativeInstance, boolean enabled);
 
     public WfbNgLink(final AppCompatActivity parent) {
         this.context = parent;
@@ -92,6 +94,23 @@ public class WfbNgLink implements WfbNGStatsChanged {
         nativeSetUseStbc(nativeWfbngLink, use);
     }
 
+    /**
+     * Deliver video to an in-process sink (VideoPlayer.getInProcessSink()) instead of UDP 127.0.0.1:5600.
+     * Pass 0 to fall back to UDP. Once this returns, no RX thread references the previous sink anymore, so the
+     * player owning it can be stopped or released: detach before that.
+     */
+    public void setVideoSink(long sink) {
+        nativeSetVideoSink(nativeWfbngLink, sink);
+    }
+
+    /**
+     * Run decrypt/FEC on one worker thread per wfb channel (default) instead of a single dispatcher thread.
+     * Takes effect with the next start().
+     */
+    public void setRxChannelWorkers(boolean enabled) {
+        nativeSetRxChannelWorkers(nativeWfbngLink, enabled);
+    }
+
     public synchronized void start(int wifiChannel, int bandWidth, UsbDevice usbDevice) {
         Log.d(TAG, "wfb-ng monitoring on " + usbDevice.getDeviceName() + " using wifi channel " + wifiChannel);
         UsbManager usbManager = (UsbManager) context.getSystemService(Context.USB_SERVICE);